@@ -0,0 +1,112 @@
+#include "LatticeCellLookup.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+
+// Compares Voronoi cells found by LatticeCellLookup with brute-force search of the nearest lattice point
+// for random points, including lattices given by non-reduced bases.
+// Returns non-zero if any lookup disagrees.
+
+
+// Number of random points for each lattice.
+const Int NumPoints = 1000000;
+// Range of random lattice coordinates.
+const Real CoordinateRange = 50;
+
+
+Real DistanceToLatticePoint( const Mat22& basis, const Real& u, const Real& v, const Vec2i& cell )
+{
+	return cv::norm( basis * Vec2( u - cell[0], v - cell[1] ) );
+}
+
+
+// Nearest lattice point by exhaustive search. Every point is closer than the half-diagonal of its lattice
+// parallelogram to some lattice point, which bounds the search box in lattice coordinates.
+Vec2i BruteForceCell( const Mat22& basis, const Mat22& inverse, const Real& u, const Real& v )
+{
+	const Vec2 b1( basis(0,0), basis(1,0) );
+	const Vec2 b2( basis(0,1), basis(1,1) );
+	const Real radius = 0.5 * std::max( cv::norm( b1 + b2 ), cv::norm( b1 - b2 ) );
+	const Int rangeU = Int( std::ceil( radius * cv::norm( Vec2( inverse(0,0), inverse(0,1) ) ) ) );
+	const Int rangeV = Int( std::ceil( radius * cv::norm( Vec2( inverse(1,0), inverse(1,1) ) ) ) );
+	const Int centerU = Int( std::round( u ) );
+	const Int centerV = Int( std::round( v ) );
+	Vec2i best( centerU, centerV );
+	Real bestDist = DistanceToLatticePoint( basis, u, v, best );
+	for ( Int cellV = centerV - rangeV; cellV <= centerV + rangeV; ++cellV )
+	{
+		for ( Int cellU = centerU - rangeU; cellU <= centerU + rangeU; ++cellU )
+		{
+			const Real dist = DistanceToLatticePoint( basis, u, v, Vec2i( cellU, cellV ) );
+			if ( dist < bestDist )
+			{
+				bestDist = dist;
+				best = Vec2i( cellU, cellV );
+			}
+		}
+	}
+	return best;
+}
+
+
+bool CheckLattice( const std::string& name, const Mat22& basis )
+{
+	LatticeCellLookup lookup;
+	if ( !lookup.Build( basis, LatticeCellLookup::CellShape::Voronoi ) )
+	{
+		std::cout << "[FAIL] " << name << ": basis is rejected" << std::endl;
+		return false;
+	}
+	const Mat22 inverse = basis.inv();
+	const Real scale = std::max( cv::norm( Vec2( basis(0,0), basis(1,0) ) ), cv::norm( Vec2( basis(0,1), basis(1,1) ) ) );
+
+	std::mt19937 generator( 12345 );
+	std::uniform_real_distribution<Real> coordinate( -CoordinateRange, CoordinateRange );
+	Int numMismatches = 0;
+	Int numOutsideMargin = 0;
+	for ( Int i = 0; i < NumPoints; ++i )
+	{
+		const Real u = coordinate( generator );
+		const Real v = coordinate( generator );
+		const Vec2i cell = lookup.Cell( u, v );
+		const Vec2i nearest = BruteForceCell( basis, inverse, u, v );
+		// Points on cell borders may go to either cell.
+		if ( cell != nearest &&
+			 DistanceToLatticePoint( basis, u, v, cell ) > DistanceToLatticePoint( basis, u, v, nearest ) + 1e-9 * scale )
+			++numMismatches;
+		if ( std::abs( cell[0] - Int( std::round( u ) ) ) > lookup.Margin() ||
+			 std::abs( cell[1] - Int( std::round( v ) ) ) > lookup.Margin() )
+			++numOutsideMargin;
+	}
+
+	const bool isPassed = numMismatches == 0 && numOutsideMargin == 0;
+	std::cout << (isPassed ? "[ OK ] " : "[FAIL] ") << name
+		<< ": " << NumPoints << " points, " << numMismatches << " mismatches, "
+		<< numOutsideMargin << " outside margin " << lookup.Margin() << std::endl;
+	return isPassed;
+}
+
+
+int main()
+{
+	bool isPassed = true;
+
+	const Real pitch = 1.3;
+	const Real sqrt3 = std::sqrt( 3.0 );
+	isPassed &= CheckLattice( "square", Mat22( pitch, 0, 0, pitch ) );
+	isPassed &= CheckLattice( "hexagonal", Mat22( pitch, 0.5*pitch, 0, 0.5*sqrt3*pitch ) );
+	isPassed &= CheckLattice( "hexagonal, vertical", Mat22( 0.5*sqrt3*pitch, 0, 0.5*pitch, pitch ) );
+	isPassed &= CheckLattice( "rotated oblique", Mat22( 0.9, -0.55, 0.3, 1.2 ) );
+	// Same lattices given by non-reduced bases.
+	isPassed &= CheckLattice( "square, sheared basis", Mat22( pitch, 3*pitch, 0, pitch ) );
+	isPassed &= CheckLattice( "hexagonal, long basis", Mat22( pitch, 3.5*pitch, 0, 0.5*sqrt3*pitch ) );
+	isPassed &= CheckLattice( "rotated oblique, long basis", Mat22( 0.9, 0.9*5 - 0.55, 0.3, 0.3*5 + 1.2 ) );
+
+	std::cout << (isPassed ? "All cells match." : "Some cells do not match.") << std::endl;
+	return isPassed ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include "Philox.h"
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+
+// Compares Philox4x32 with the published known-answer outputs of Philox-4x32-10
+// (Random123 kat_vectors). Returns non-zero if any output differs.
+
+
+struct KnownAnswer
+{
+	std::string Name;
+	PhiloxCounter Counter;
+	PhiloxKey Key;
+	PhiloxCounter Output;
+};
+
+
+void PrintWords( const PhiloxCounter& words )
+{
+	std::cout << std::hex << std::setfill( '0' );
+	for ( const std::uint32_t& word : words )
+		std::cout << " " << std::setw( 8 ) << word;
+	std::cout << std::dec << std::setfill( ' ' );
+}
+
+
+bool CheckKnownAnswer( const KnownAnswer& answer )
+{
+	const PhiloxCounter output = Philox4x32( answer.Counter, answer.Key );
+	const bool isPassed = output == answer.Output;
+	std::cout << (isPassed ? "[ OK ] " : "[FAIL] ") << answer.Name << ":";
+	PrintWords( output );
+	if ( !isPassed )
+	{
+		std::cout << ", expected";
+		PrintWords( answer.Output );
+	}
+	std::cout << std::endl;
+	return isPassed;
+}
+
+
+int main()
+{
+	const KnownAnswer answers[] =
+	{
+		{ "zero counter and key",
+			{ 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u }, { 0x00000000u, 0x00000000u },
+			{ 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u } },
+		{ "all-ones counter and key",
+			{ 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu }, { 0xffffffffu, 0xffffffffu },
+			{ 0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu } },
+		{ "digits of pi",
+			{ 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u }, { 0xa4093822u, 0x299f31d0u },
+			{ 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u } },
+	};
+
+	bool isPassed = true;
+	for ( const KnownAnswer& answer : answers )
+		isPassed &= CheckKnownAnswer( answer );
+
+	std::cout << (isPassed ? "All outputs match." : "Some outputs do not match.") << std::endl;
+	return isPassed ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+#include "DisplayLenslet.h"
+#include "DisplayLensletCapture.h"
+#include "DisplayProjectorAligned.h"
+#include "DisplayProjectorsCapture.h"
+#include "RayGenFocusEye.h"
+#include "RayGenPinhole.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+
+
+// Compares closed-form GenerateRayDifferential of the ray generators
+// with the finite-difference implementation of lfrt::RayGenerator.
+// Returns non-zero if any generator disagrees.
+
+
+using VEC2 = lfrt::VEC2;
+using VEC3 = lfrt::VEC3;
+
+// Step of the finite differences in lfrt::RayGenerator::GenerateRayDifferential, in pixels.
+const Real FiniteDifferenceStep = 0.01;
+// Allowed truncation error of the forward differences, relative to the derivative.
+const Real RelativeTolerance = 1e-3;
+// Number of checked samples along each image axis.
+const Int GridSize = 41;
+
+// Tells whether the ray is smooth between 'raster' and 'raster + step', i.e., finite differences are meaningful there.
+using SmoothnessTest = std::function< bool( const VEC2& raster, const VEC2& step ) >;
+
+
+Real Length( const VEC3& v )
+{
+	return std::sqrt( Real(v.x)*v.x + Real(v.y)*v.y + Real(v.z)*v.z );
+}
+
+
+Real Distance( const VEC3& a, const VEC3& b )
+{
+	return Length( VEC3({ a.x - b.x, a.y - b.y, a.z - b.z }) );
+}
+
+
+bool CheckRayGenerator( const std::string& name, const lfrt::RayGenerator& raygen,
+	const Int& width, const Int& height, const SmoothnessTest& isSmooth = nullptr )
+{
+	Int numChecked = 0;
+	Int numSkipped = 0;
+	Int numFailed = 0;
+	Real maxRelativeError = 0;
+	for ( Int j = 0; j < GridSize; ++j )
+	{
+		for ( Int i = 0; i < GridSize; ++i )
+		{
+			// Irregular positions inside pixels, and secondary coordinates decorrelated from them.
+			const VEC2 raster({
+				lfrt::Real( (i + 0.37) * width / Real(GridSize) ),
+				lfrt::Real( (j + 0.61) * height / Real(GridSize) ) });
+			const VEC2 secondary({
+				lfrt::Real( ((7*i + 3*j) % GridSize + 0.5) / Real(GridSize) ),
+				lfrt::Real( ((5*j + 2*i) % GridSize + 0.5) / Real(GridSize) ) });
+			if ( isSmooth != nullptr &&
+				( !isSmooth( raster, VEC2({ lfrt::Real(FiniteDifferenceStep), 0 }) ) || !isSmooth( raster, VEC2({ 0, lfrt::Real(FiniteDifferenceStep) }) ) ) )
+			{
+				++numSkipped;
+				continue;
+			}
+
+			VEC3 ori, dir, oridx, dirdx, oridy, dirdy;
+			VEC3 oriFD, dirFD, oridxFD, dirdxFD, oridyFD, dirdyFD;
+			const lfrt::Real weight = raygen.GenerateRayDifferential( raster, secondary, ori, dir, oridx, dirdx, oridy, dirdy );
+			const lfrt::Real weightFD = raygen.lfrt::RayGenerator::GenerateRayDifferential(
+				raster, secondary, oriFD, dirFD, oridxFD, dirdxFD, oridyFD, dirdyFD );
+			if ( weight != weightFD )
+			{
+				++numFailed;
+				continue;
+			}
+			if ( weight <= 0 )
+				continue;
+			++numChecked;
+
+			// Rounding error of the forward differences is amplified by 1/step.
+			const Real noise = 16 * std::numeric_limits<lfrt::Real>::epsilon()
+				* std::max<Real>( std::max<Real>( Length( ori ), Length( dir ) ), 1 ) / FiniteDifferenceStep;
+			const VEC3* exact[4] = { &oridx, &dirdx, &oridy, &dirdy };
+			const VEC3* approx[4] = { &oridxFD, &dirdxFD, &oridyFD, &dirdyFD };
+			bool isFailed = Distance( ori, oriFD ) > 0 || Distance( dir, dirFD ) > 0;
+			for ( Int k = 0; k < 4; ++k )
+			{
+				const Real error = Distance( *exact[k], *approx[k] );
+				const Real scale = Length( *exact[k] );
+				if ( error > RelativeTolerance * scale + noise )
+					isFailed = true;
+				if ( scale > 0 )
+					maxRelativeError = std::max( maxRelativeError, error / scale );
+			}
+			if ( isFailed )
+				++numFailed;
+		}
+	}
+
+	const bool isPassed = numFailed == 0 && numChecked > 0;
+	std::cout << (isPassed ? "[ OK ] " : "[FAIL] ") << name
+		<< ": checked " << numChecked << ", skipped " << numSkipped << ", failed " << numFailed
+		<< ", max relative error " << maxRelativeError << std::endl;
+	return isPassed;
+}
+
+
+// Samples whose finite-difference step crosses an elemental image border are not comparable,
+// since the lenslet index jumps there.
+SmoothnessTest SameElementalImage( const DisplayLenslet& display )
+{
+	return [&display]( const VEC2& raster, const VEC2& step )
+	{
+		auto cell = [&display]( const Real& x, const Real& y )
+		{
+			const Vec2 eiPos2D(
+				(-0.5 + x / Real(display.ResolutionLCD[0])) * display.SizeLCD[0],
+				( 0.5 - y / Real(display.ResolutionLCD[1])) * display.SizeLCD[1] );
+			return display.EICells().Cell( display.EIShiftInv() + display.EIOrientationInv() * eiPos2D );
+		};
+		return cell( raster.x, raster.y ) == cell( raster.x + step.x, raster.y + step.y );
+	};
+}
+
+
+bool CheckDisplayLenslet( const std::string& name, const DisplayLenslet::CellShape& cellShape, const Mat22& lensletOrientation )
+{
+	DisplayLenslet display;
+	display.LensletToLCD = 3.3;
+	display.LensletToOrigin = 300;
+	display.LensletFocalLength = 3.0;
+	display.SizeLCD = Vec2( 76.8, 43.2 );
+	display.ResolutionLCD = Vec2i( 480, 270 );
+	display.IsLensletVertical = false;
+	// Elemental images are magnified lenslets, as seen from the origin.
+	const Real magnification = (display.LensletToOrigin + display.LensletToLCD) / display.LensletToOrigin;
+	if ( !display.SetLensletPositioning( Vec2(0.1,0.2), lensletOrientation ) ||
+		 !display.SetEIPositioning( Vec2(0.1,0.2) * magnification, lensletOrientation * magnification ) ||
+		 !display.SetCellShape( cellShape ) )
+	{
+		std::cout << "[FAIL] " << name << ": invalid display model" << std::endl;
+		return false;
+	}
+
+	const Int width = display.ResolutionLCD[0];
+	const Int height = display.ResolutionLCD[1];
+	bool isPassed = true;
+	isPassed &= CheckRayGenerator( name + ", lenslet center",
+		DisplayLensletCapture( &display, DisplayLensletCapture::Sampling::LensletCenter ), width, height, SameElementalImage( display ) );
+	isPassed &= CheckRayGenerator( name + ", pupil center",
+		DisplayLensletCapture( &display, DisplayLensletCapture::Sampling::PupilCenter ), width, height, SameElementalImage( display ) );
+	isPassed &= CheckRayGenerator( name + ", lenslet average",
+		DisplayLensletCapture( &display, DisplayLensletCapture::Sampling::LensletAverage ), width, height, SameElementalImage( display ) );
+	return isPassed;
+}
+
+
+int main()
+{
+	bool isPassed = true;
+
+	isPassed &= CheckRayGenerator( "RayGenPinhole",
+		RayGenPinhole( 320, 240, -0.4, -0.3, 0.6, 0.45, 1.5, 0.05, -0.02 ), 320, 240 );
+
+	RayGenFocusEye eye;
+	eye.Width = 320;
+	eye.Height = 240;
+	eye.RetinaPlaneZ = -17;
+	eye.RetinaStart = lfrt::VEC2({ -4.0, -3.0 });
+	eye.RetinaEnd = lfrt::VEC2({ 4.0, 3.0 });
+	eye.ApertureRadius = 2;
+	eye.InFocusPlaneZ = 500;
+	isPassed &= CheckRayGenerator( "RayGenFocusEye", eye, eye.Width, eye.Height );
+	eye.InFocusPlaneZ = 0;
+	isPassed &= CheckRayGenerator( "RayGenFocusEye, pinhole", eye, eye.Width, eye.Height );
+
+	const Real pitch = 1.0;
+	isPassed &= CheckDisplayLenslet( "DisplayLensletCapture, square",
+		DisplayLenslet::CellShape::Parallelogram, Mat22( pitch, 0, 0, pitch ) );
+	isPassed &= CheckDisplayLenslet( "DisplayLensletCapture, hexagonal",
+		DisplayLenslet::CellShape::Voronoi, Mat22( pitch, 0.5*pitch, 0, 0.5*std::sqrt(3.0)*pitch ) );
+
+	DisplayProjectorAligned projectors;
+	projectors.ViewerDistance = 400;
+	projectors.ProjectorResolution = Vec2i( 320, 240 );
+	projectors.HalfPhysSize = Vec2( 200, 150 );
+	projectors.ProjectorLines.push_back( { Vec3(-1000,0,800), Vec3(50,0,0), 41 } );
+	projectors.DiffusionPower = Vec2( 40, 0 );
+	std::vector<Vec3> projectorPositions;
+	projectors.FillProjectorsPositions( projectorPositions );
+	for ( const Int projInd : { 0, 20, 40 } )
+	{
+		isPassed &= CheckRayGenerator( "DisplayProjectorsCapture, projector " + std::to_string( projInd ),
+			DisplayProjectorsCapture( &projectors, projectorPositions[projInd] ),
+			projectors.ProjectorResolution[0], projectors.ProjectorResolution[1] );
+	}
+
+	std::cout << (isPassed ? "All ray differentials match." : "Some ray differentials do not match.") << std::endl;
+	return isPassed ? 0 : 1;
+}
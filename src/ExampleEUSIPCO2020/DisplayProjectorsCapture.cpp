@@ -43,3 +43,76 @@ Real DisplayProjectorsCapture::GenerateRay( const VEC2& raster, const VEC2& seco
 
 	return 1;
 }
+
+
+void DisplayProjectorsCapture::GenerateRays( const Int& count, const VEC2* raster, const VEC2* /*secondary*/, const lfrt::RayBatch& rays ) const
+{
+	if ( m_DisplayModel == nullptr )
+	{
+		for ( Int i = 0; i < count; ++i )
+			rays.weight[i] = 0;
+		return;
+	}
+
+	const Real scaleX = 2.0 * m_DisplayModel->HalfPhysSize[0] / (Real)m_DisplayModel->ProjectorResolution[0];
+	const Real scaleY = 2.0 * m_DisplayModel->HalfPhysSize[1] / (Real)m_DisplayModel->ProjectorResolution[1];
+	const Real halfSizeX = m_DisplayModel->HalfPhysSize[0];
+	const Real halfSizeY = m_DisplayModel->HalfPhysSize[1];
+	const Real z0 = m_DisplayModel->ViewerDistance;
+	const DiffuserModel& diffuser = *m_DiffuserModel;
+
+	// Screen positions are computed in a separate vectorizable pass.
+	for ( Int i = 0; i < count; ++i )
+	{
+		rays.dirX[i] = raster[i].x * scaleX - halfSizeX;
+		rays.dirY[i] = halfSizeY - raster[i].y * scaleY;
+	}
+
+	// Diffuser maximum search stays scalar.
+	for ( Int i = 0; i < count; ++i )
+	{
+		const Real x0 = rays.dirX[i];
+		const Real y0 = rays.dirY[i];
+		const Vec3 locOri = m_ProjectorPosition - Vec3(x0,y0,z0);
+		const Vec3 locLineOri = Vec3(-x0,-y0,-z0);
+		const Real X = diffuser.FindMaxOnLine( locOri, locLineOri );
+		rays.oriX[i] = X;
+		rays.oriY[i] = 0;
+		rays.oriZ[i] = 0;
+		rays.dirX[i] = x0 - X;
+		rays.dirZ[i] = z0;
+		rays.weight[i] = 1;
+	}
+}
+
+
+Real DisplayProjectorsCapture::GenerateRayDifferential(
+	const VEC2& raster, const VEC2& secondary,
+	VEC3& ori, VEC3& dir,
+	VEC3& oridx, VEC3& dirdx,
+	VEC3& oridy, VEC3& dirdy ) const
+{
+	const Real weight = GenerateRay( raster, secondary, ori, dir );
+	oridx = oridy = dirdx = dirdy = { 0, 0, 0 };
+	if ( weight <= 0 )
+		return weight;
+
+	const Real x0Dx =  2.0 * m_DisplayModel->HalfPhysSize[0] / (Real)m_DisplayModel->ProjectorResolution[0];
+	const Real y0Dy = -2.0 * m_DisplayModel->HalfPhysSize[1] / (Real)m_DisplayModel->ProjectorResolution[1];
+
+	// Screen position is (x0,y0,z0) = ori + dir.
+	const Vec3 screenPos = Vec3( ori.x + dir.x, ori.y + dir.y, ori.z + dir.z );
+	const Vec3 locOri = m_ProjectorPosition - screenPos;
+	const Vec3 locLineOri = Vec3(0,0,0) - screenPos;
+
+	// Moving the screen point shifts both local origins in the opposite direction.
+	const Real XDx = m_DiffuserModel->FindMaxOnLineShiftDerivative( locOri, locLineOri, Vec3(-x0Dx,0,0) );
+	const Real XDy = m_DiffuserModel->FindMaxOnLineShiftDerivative( locOri, locLineOri, Vec3(0,-y0Dy,0) );
+
+	oridx.x = XDx;
+	oridy.x = XDy;
+	dirdx.x = x0Dx - XDx;
+	dirdy.x = -XDy;
+	dirdy.y = y0Dy;
+	return weight;
+}
@@ -27,6 +27,19 @@ public:
         const VEC2& raster, const VEC2& secondary,
         VEC3& ori, VEC3& dir ) const override;
 
+    virtual void GenerateRays(
+        const Int& count, const VEC2* raster, const VEC2* secondary,
+        const lfrt::RayBatch& rays ) const override;
+
+    virtual Real GenerateRayDifferential(
+        const VEC2& raster, const VEC2& secondary,
+        VEC3& ori, VEC3& dir,
+        VEC3& oridx, VEC3& dirdx,
+        VEC3& oridy, VEC3& dirdy ) const override;
+
+    // Ray is defined by the screen point only; secondary coordinates are ignored.
+    virtual unsigned UsedDimensions() const override { return lfrt::SampleDimRaster; }
+
 
 private:
     const DisplayProjectorAligned* m_DisplayModel = nullptr;
@@ -5,6 +5,8 @@
 #include "DisplayProjectorAligned.h"
 #include "ObserverSpace.h"
 
+#include "ImagePixel.h"
+
 
 DisplayProjectorsOptimization::DisplayProjectorsOptimization( const DisplayProjectorAligned* displayModel, const ObserverSpace* viewerSpace )
 	:m_DisplayModel(displayModel)
@@ -47,20 +49,26 @@ bool DisplayProjectorsOptimization::Iterate(
 
 	if ( numProjectors <= 0 )
 		return false;
+	if ( numViewerPositions <= 0 || groundtrue.empty() )
+		return false;
 	if ( groundtrue.size() != numViewerPositions )
 		return false;
 	if ( zeroIteration.size() != numProjectors )
 		return false;
+	// Element type is dispatched once, so all ground-true images must share it.
+	const int groundtrueType = groundtrue[0].type();
 	for ( Int i = 0; i < numViewerPositions; ++i )
 	{
 		const cv::Mat& image = groundtrue[i];
-		if ( image.cols != width || image.rows != height || image.type() != CV_32FC3 )
+		if ( image.cols != width || image.rows != height || image.type() != groundtrueType || !IsColorImage( image ) )
 			return false;
 	}
+	// Iterations are stored in the same format as the initial images.
+	const int imageType = zeroIteration[0].type();
 	for ( Int i = 0; i < numProjectors; ++i )
 	{
 		const cv::Mat& image = zeroIteration[i];
-		if ( image.cols != width || image.rows != height || image.type() != CV_32FC3 )
+		if ( image.cols != width || image.rows != height || image.type() != imageType || !IsColorImage( image ) )
 			return false;
 	}
 
@@ -70,128 +78,147 @@ bool DisplayProjectorsOptimization::Iterate(
 		std::vector<cv::Mat>& iter = iterations[iterInd];
 		iter.resize( numProjectors );
 		for ( Int projInd = 0; projInd < numProjectors; ++projInd )
-			iter[projInd] = cv::Mat::zeros( height, width, CV_32FC3 );
+			iter[projInd] = cv::Mat::zeros( height, width, imageType );
 	}
 	// ----- Initialize basic parameters and make sanity check. -----
 
 	const int RealType = cv::DataType<Real>::type;
 
-	// Parallelize pixel-wise.
-	cv::parallel_for_( cv::Range( 0, width*height ),
-		[&](const cv::Range& range)
-		{
-			cv::Mat B = cv::Mat( numProjectors, numProjectors, RealType );
-			std::vector<cv::Mat> betas(3);
-			cv::Mat w = cv::Mat( numProjectors, 1, RealType );
+	// Is instantiated for the element types of ground-true and iteration images,
+	// so that pixel access does not check the format.
+	auto iterate = [&]( auto groundtrueElement, auto iterationElement )
+	{
+		using GroundtrueElement = decltype( groundtrueElement );
+		using IterationElement = decltype( iterationElement );
+		// Parallelize over rows.
+		cv::parallel_for_( cv::Range( 0, height ),
+			[&](const cv::Range& range)
+			{
+				cv::Mat B = cv::Mat( numProjectors, numProjectors, RealType );
+				std::vector<cv::Mat> betas(3);
+				cv::Mat w = cv::Mat( numProjectors, 1, RealType );
 
-			cv::Mat prev = cv::Mat( numProjectors, 1, RealType );
-			cv::Mat cur = cv::Mat( numProjectors, 1, RealType );
-			cv::Mat gradient = cv::Mat( numProjectors, 1, RealType );
-			cv::Mat descent = cv::Mat( numProjectors, 1, RealType );
+				cv::Mat prev = cv::Mat( numProjectors, 1, RealType );
+				cv::Mat cur = cv::Mat( numProjectors, 1, RealType );
+				cv::Mat gradient = cv::Mat( numProjectors, 1, RealType );
+				cv::Mat descent = cv::Mat( numProjectors, 1, RealType );
 
-			for ( int pixelInd = range.start; pixelInd < range.end; ++pixelInd )
-			{
-				const Int x = pixelInd % width;
-				const Int y = pixelInd / width;
-
-				// Find ray-screen intersection.
-				const Real lambdaX = (Real(x) + 0.5) / Real(width);
-				const Real lambdaY = (Real(y) + 0.5) / Real(height);
-				const Real x0 =  halfSizeX * (2.0*lambdaX - 1.0);
-				const Real y0 = -halfSizeY * (2.0*lambdaY - 1.0);
-				const Real z0 = viewerDistance;
-
-				// Reset beta and B.
-				B = cv::Mat::zeros( numProjectors, numProjectors, RealType );
-				for ( Int i = 0; i < 3; betas[i++] = cv::Mat::zeros( numProjectors, 1, RealType ) );
-				// Evaluate beta and B.
-				for ( Int viewInd = 0; viewInd < numViewerPositions; ++viewInd )
+				for ( Int y = range.start; y < range.end; ++y )
 				{
-					const Vec3 viewPos = m_ObserverSpace->Position( viewInd );
-					const Color gtColor = groundtrue[viewInd].at<Color>(y,x);
-					// Evaluate weights.
-					Real sumWeights = 0;
-					w = cv::Mat::zeros( numProjectors, 1, RealType );
-					for ( Int projInd = 0; projInd < numProjectors; ++projInd )
+					for ( Int x = 0; x < width; ++x )
 					{
-						const Vec3 projPos = projectorPositions[projInd];
-						const Vec3 dirToProj = projPos - Vec3(x0,y0,z0);
-						const Vec3 dirToEye  = viewPos - Vec3(x0,y0,z0);
-						const Real weight = m_DiffuserModel->Diffusion( dirToProj, dirToEye );
-						if ( weight > 0.00001 )
+						// Find ray-screen intersection.
+						const Real lambdaX = (Real(x) + 0.5) / Real(width);
+						const Real lambdaY = (Real(y) + 0.5) / Real(height);
+						const Real x0 =  halfSizeX * (2.0*lambdaX - 1.0);
+						const Real y0 = -halfSizeY * (2.0*lambdaY - 1.0);
+						const Real z0 = viewerDistance;
+
+						// Reset beta and B.
+						B = cv::Mat::zeros( numProjectors, numProjectors, RealType );
+						for ( Int i = 0; i < 3; betas[i++] = cv::Mat::zeros( numProjectors, 1, RealType ) );
+						// Evaluate beta and B.
+						for ( Int viewInd = 0; viewInd < numViewerPositions; ++viewInd )
 						{
-							sumWeights += weight;
-							w.at<Real>(projInd,0) = weight;
+							const Vec3 viewPos = m_ObserverSpace->Position( viewInd );
+							const Color gtColor = ReadColor<GroundtrueElement>( groundtrue[viewInd], y, x );
+							// Evaluate weights.
+							Real sumWeights = 0;
+							w = cv::Mat::zeros( numProjectors, 1, RealType );
+							for ( Int projInd = 0; projInd < numProjectors; ++projInd )
+							{
+								const Vec3 projPos = projectorPositions[projInd];
+								const Vec3 dirToProj = projPos - Vec3(x0,y0,z0);
+								const Vec3 dirToEye  = viewPos - Vec3(x0,y0,z0);
+								const Real weight = m_DiffuserModel->Diffusion( dirToProj, dirToEye );
+								if ( weight > 0.00001 )
+								{
+									sumWeights += weight;
+									w.at<Real>(projInd,0) = weight;
+								}
+							}
+							// Normalize weights.
+							if ( sumWeights > 0.00001 )
+							{
+								for ( Int projInd = 0; projInd < numProjectors; ++projInd )
+								{
+									w.at<Real>(projInd,0) /= sumWeights;
+								}
+								sumWeights = 1.0;
+							}
+							// Add partial sum to B and beta.
+							for ( Int i = 0; i < numProjectors; ++i )
+							{
+								const Real weight = w.at<Real>(i,0);
+								for ( Int c = 0; c < 3; ++c )
+									betas[c].at<Real>(i,0) += weight * gtColor[c];
+								for ( Int j = 0; j < numProjectors; ++j )
+								{
+									const Real weight_j = w.at<Real>(j,0);
+									B.at<Real>(i,j) += weight * weight_j;
+								}
+							}
 						}
-					}
-					// Normalize weights.
-					if ( sumWeights > 0.00001 )
-					{
-						for ( Int projInd = 0; projInd < numProjectors; ++projInd )
-						{
-							w.at<Real>(projInd,0) /= sumWeights;
-						}
-						sumWeights = 1.0;
-					}
-					// Add partial sum to B and beta.
-					for ( Int i = 0; i < numProjectors; ++i )
-					{
-						const Real weight = w.at<Real>(i,0);
-						for ( Int c = 0; c < 3; ++c )
-							betas[c].at<Real>(i,0) += weight * gtColor[c];
-						for ( Int j = 0; j < numProjectors; ++j )
-						{
-							const Real weight_j = w.at<Real>(j,0);
-							B.at<Real>(i,j) += weight * weight_j;
-						}
-					}
-				}
-				// Normalize B and beta.
-				B /= Real(numViewerPositions);
-				for ( Int c = 0; c < 3; betas[c++] /= Real(numViewerPositions) );
+						// Normalize B and beta.
+						B /= Real(numViewerPositions);
+						for ( Int c = 0; c < 3; betas[c++] /= Real(numViewerPositions) );
 
-				// Iterate.
-				for ( Int iterInd = 0; iterInd < numIterations; ++iterInd )
-				{
-					const std::vector<cv::Mat>& prevIterImage = (iterInd == 0) ? zeroIteration : iterations[iterInd-1];
-					std::vector<cv::Mat>& curIterImage = iterations[iterInd];
-					for ( Int channelInd = 0; channelInd < 3; ++channelInd )
-					{
-						// Initialize variables.
-						const cv::Mat& beta = betas[channelInd];
-						for ( Int projInd = 0; projInd < numProjectors; ++projInd )
-							prev.at<Real>(projInd,0) = prevIterImage[projInd].at<Color>(y,x)[channelInd];
-						// Calculate gradient: gradient = B*R - beta.
-						gradient = B*prev - beta;
-						// Calculate descent: descent[i] = gradient[i]/B[i,i].
-						for ( Int i = 0; i < numProjectors; ++i )
-						{
-							Real prev_val = prev.at<Real>(i,0);
-							Real descent_val = 0;
-							const Real B_diagval = B.at<Real>(i,i);
-							if ( B_diagval > 0.00001 )
-								descent_val = gradient.at<Real>(i,0) / B_diagval;
-							if ( descent_val < 0 && prev_val >= 1 ) descent_val = 0;
-							if ( descent_val > 0 && prev_val <= 0 ) descent_val = 0;
-							descent.at<Real>(i,0) = descent_val;
-						}
-						// Calculate optimal step value: lambda = (descent.gradient)/(descent.B.descent).
-						const Real lambda_nom = descent.dot( gradient );
-						const Real lambda_denom = descent.dot( B * descent );
-						const Real lambda = (lambda_denom > 0.000001) ? lambda_nom / lambda_denom : 0;
-						// Calculate new iteration value.
-						cur = prev - lambda * descent;
-						// Store result to the image.
-						for ( Int i = 0; i < numProjectors; ++i )
+						// Iterate.
+						for ( Int iterInd = 0; iterInd < numIterations; ++iterInd )
 						{
-							Real cur_val = cur.at<Real>(i,0);
-							cur_val = std::min<Real>( std::max<Real>( cur_val, 0 ), 1 );
-							curIterImage[i].at<Color>(y,x)[channelInd] = cur_val;
+							const std::vector<cv::Mat>& prevIterImage = (iterInd == 0) ? zeroIteration : iterations[iterInd-1];
+							std::vector<cv::Mat>& curIterImage = iterations[iterInd];
+							for ( Int channelInd = 0; channelInd < 3; ++channelInd )
+							{
+								// Initialize variables.
+								const cv::Mat& beta = betas[channelInd];
+								for ( Int projInd = 0; projInd < numProjectors; ++projInd )
+									prev.at<Real>(projInd,0) = ReadColor<IterationElement>( prevIterImage[projInd], y, x )[channelInd];
+								// Calculate gradient: gradient = B*R - beta.
+								gradient = B*prev - beta;
+								// Calculate descent: descent[i] = gradient[i]/B[i,i].
+								for ( Int i = 0; i < numProjectors; ++i )
+								{
+									Real prev_val = prev.at<Real>(i,0);
+									Real descent_val = 0;
+									const Real B_diagval = B.at<Real>(i,i);
+									if ( B_diagval > 0.00001 )
+										descent_val = gradient.at<Real>(i,0) / B_diagval;
+									if ( descent_val < 0 && prev_val >= 1 ) descent_val = 0;
+									if ( descent_val > 0 && prev_val <= 0 ) descent_val = 0;
+									descent.at<Real>(i,0) = descent_val;
+								}
+								// Calculate optimal step value: lambda = (descent.gradient)/(descent.B.descent).
+								const Real lambda_nom = descent.dot( gradient );
+								const Real lambda_denom = descent.dot( B * descent );
+								const Real lambda = (lambda_denom > 0.000001) ? lambda_nom / lambda_denom : 0;
+								// Calculate new iteration value.
+								cur = prev - lambda * descent;
+								// Store result to the image.
+								for ( Int i = 0; i < numProjectors; ++i )
+								{
+									Real cur_val = cur.at<Real>(i,0);
+									cur_val = std::min<Real>( std::max<Real>( cur_val, 0 ), 1 );
+									WriteColorChannel<IterationElement>( curIterImage[i], y, x, channelInd, cur_val );
+								}
+							}
 						}
 					}
 				}
-			}
-		} );
+			} );
+	};
+
+	auto dispatchIterations = [&]( auto groundtrueElement )
+	{
+		if ( imageType == CV_16FC3 )
+			iterate( groundtrueElement, cv::float16_t() );
+		else
+			iterate( groundtrueElement, float() );
+	};
+	if ( groundtrueType == CV_16FC3 )
+		dispatchIterations( cv::float16_t() );
+	else
+		dispatchIterations( float() );
 
 
 	return true;
@@ -20,6 +20,7 @@ public:
 		const DisplayProjectorAligned* displayModel,
 		const ObserverSpace* viewerSpace );
 
+	// Images may be CV_32FC3 or CV_16FC3, the same within each set; iterations are stored in the format of 'zeroIteration'.
 	bool Iterate(
 		const std::vector<cv::Mat>& groundtrue, // Ground-true images for each position in the observer space.
 		const std::vector<cv::Mat>& zeroIteration, // Initial set of projector images.
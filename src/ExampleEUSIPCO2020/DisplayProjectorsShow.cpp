@@ -4,13 +4,17 @@
 #include "DiffuserTanBased.h"
 #include "DisplayProjectorAligned.h"
 
+#include "DirtyRegion.h"
 #include "RayGenPinhole.h"
 #include "SampleAccumCV.h"
 #include "SampleGenUniform.h"
+#include "TileRenderEngine.h"
 
 #include "Image.h"
+#include "ImagePixel.h"
 
 
+#include <cmath>
 #include <cstdlib>
 
 
@@ -38,7 +42,10 @@ bool DisplayProjectorsShow::LoadScene( const std::string& filepath )
 	for (int i = 0; i < numProjectorsTotal; ++i)
 	{
 		const std::string image_filepath = (ss() << filepath << "/" << std::setfill('0') << std::setw(4) << i << ".exr").str();
-		success = success && LoadImageRGB( image_filepath, ProjectorImages[i] );
+		if ( HalfPrecisionImages )
+			success = success && LoadImageRGBHalf( image_filepath, ProjectorImages[i] );
+		else
+			success = success && LoadImageRGB( image_filepath, ProjectorImages[i] );
 	}
 	return success;
 }
@@ -87,30 +94,13 @@ bool DisplayProjectorsShow::Render( const lfrt::RayGenerator& raygen, const lfrt
 		return false;
 	if ( ProjectorImages.size() != ProjectorPositions.size() )
 		return false;
+	const int imageType = ProjectorImages[0].type();
 	for ( auto image = ProjectorImages.begin(); image != ProjectorImages.end(); ++image )
 	{
-		if ( image->cols != width || image->rows != height || image->type() != CV_32FC3 )
+		if ( image->cols != width || image->rows != height || image->type() != imageType || !IsColorImage( *image ) )
 			return false;
 	}
 
-	Int globStartX;
-	Int globStartY;
-	Int globEndX;
-	Int globEndY;
-	if ( !sampleAccum.GetRenderBounds( globStartX, globStartY, globEndX, globEndY ) )
-		return false;
-	if ( globStartX < 0 || globStartX >= globEndX ||
-		globStartY < 0 || globStartY >= globEndY )
-		return false;
-
-	const Int globSizeX = globEndX - globStartX;
-	const Int globSizeY = globEndY - globStartY;
-
-	const Int tileSize = 16;
-
-	const Int numTilesX = (globSizeX + tileSize - 1) / tileSize;
-	const Int numTilesY = (globSizeY + tileSize - 1) / tileSize;
-
 	const Int numProjectorsTotal = ProjectorPositions.size();
 	const Real viewerDistance = m_DisplayModel->ViewerDistance;
 	const Real halfSizeX = m_DisplayModel->HalfPhysSize[0];
@@ -118,110 +108,135 @@ bool DisplayProjectorsShow::Render( const lfrt::RayGenerator& raygen, const lfrt
 	const Real diffusionRho = m_DisplayModel->DiffusionPower[0];
 	const Real diffusionEta = m_DisplayModel->DiffusionPower[1];
 
-	cv::parallel_for_( cv::Range( 0, numTilesX*numTilesY ),
-		[&]( const cv::Range& range )
+	// Maps eye ray to the diffuser-weighted blend of all projectors at the screen point.
+	// AOV depth is the distance to the screen, and id is the index of the projector with the largest weight.
+	// Is instantiated for the element type of projector images.
+	auto makeShader = [&]( auto element )
+	{
+		using Element = decltype( element );
+		return [&]( const lfrt::VEC3& ori, const lfrt::VEC3& dir, Real& r, Real& g, Real& b, lfrt::SampleAOV& aov ) -> bool
 		{
-			std::unique_ptr<lfrt::SampleGenerator> sampler( sampleGen.Clone() );
-
-			Real weightSample;
-			Real weightRay;
-			lfrt::VEC2 raster;
-			lfrt:: VEC2 secondary;
-			Real time;
-			lfrt::VEC3 ori;
-			lfrt::VEC3 dir;
-			Real r, g, b;
-
-			for ( int tileInd = range.start; tileInd < range.end; ++tileInd )
+			if ( dir.z <= 0 )
+				return false;
+
+			// Find ray-screen intersection.
+			const Real z0 = viewerDistance;
+			const Real x0 = ori.x + (z0 - ori.z) * dir.x / dir.z;
+			const Real y0 = ori.y + (z0 - ori.z) * dir.y / dir.z;
+
+			const Real texLambdaX = 0.5 * (1.0 + x0/halfSizeX);
+			const Real texLambdaY = 0.5 * (1.0 - y0/halfSizeY);
+
+			if ( texLambdaX < 0 || texLambdaX > 1.0 ||
+				 texLambdaY < 0 || texLambdaY > 1.0 )
+				return false;
+
+			const Int xProj = std::min<Int>( std::max<Int>( Int(texLambdaX*width) , 0 ), width-1 );
+			const Int yProj = std::min<Int>( std::max<Int>( Int(texLambdaY*height), 0 ), height-1 );
+
+			// Iterate over all projectors and add the contribution of each projector.
+			Real weightSum = 0.0;
+			Real weightMax = 0.0;
+			Color colorSum = Color(0,0,0);
+			aov.id = -1;
+			for ( Int projInd = 0; projInd < numProjectorsTotal; ++projInd )
 			{
-				const Int tileIndX = tileInd % numTilesX;
-				const Int tileIndY = tileInd / numTilesX;
-
-				const Int tileStartX = globStartX + tileIndX * tileSize;
-				const Int tileStartY = globStartY + tileIndY * tileSize;
-
-				lfrt::SampleTile* tile = sampleAccum.CreateSampleTile(
-					tileStartX, tileStartY, tileStartX+tileSize, tileStartY+tileSize );
-
-				for ( Int xLoc = 0; xLoc < tileSize; ++xLoc )
+				const Vec3 projPos = ProjectorPositions[projInd];
+				const Vec3 dirToProj = projPos - Vec3(x0,y0,z0);
+				const Vec3 dirToEye  = Vec3( ori.x - x0, ori.y - y0, ori.z - z0 );
+				const Real weight = m_DiffuserModel->Diffusion( dirToProj, dirToEye );
+				if ( weight >= 0.00001 )
 				{
-					for ( Int yLoc = 0; yLoc < tileSize; ++yLoc )
+					const Color projColor = ReadColor<Element>( ProjectorImages[projInd], yProj, xProj );
+					colorSum += weight*projColor;
+					weightSum += weight;
+					if ( weight > weightMax )
 					{
-						const Int x = tileStartX + xLoc;
-						const Int y = tileStartY + yLoc;
-
-						if ( x >= width || y >= height )
-							continue;
-
-						sampler->ResetPixel( x, y );
-
-						do
-						{
-							if ( !sampler->CurrentSample( weightSample, raster, secondary, time ) )
-								continue;
-							weightRay = raygen.GenerateRay( raster, secondary, ori, dir );
-							if ( weightRay == 0 )
-								continue;
-
-							if ( dir.z <= 0 )
-								continue;
-
-							// Find ray-screen intersection.
-							const Real z0 = viewerDistance;
-							const Real x0 = ori.x + (z0 - ori.z) * dir.x / dir.z;
-							const Real y0 = ori.y + (z0 - ori.z) * dir.y / dir.z;
-
-							const Real texLambdaX = 0.5 * (1.0 + x0/halfSizeX);
-							const Real texLambdaY = 0.5 * (1.0 - y0/halfSizeY);
-
-							if ( texLambdaX < 0 || texLambdaX > 1.0 ||
-								 texLambdaY < 0 || texLambdaY > 1.0 )
-								continue;
-
-							const Int xProj = std::min<Int>( std::max<Int>( Int(texLambdaX*width) , 0 ), width-1 );
-							const Int yProj = std::min<Int>( std::max<Int>( Int(texLambdaY*height), 0 ), height-1 );
-
-							// Iterate over all projectors and add the contribution of each projector.
-							Real weightSum = 0.0;
-							Color colorSum = Color(0,0,0);
-							for ( Int projInd = 0; projInd < numProjectorsTotal; ++projInd )
-							{
-								const Vec3 projPos = ProjectorPositions[projInd];
-								const Vec3 dirToProj = projPos - Vec3(x0,y0,z0);
-								const Vec3 dirToEye  = Vec3( ori.x - x0, ori.y - y0, ori.z - z0 );
-								const Real weight = m_DiffuserModel->Diffusion( dirToProj, dirToEye );
-								if ( weight >= 0.00001 )
-								{
-									const Color projColor = ProjectorImages[projInd].at<Color>(yProj,xProj);
-									colorSum += weight*projColor;
-									weightSum += weight;
-								}
-							}
-
-							if ( weightSum >= 0.00001 )
-							{
-								r = colorSum[2] / weightSum;
-								g = colorSum[1] / weightSum;
-								b = colorSum[0] / weightSum;
-							}
-							else
-							{
-								r = 0;
-								g = 0;
-								b = 0;
-							}
-
-							tile->AddSample( raster, secondary, weightSample, weightRay, r, g, b );
-						}
-						while ( sampler->MoveToNextSample() );
+						weightMax = weight;
+						aov.id = projInd;
 					}
 				}
+			}
 
-				sampleAccum.MergeSampleTile( tile );
-				sampleAccum.DestroySampleTile( tile );
+			if ( weightSum >= 0.00001 )
+			{
+				r = colorSum[2] / weightSum;
+				g = colorSum[1] / weightSum;
+				b = colorSum[0] / weightSum;
 			}
-		}
-	);
+			else
+			{
+				r = 0;
+				g = 0;
+				b = 0;
+			}
+
+			const Real dirLength = std::sqrt( dir.x*dir.x + dir.y*dir.y + dir.z*dir.z );
+			aov.depth = dirLength * (z0 - ori.z) / dir.z;
+			aov.normal = { 0, 0, -1 };
+			return true;
+		};
+	};
+
+	if ( imageType == CV_16FC3 )
+		return Engine.Render( raygen, sampleGen, sampleAccum, makeShader( cv::float16_t() ) );
+	return Engine.Render( raygen, sampleGen, sampleAccum, makeShader( float() ) );
+}
 
+
+bool DisplayProjectorsShow::FindAffectedPixels( const lfrt::RayGenerator& raygen, const Int& width, const Int& height,
+	const cv::Rect& changedPixels, cv::Mat& mask ) const
+{
+	if ( m_DisplayModel == nullptr )
+		return false;
+	if ( width <= 0 || height <= 0 )
+		return false;
+
+	const Int projWidth  = m_DisplayModel->ProjectorResolution[0];
+	const Int projHeight = m_DisplayModel->ProjectorResolution[1];
+	const cv::Rect changed = changedPixels & cv::Rect( 0, 0, int(projWidth), int(projHeight) );
+	const Real viewerDistance = m_DisplayModel->ViewerDistance;
+	const Real halfSizeX = m_DisplayModel->HalfPhysSize[0];
+	const Real halfSizeY = m_DisplayModel->HalfPhysSize[1];
+
+	if ( changed.empty() )
+	{
+		mask = cv::Mat::zeros( int(height), int(width), CV_8UC1 );
+		return true;
+	}
+
+	// Screen intersection is affine in the ray footprint, so the bounding box of footprint hits
+	// contains all projector pixels which the shader can read for this output pixel.
+	auto isAffected = [&]( const PixelFootprint& footprint ) -> bool
+	{
+		Real minX = projWidth;
+		Real minY = projHeight;
+		Real maxX = 0;
+		Real maxY = 0;
+		for ( Int rayInd = 0; rayInd < PixelFootprint::NumRays; ++rayInd )
+		{
+			const lfrt::VEC3& ori = footprint.ori[rayInd];
+			const lfrt::VEC3& dir = footprint.dir[rayInd];
+			if ( dir.z <= 0 )
+				return true;
+			const Real z0 = viewerDistance;
+			const Real x0 = ori.x + (z0 - ori.z) * dir.x / dir.z;
+			const Real y0 = ori.y + (z0 - ori.z) * dir.y / dir.z;
+			const Real texLambdaX = 0.5 * (1.0 + x0/halfSizeX);
+			const Real texLambdaY = 0.5 * (1.0 - y0/halfSizeY);
+			minX = std::min( minX, texLambdaX*projWidth );
+			minY = std::min( minY, texLambdaY*projHeight );
+			maxX = std::max( maxX, texLambdaX*projWidth );
+			maxY = std::max( maxY, texLambdaY*projHeight );
+		}
+		// Lookups are clamped to the image.
+		minX = std::min<Real>( std::max<Real>( minX, 0 ), projWidth-1 );
+		minY = std::min<Real>( std::max<Real>( minY, 0 ), projHeight-1 );
+		maxX = std::min<Real>( std::max<Real>( maxX, 0 ), projWidth-1 );
+		maxY = std::min<Real>( std::max<Real>( maxY, 0 ), projHeight-1 );
+		return OverlapsPixelRect( minX, minY, maxX, maxY, changed );
+	};
+
+	::FindAffectedPixels( raygen, width, height, isAffected, mask );
 	return true;
-}
\ No newline at end of file
+}
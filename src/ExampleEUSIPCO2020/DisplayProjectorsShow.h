@@ -3,6 +3,7 @@
 
 #include "BaseTypes.h"
 #include "LFRayTracer.h"
+#include "TileRenderEngine.h"
 
 #include <opencv2/opencv.hpp>
 
@@ -36,9 +37,18 @@ public:
 
 	virtual bool Render( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen, lfrt::SampleAccumulator& sampleAccum ) const override;
 
+	// Marks pixels of a 'width' x 'height' output image (CV_8UC1) which can see the given projector pixels.
+	// Projectors are aligned, so the rectangle applies to the image of any projector.
+	// Mapping is conservative for RayGenPinhole and RayGenFocusEye.
+	// Pass the mask to MultiPassAccumulator::SetDirtyMask to re-render only the affected pixels.
+	bool FindAffectedPixels( const lfrt::RayGenerator& raygen, const Int& width, const Int& height,
+		const cv::Rect& changedPixels, cv::Mat& mask ) const;
+
 public:
-	std::vector<cv::Mat> ProjectorImages;
+	std::vector<cv::Mat> ProjectorImages; // All CV_32FC3 or all CV_16FC3.
 	std::vector<Vec3> ProjectorPositions;
+	TileRenderEngine Engine; // Tile size, order and threading of Render.
+	bool HalfPrecisionImages = false; // If true, LoadScene stores projector images as CV_16FC3.
 
 private:
 	const DisplayProjectorAligned* m_DisplayModel = nullptr;
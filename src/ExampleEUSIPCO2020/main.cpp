@@ -2,12 +2,14 @@
 
 #include <cstdlib>
 #include <fstream>
+#include <functional>
 
 #include "LFRayTracerPBRT.h"
 
 #include "Image.h"
 #include "ImageAnalysis.h"
 #include "SampleAccumCV.h"
+#include "SampleAccumLayered.h"
 #include "SampleGenUniform.h"
 
 #include "DisplayProjectorAligned.h"
@@ -15,6 +17,7 @@
 #include "DisplayProjectorsOptimization.h"
 #include "DisplayProjectorsShow.h"
 
+#include "RayGenMultiView.h"
 #include "RayGenPinhole.h"
 #include "ObserverSpace.h"
 
@@ -29,6 +32,9 @@ const DisplayProjectorAligned::ProjectorLine ProjectorLine({ Vec3(-1000,0,800),
 const DisplayProjectorAligned::Diffuser DiffuserType = DisplayProjectorAligned::Diffuser::Linear;
 const Vec2 DiffusionPower = Vec2(40,0);
 
+// Number of views rendered by one Render call; limits the size of the view atlas.
+const Int ViewsPerRender = 8;
+
 
 using namespace lfrt;
 using ss = std::stringstream;
@@ -48,6 +54,36 @@ bool StatisticsToFile( const std::vector<Vec3>& statistics, const std::string& f
 }
 
 
+// Renders views 0..numViews-1 into "folder/xxxx.exr".
+// Several views are put into one atlas, so that they share a single Render call.
+bool RenderViews( const LFRayTracer& raytracer, const SampleGenerator& sampleGen,
+    const Int& width, const Int& height, const Int& numViews,
+    const std::function<RayGenerator*( const Int& viewInd )>& createView,
+    const std::string& folder )
+{
+    SampleAccumLayered sampleAccum( width, height, std::min( numViews, ViewsPerRender ) );
+    std::vector<cv::Mat> images;
+    for ( Int firstView = 0; firstView < numViews; firstView += ViewsPerRender )
+    {
+        const Int numBatchViews = std::min( ViewsPerRender, numViews - firstView );
+        RayGenMultiView raygen( width, height );
+        for ( Int viewInd = firstView; viewInd < firstView + numBatchViews; ++viewInd )
+            raygen.AddView( std::shared_ptr<const RayGenerator>( createView( viewInd ) ) );
+        if ( sampleAccum.NumLayers() != numBatchViews && !sampleAccum.SetLayers( width, height, numBatchViews ) )
+            return false;
+        if ( !raytracer.Render( raygen, sampleGen, sampleAccum ) )
+            return false;
+        sampleAccum.SaveLayersToImages( images );
+        for ( Int layer = 0; layer < numBatchViews; ++layer )
+        {
+            const std::string image_filepath = (ss() << folder << "/" << std::setfill('0') << std::setw(4) << (firstView + layer) << ".exr").str();
+            cv::imwrite( image_filepath, images[layer] );
+        }
+    }
+    return true;
+}
+
+
 int main( int argc, char** argv )
 {
     std::cout << "Hello world" << std::endl;
@@ -101,16 +137,19 @@ int main( int argc, char** argv )
     }
 
     // Rendering helper classes.
-    std::shared_ptr<const RayGenerator> raygen = nullptr;
     std::shared_ptr<SampleGenerator> sampleGen( new SampleGenUniform(3) );
-    SampleAccumCV* sampleAccumCV = new SampleAccumCV( width, height );
-    std::shared_ptr<SampleAccumulator> sampleAccum( sampleAccumCV );
-    cv::Mat result;
 
     // Display data.
     const Real halfSizeX = display.HalfPhysSize[0];
     const Real halfSizeY = display.HalfPhysSize[1];
 
+    // Pinhole camera of the observer at the given position.
+    auto createObserverView = [&]( const Int& viewInd ) -> RayGenerator*
+    {
+        const Vec3 pos = observerSpace.Position( viewInd );
+        return new RayGenPinhole( width, height, -halfSizeX, -halfSizeY, halfSizeX, halfSizeY, display.ViewerDistance, pos[0], pos[1] );
+    };
+
     // Process the choice.
     switch ( choice )
     {
@@ -118,28 +157,24 @@ int main( int argc, char** argv )
         std::system( "mkdir GroundTrueImages" );
         LFRayTracer* raytracer = LFRayTracerPBRTInstance();
         raytracer->LoadScene( argv[1] );
-        for ( Int viewInd = 0; viewInd < numViewerPositions; ++viewInd )
+        if ( !RenderViews( *raytracer, *sampleGen, width, height, numViewerPositions, createObserverView, "GroundTrueImages" ) )
         {
-            const Vec3 pos = observerSpace.Position( viewInd );
-            const std::string image_filepath = (ss() << "GroundTrueImages" << "/" << std::setfill('0') << std::setw(4) << viewInd << ".exr").str();
-            raygen.reset( new RayGenPinhole( width, height, -halfSizeX, -halfSizeY, halfSizeX, halfSizeY, display.ViewerDistance, pos[0], pos[1] ) );
-            raytracer->Render( *raygen, *sampleGen, *sampleAccum );
-            sampleAccumCV->SaveToImage( result );
-            cv::imwrite( image_filepath, result );
+            std::cout << "Could not render images! Terminate!" << std::endl;
+            return 1;
         }
         } break;
     case 2: {
         std::system( "mkdir ProjectorImages_0000" );
         LFRayTracer* raytracer = LFRayTracerPBRTInstance();
         raytracer->LoadScene( argv[1] );
-        for ( Int i = 0; i < numProjectors; ++i )
+        auto createProjectorView = [&]( const Int& projInd ) -> RayGenerator*
+        {
+            return new DisplayProjectorsCapture( &display, projectorPositions[projInd] );
+        };
+        if ( !RenderViews( *raytracer, *sampleGen, width, height, numProjectors, createProjectorView, "ProjectorImages_0000" ) )
         {
-            const Vec3 pos = projectorPositions[i];
-            const std::string image_filepath = (ss() << "ProjectorImages_0000" << "/" << std::setfill('0') << std::setw(4) << i << ".exr").str();
-            raygen.reset( new DisplayProjectorsCapture( &display, pos ) );
-            raytracer->Render( *raygen, *sampleGen, *sampleAccum );
-            sampleAccumCV->SaveToImage( result );
-            cv::imwrite( image_filepath, result );
+            std::cout << "Could not render images! Terminate!" << std::endl;
+            return 1;
         }
         } break;
     case 3: {
@@ -150,14 +185,10 @@ int main( int argc, char** argv )
             std::cout << "Could not load projector images! Terminate!" << std::endl;
             return 1;
         }
-        for ( Int viewInd = 0; viewInd < numViewerPositions; ++viewInd )
+        if ( !RenderViews( show, *sampleGen, width, height, numViewerPositions, createObserverView, "PerceivedImages_0000" ) )
         {
-            const Vec3 pos = observerSpace.Position( viewInd );
-            const std::string image_filepath = (ss() << "PerceivedImages_0000" << "/" << std::setfill('0') << std::setw(4) << viewInd << ".exr").str();
-            raygen.reset( new RayGenPinhole( width, height, -halfSizeX, -halfSizeY, halfSizeX, halfSizeY, display.ViewerDistance, pos[0], pos[1] ) );
-            show.Render( *raygen, *sampleGen, *sampleAccum );
-            sampleAccumCV->SaveToImage( result );
-            cv::imwrite( image_filepath, result );
+            std::cout << "Could not render images! Terminate!" << std::endl;
+            return 1;
         }
         } break;
     case 4: {
@@ -218,14 +249,10 @@ int main( int argc, char** argv )
                 std::cout << "Could not load projector images! Terminate!" << std::endl;
                 return 1;
             }
-            for ( Int viewInd = 0; viewInd < numViewerPositions; ++viewInd )
+            if ( !RenderViews( show, *sampleGen, width, height, numViewerPositions, createObserverView, folder_perceived ) )
             {
-                const Vec3 pos = observerSpace.Position( viewInd );
-                const std::string image_filepath = (ss() << folder_perceived << "/" << std::setfill('0') << std::setw(4) << viewInd << ".exr").str();
-                raygen.reset( new RayGenPinhole( width, height, -halfSizeX, -halfSizeY, halfSizeX, halfSizeY, display.ViewerDistance, pos[0], pos[1] ) );
-                show.Render( *raygen, *sampleGen, *sampleAccum );
-                sampleAccumCV->SaveToImage( result );
-                cv::imwrite( image_filepath, result );
+                std::cout << "Could not render images! Terminate!" << std::endl;
+                return 1;
             }
         }
         } break;
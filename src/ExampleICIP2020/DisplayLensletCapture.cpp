@@ -28,7 +28,7 @@ Real DisplayLensletCapture::GenerateRay( const VEC2& raster, const VEC2& seconda
 	const Vec2& eiShiftInv = DisplayModel->EIShiftInv();
 	const Mat22& eiOrientationInv = DisplayModel->EIOrientationInv();
 	const Vec2 eiIndReal = eiShiftInv + eiOrientationInv * eiPos2D;
-	const Vec2i eiInd = Vec2i( std::round(eiIndReal[0]), std::round(eiIndReal[1]) );
+	const Vec2i eiInd = DisplayModel->EICells().Cell( eiIndReal );
 
 	const Vec2i lensletInd = eiInd;
 	const Vec2 lensletIndReal = lensletInd;
@@ -50,7 +50,11 @@ Real DisplayLensletCapture::GenerateRay( const VEC2& raster, const VEC2& seconda
 		Vec2 lensletPos2D = lensletCenter2D;
 		if ( SamplingType == Sampling::LensletAverage )
 		{
-			const Vec2 shiftArg( secondary.x - 0.5, secondary.y - 0.5 );
+			Vec2 shiftArg( secondary.x - 0.5, secondary.y - 0.5 );
+			// Parallelogram and Voronoi cells have the same area, so wrapping the shift keeps sampling uniform.
+			const LatticeCellLookup& lensletCells = DisplayModel->LensletCells();
+			if ( lensletCells.Shape() == LatticeCellLookup::CellShape::Voronoi )
+				shiftArg -= Vec2( lensletCells.Cell( shiftArg ) );
 			lensletPos2D += lensletOrientation * shiftArg;
 		}
 		const Vec2 eiDir2D = (eiPos2D - lensletPos2D) / distLensletToLCD;
@@ -89,3 +93,155 @@ Real DisplayLensletCapture::GenerateRay( const VEC2& raster, const VEC2& seconda
 	dir.z = 1;
 	return 1;
 }
+
+
+void DisplayLensletCapture::GenerateRays( const Int& count, const VEC2* raster, const VEC2* secondary, const lfrt::RayBatch& rays ) const
+{
+	if ( DisplayModel == nullptr )
+	{
+		for ( Int i = 0; i < count; ++i )
+			rays.weight[i] = 0;
+		return;
+	}
+
+	// Same math as in GenerateRay, but with all matrices unrolled into scalars
+	// and the sampling switch hoisted out of the loop.
+	const Real resX = DisplayModel->ResolutionLCD[0];
+	const Real resY = DisplayModel->ResolutionLCD[1];
+	const Real lcdSizeX = DisplayModel->SizeLCD[0];
+	const Real lcdSizeY = DisplayModel->SizeLCD[1];
+
+	const Vec2& eiShiftInv = DisplayModel->EIShiftInv();
+	const Mat22& eiOrientationInv = DisplayModel->EIOrientationInv();
+	const Vec2& lensletShift = DisplayModel->LensletShift();
+	const Mat22& lensletOrientation = DisplayModel->LensletOrientation();
+	const LatticeCellLookup& eiCells = DisplayModel->EICells();
+	const LatticeCellLookup& lensletCells = DisplayModel->LensletCells();
+	const bool isVoronoi = lensletCells.Shape() == LatticeCellLookup::CellShape::Voronoi;
+
+	const Real eiS0 = eiShiftInv[0];
+	const Real eiS1 = eiShiftInv[1];
+	const Real eiM00 = eiOrientationInv(0,0);
+	const Real eiM01 = eiOrientationInv(0,1);
+	const Real eiM10 = eiOrientationInv(1,0);
+	const Real eiM11 = eiOrientationInv(1,1);
+	const Real lS0 = lensletShift[0];
+	const Real lS1 = lensletShift[1];
+	const Real lM00 = lensletOrientation(0,0);
+	const Real lM01 = lensletOrientation(0,1);
+	const Real lM10 = lensletOrientation(1,0);
+	const Real lM11 = lensletOrientation(1,1);
+
+	const Real focalLength = DisplayModel->LensletFocalLength;
+	const Real distLensletToLCD = DisplayModel->LensletToLCD;
+	const Real distLensletToOrigin = DisplayModel->LensletToOrigin;
+
+	const bool isAverage = SamplingType == Sampling::LensletAverage;
+	const Real pupilDenom = 1.0/distLensletToOrigin + 1.0/distLensletToLCD - 1.0/focalLength;
+
+	for ( Int i = 0; i < count; ++i )
+	{
+		const Real rasterX = raster[i].x;
+		const Real rasterY = raster[i].y;
+		const bool isInside = rasterX >= 0 && rasterX <= resX && rasterY >= 0 && rasterY <= resY;
+
+		const Real eiPosX = (-0.5 + rasterX / resX) * lcdSizeX;
+		const Real eiPosY = ( 0.5 - rasterY / resY) * lcdSizeY;
+		const Vec2i ind = eiCells.Cell( eiS0 + eiM00*eiPosX + eiM01*eiPosY, eiS1 + eiM10*eiPosX + eiM11*eiPosY );
+		const Real indX = ind[0];
+		const Real indY = ind[1];
+		const Real centerX = lS0 + lM00*indX + lM01*indY;
+		const Real centerY = lS1 + lM10*indX + lM11*indY;
+
+		Real viewerX = 0;
+		Real viewerY = 0;
+		Real dirX = 0;
+		Real dirY = 0;
+
+		if ( SamplingType == Sampling::PupilCenter )
+		{
+			// See GenerateRay for derivation.
+			const Real x1X = ((-centerX)/distLensletToOrigin + (eiPosX - centerX)/distLensletToLCD) / pupilDenom;
+			const Real x1Y = ((-centerY)/distLensletToOrigin + (eiPosY - centerY)/distLensletToLCD) / pupilDenom;
+			dirX = (centerX + x1X) / distLensletToOrigin;
+			dirY = (centerY + x1Y) / distLensletToOrigin;
+		}
+		else if ( SamplingType == Sampling::LensletCenter || isAverage )
+		{
+			Real shiftX = isAverage ? secondary[i].x - 0.5 : 0.0;
+			Real shiftY = isAverage ? secondary[i].y - 0.5 : 0.0;
+			if ( isAverage && isVoronoi )
+			{
+				const Vec2i wrap = lensletCells.Cell( shiftX, shiftY );
+				shiftX -= wrap[0];
+				shiftY -= wrap[1];
+			}
+			const Real offsetX = lM00*shiftX + lM01*shiftY;
+			const Real offsetY = lM10*shiftX + lM11*shiftY;
+			const Real lensletX = centerX + offsetX;
+			const Real lensletY = centerY + offsetY;
+			dirX = (eiPosX - lensletX) / distLensletToLCD + offsetX / focalLength;
+			dirY = (eiPosY - lensletY) / distLensletToLCD + offsetY / focalLength;
+			viewerX = lensletX - dirX * distLensletToOrigin;
+			viewerY = lensletY - dirY * distLensletToOrigin;
+		}
+
+		rays.oriX[i] = viewerX;
+		rays.oriY[i] = viewerY;
+		rays.oriZ[i] = 0;
+		rays.dirX[i] = dirX;
+		rays.dirY[i] = dirY;
+		rays.dirZ[i] = 1;
+		rays.weight[i] = isInside ? Real(1) : Real(0);
+	}
+}
+
+
+Real DisplayLensletCapture::GenerateRayDifferential(
+	const VEC2& raster, const VEC2& secondary,
+	VEC3& ori, VEC3& dir,
+	VEC3& oridx, VEC3& dirdx,
+	VEC3& oridy, VEC3& dirdy ) const
+{
+	const Real weight = GenerateRay( raster, secondary, ori, dir );
+	oridx = oridy = dirdx = dirdy = { 0, 0, 0 };
+	if ( weight <= 0 )
+		return weight;
+
+	// Lenslet index is piecewise constant, so inside one elemental image
+	// only the LCD position depends on raster coordinates.
+	const Real eiPosDx =  DisplayModel->SizeLCD[0] / Real(DisplayModel->ResolutionLCD[0]);
+	const Real eiPosDy = -DisplayModel->SizeLCD[1] / Real(DisplayModel->ResolutionLCD[1]);
+	const Real v01 = DisplayModel->LensletToOrigin;
+	const Real v12 = DisplayModel->LensletToLCD;
+	const Real f = DisplayModel->LensletFocalLength;
+
+	switch ( SamplingType )
+	{
+	case Sampling::LensletCenter:
+	case Sampling::LensletAverage:
+		// rayDir2D = (eiPos2D - lensletPos2D) / v12 + const; viewerPos2D = lensletPos2D - rayDir2D * v01.
+		dirdx.x = eiPosDx / v12;
+		dirdy.y = eiPosDy / v12;
+		oridx.x = -dirdx.x * v01;
+		oridy.y = -dirdy.y * v01;
+		break;
+	case Sampling::PupilCenter: {
+		// rayDir2D = (lensletCenter2D + x1) / v01, where x1 is linear in eiPos2D.
+		const Real coef = 1.0 / ( v12 * v01 * (1.0/v01 + 1.0/v12 - 1.0/f) );
+		dirdx.x = eiPosDx * coef;
+		dirdy.y = eiPosDy * coef;
+		} break;
+	default:
+		break;
+	}
+	return weight;
+}
+
+
+unsigned DisplayLensletCapture::UsedDimensions() const
+{
+	if ( SamplingType == Sampling::LensletAverage )
+		return lfrt::SampleDimAll;
+	return lfrt::SampleDimRaster;
+}
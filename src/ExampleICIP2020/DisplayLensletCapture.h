@@ -34,6 +34,19 @@ public:
         const VEC2& raster, const VEC2& secondary,
         VEC3& ori, VEC3& dir ) const override;
 
+    virtual void GenerateRays(
+        const Int& count, const VEC2* raster, const VEC2* secondary,
+        const lfrt::RayBatch& rays ) const override;
+
+    virtual Real GenerateRayDifferential(
+        const VEC2& raster, const VEC2& secondary,
+        VEC3& ori, VEC3& dir,
+        VEC3& oridx, VEC3& dirdx,
+        VEC3& oridy, VEC3& dirdy ) const override;
+
+    // Secondary coordinates are used only for lenslet averaging.
+    virtual unsigned UsedDimensions() const override;
+
 
 public:
     const DisplayLenslet* DisplayModel = nullptr;
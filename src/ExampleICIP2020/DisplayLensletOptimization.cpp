@@ -0,0 +1,188 @@
+#include "DisplayLensletOptimization.h"
+
+#include "DisplayLenslet.h"
+#include "DisplayLensletShow.h"
+
+#include "ImagePixel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+DisplayLensletOptimization::DisplayLensletOptimization( const DisplayLensletShow* simulation )
+	:m_Simulation(simulation)
+{
+}
+
+
+bool DisplayLensletOptimization::AddView( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen,
+	const Int& width, const Int& height )
+{
+	if ( m_Simulation == nullptr || m_Simulation->DisplayModel == nullptr )
+		return false;
+	const Int lcdWidth = m_Simulation->DisplayModel->ResolutionLCD[0];
+	const Int lcdHeight = m_Simulation->DisplayModel->ResolutionLCD[1];
+
+	std::shared_ptr<SparseMatrix> transport( new SparseMatrix() );
+	if ( !m_Simulation->BuildSparseOperator( raygen, sampleGen, width, height, *transport ) )
+		return false;
+	if ( transport->Cols() != lcdWidth * lcdHeight )
+		return false;
+
+	// Accumulate diagonal of A^T*A, i.e., squared column norms, for the preconditioner.
+	if ( m_Diagonal.empty() )
+		m_Diagonal = cv::Mat::zeros( lcdHeight, lcdWidth, CV_32FC1 );
+	float* diagonal = m_Diagonal.ptr<float>( 0 );
+	const std::vector<std::int32_t>& colIndices = transport->ColIndices();
+	const std::vector<float>& values = transport->Values();
+	for ( std::size_t i = 0; i < values.size(); ++i )
+		diagonal[colIndices[i]] += values[i] * values[i];
+
+	m_Transports.push_back( transport );
+	m_ViewSizes.push_back( cv::Size( width, height ) );
+	return true;
+}
+
+
+void DisplayLensletOptimization::ClearViews()
+{
+	m_Transports.clear();
+	m_ViewSizes.clear();
+	m_Diagonal = cv::Mat();
+}
+
+
+bool DisplayLensletOptimization::Iterate(
+	const std::vector<cv::Mat>& groundtrue, // Ground-true images for each view, in the order of AddView.
+	const cv::Mat& zeroIteration, // Initial display image.
+	std::vector<cv::Mat>& iterations, // Array of display images; don't initialize it.
+	const Int numIterations ) const
+{
+	// +++++ Initialize basic parameters and make sanity check. +++++
+
+	if ( m_Simulation == nullptr || m_Simulation->DisplayModel == nullptr )
+		return false;
+	if ( numIterations <= 0 )
+		return false;
+
+	const Int numViews = NumViews();
+	if ( numViews <= 0 )
+		return false;
+	if ( groundtrue.size() != std::size_t(numViews) )
+		return false;
+
+	const Int width = m_Simulation->DisplayModel->ResolutionLCD[0];
+	const Int height = m_Simulation->DisplayModel->ResolutionLCD[1];
+	const cv::Size lcdSize( width, height );
+	if ( zeroIteration.cols != width || zeroIteration.rows != height || !IsColorImage( zeroIteration ) )
+		return false;
+
+	// Iterate in float; ground truth and the initial image are converted once.
+	std::vector<cv::Mat> targets( numViews );
+	for ( Int viewInd = 0; viewInd < numViews; ++viewInd )
+	{
+		const cv::Mat& image = groundtrue[viewInd];
+		if ( image.size() != m_ViewSizes[viewInd] || !IsColorImage( image ) )
+			return false;
+		image.convertTo( targets[viewInd], CV_32FC3 );
+	}
+	cv::Mat cur;
+	zeroIteration.convertTo( cur, CV_32FC3 );
+	cur = cv::max( cur, 0.0 );
+	cur = cv::min( cur, 1.0 );
+
+	// Iterations are stored in the same format as the initial image.
+	const int imageType = zeroIteration.type();
+	iterations.resize( numIterations );
+	// ----- Initialize basic parameters and make sanity check. -----
+
+	// Minimized error is (1/N) * sum of |A*R - gt|^2 / 2 over views, so that
+	// gradient = B*R - beta with B = (1/N) * sum of A^T*A, beta = (1/N) * sum of A^T*gt.
+	const Real invNumViews = 1.0 / Real(numViews);
+	cv::Mat gradient;
+	cv::Mat descent( lcdSize, CV_32FC3 );
+	cv::Mat residual;
+	cv::Mat viewGradient;
+	for ( Int iterInd = 0; iterInd < numIterations; ++iterInd )
+	{
+		// Calculate gradient.
+		gradient = cv::Mat::zeros( lcdSize, CV_32FC3 );
+		for ( Int viewInd = 0; viewInd < numViews; ++viewInd )
+		{
+			const SparseMatrix& transport = *m_Transports[viewInd];
+			if ( !transport.Multiply( cur, residual, m_ViewSizes[viewInd] ) )
+				return false;
+			residual -= targets[viewInd];
+			if ( !transport.MultiplyTransposed( residual, viewGradient, lcdSize ) )
+				return false;
+			gradient += viewGradient;
+		}
+		gradient *= invNumViews;
+
+		// Calculate descent: descent[i] = gradient[i]/B[i,i], projected onto the bounds.
+		// Parallelize over LCD rows.
+		cv::parallel_for_( cv::Range( 0, height ),
+			[&](const cv::Range& range)
+			{
+				for ( Int y = range.start; y < range.end; ++y )
+				{
+					const Color* prevRow = cur.ptr<Color>( y );
+					const Color* gradientRow = gradient.ptr<Color>( y );
+					const float* diagonalRow = m_Diagonal.ptr<float>( y );
+					Color* descentRow = descent.ptr<Color>( y );
+					for ( Int x = 0; x < width; ++x )
+					{
+						const Real B_diagval = invNumViews * diagonalRow[x];
+						for ( Int c = 0; c < 3; ++c )
+						{
+							const Real prev_val = prevRow[x][c];
+							Real descent_val = 0;
+							if ( B_diagval > 0.00001 )
+								descent_val = gradientRow[x][c] / B_diagval;
+							if ( descent_val < 0 && prev_val >= 1 ) descent_val = 0;
+							if ( descent_val > 0 && prev_val <= 0 ) descent_val = 0;
+							descentRow[x][c] = float( descent_val );
+						}
+					}
+				}
+			} );
+
+		// Calculate optimal step value per channel: lambda = (descent.gradient)/(descent.B.descent).
+		const cv::Scalar lambda_nom = cv::sum( descent.mul( gradient ) );
+		cv::Scalar lambda_denom = cv::Scalar::all( 0 );
+		for ( Int viewInd = 0; viewInd < numViews; ++viewInd )
+		{
+			if ( !m_Transports[viewInd]->Multiply( descent, residual, m_ViewSizes[viewInd] ) )
+				return false;
+			lambda_denom += cv::sum( residual.mul( residual ) );
+		}
+		lambda_denom *= invNumViews;
+		Color lambda;
+		for ( Int c = 0; c < 3; ++c )
+			lambda[c] = (lambda_denom[c] > 0.000001) ? float( lambda_nom[c] / lambda_denom[c] ) : 0.0f;
+
+		// Calculate new iteration value, clamped to the bounds.
+		cv::parallel_for_( cv::Range( 0, height ),
+			[&](const cv::Range& range)
+			{
+				for ( Int y = range.start; y < range.end; ++y )
+				{
+					Color* curRow = cur.ptr<Color>( y );
+					const Color* descentRow = descent.ptr<Color>( y );
+					for ( Int x = 0; x < width; ++x )
+					{
+						for ( Int c = 0; c < 3; ++c )
+						{
+							const float cur_val = curRow[x][c] - lambda[c] * descentRow[x][c];
+							curRow[x][c] = std::min<float>( std::max<float>( cur_val, 0 ), 1 );
+						}
+					}
+				}
+			} );
+
+		// Store result.
+		cur.convertTo( iterations[iterInd], imageType );
+	}
+
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef DISPLAYLENSLETOPTIMIZATION_H
+#define DISPLAYLENSLETOPTIMIZATION_H
+
+#include "BaseTypes.h"
+#include "LFRayTracer.h"
+#include "SparseMatrix.h"
+
+#include <memory>
+#include <vector>
+
+class DisplayLensletShow;
+
+
+// Solves for the LCD image whose simulated retinal images match ground-true images of a set of views
+// (eye positions and focus distances) in the least-squares sense, with LCD values in [0,1].
+// Light transport of every view is precomputed as a sparse matrix (DisplayLensletShow::BuildSparseOperator),
+// so that iterations do not trace rays.
+class DisplayLensletOptimization
+{
+public:
+	using Color = cv::Vec3f;
+
+public:
+
+	DisplayLensletOptimization( const DisplayLensletShow* simulation );
+
+	// Precomputes light transport of a view with the current lookup settings of the simulation (filter, footprint scale).
+	// Eye ray generator and sample generator are as for rendering its 'width' x 'height' retinal image.
+	bool AddView( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen, const Int& width, const Int& height );
+
+	Int NumViews() const { return Int(m_Transports.size()); }
+
+	void ClearViews();
+
+	// Images may be CV_32FC3 or CV_16FC3; iterations are stored in the format of 'zeroIteration'.
+	// Any display image of LCD resolution can be used as the initial one, e.g., the output of DisplayLensletCapture;
+	// it is clamped to [0,1] first.
+	bool Iterate(
+		const std::vector<cv::Mat>& groundtrue, // Ground-true images for each view, in the order of AddView.
+		const cv::Mat& zeroIteration, // Initial display image.
+		std::vector<cv::Mat>& iterations, // Array of display images; don't initialize it.
+		const Int numIterations ) const;
+
+private:
+	const DisplayLensletShow* m_Simulation = nullptr;
+	std::vector< std::shared_ptr<SparseMatrix> > m_Transports;
+	std::vector<cv::Size> m_ViewSizes;
+	cv::Mat m_Diagonal = cv::Mat(); // Diagonal of sum of A^T*A over views, CV_32FC1 of LCD size.
+};
+
+
+#endif // DISPLAYLENSLETOPTIMIZATION_H
@@ -1,12 +1,25 @@
 #include "DisplayLensletShow.h"
 
+#include "DirtyRegion.h"
 #include "DisplayLenslet.h"
+#include "MipMap.h"
 #include "RayGenPinhole.h"
+#include "RenderKernel.h"
 #include "SampleAccumCV.h"
 #include "SampleGenUniform.h"
+#include "SparseMatrix.h"
+#include "TileRenderEngine.h"
 
 #include "Image.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
 DisplayLensletShow::DisplayLensletShow( const DisplayLenslet* displayModel )
 	:DisplayModel(displayModel)
 {
@@ -46,17 +59,223 @@ lfrt::SampleAccumulator* DisplayLensletShow::CreateDefaultSampleAccumulator( con
 }
 
 
+namespace
+{
+
+// Mapping of eye rays through the lenslet array onto LCD pixel coordinates.
+// For a fixed lenslet, the mapping is affine in ray origin and direction tangents.
+struct LensletMapping
+{
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+	using VEC3 = lfrt::VEC3;
+
+	explicit LensletMapping( const DisplayLenslet& model )
+		:lcdresX(model.ResolutionLCD[0])
+		,lcdresY(model.ResolutionLCD[1])
+		,lcdSizeX(model.SizeLCD[0])
+		,lcdSizeY(model.SizeLCD[1])
+		,distLensletToOrigin(model.LensletToOrigin)
+		,distLensletToLCD(model.LensletToLCD)
+		,focalLength(model.LensletFocalLength)
+		,isLensletVertical(model.IsLensletVertical)
+		,lensletShift(model.LensletShift())
+		,lensletOrientation(model.LensletOrientation())
+		,lensletShiftInv(model.LensletShiftInv())
+		,lensletOrientationInv(model.LensletOrientationInv())
+		,lensletCells(model.LensletCells())
+	{
+	}
+
+	// Intersection of ray with lenslet plane, and the continuous lenslet index there; see lensletCells for the lenslet.
+	// Ray must go towards the display.
+	void LensletHit( const VEC3& ori, const VEC3& dir, Real& lensletX, Real& lensletY, Vec2& lensletIndReal ) const
+	{
+		lensletX = ori.x + dir.x / dir.z * ( distLensletToOrigin - ori.z );
+		lensletY = ori.y + dir.y / dir.z * ( distLensletToOrigin - ori.z );
+		lensletIndReal = lensletShiftInv + lensletOrientationInv * Vec2(lensletX,lensletY);
+	}
+
+	// Continuous LCD pixel coordinates of the ray refracted by the given lenslet.
+	void LCDPixel( const VEC3& dir, const Real& lensletX, const Real& lensletY,
+		const Int& lensletIndX, const Int& lensletIndY, Real& lcdPixelX, Real& lcdPixelY ) const
+	{
+		const Vec2 lensletCenter = lensletShift + lensletOrientation * Vec2(lensletIndX,lensletIndY);
+
+		Real lcdPosX = 0;
+		Real lcdPosY = 0;
+
+		if ( isLensletVertical )
+		{
+			// ToDo
+		}
+		else
+		{
+			// ToDo: consider tilted lens.
+			const Real lcdDirTanX = dir.x / dir.z - (lensletX - lensletCenter[0]) / focalLength;
+			const Real lcdDirTanY = dir.y / dir.z - (lensletY - lensletCenter[1]) / focalLength;
+			lcdPosX = lensletX + lcdDirTanX * distLensletToLCD;
+			lcdPosY = lensletY + lcdDirTanY * distLensletToLCD;
+		}
+
+		const Real lcdLambdaX = 0.5 + lcdPosX / lcdSizeX;
+		const Real lcdLambdaY = 0.5 - lcdPosY / lcdSizeY;
+
+		lcdPixelX = lcdLambdaX * lcdresX;
+		lcdPixelY = lcdLambdaY * lcdresY;
+	}
+
+	// Continuous LCD pixel coordinates of the ray offset by the given differential, refracted by the given lenslet.
+	// False if the offset ray does not go towards the display.
+	bool OffsetLCDPixel( const VEC3& ori, const VEC3& dir, const VEC3& dOri, const VEC3& dDir,
+		const Int& lensletIndX, const Int& lensletIndY, Real& lcdPixelX, Real& lcdPixelY ) const
+	{
+		const VEC3 offsetOri({ ori.x + dOri.x, ori.y + dOri.y, ori.z + dOri.z });
+		const VEC3 offsetDir({ dir.x + dDir.x, dir.y + dDir.y, dir.z + dDir.z });
+		if ( offsetDir.z <= 0 )
+			return false;
+		Real lensletX;
+		Real lensletY;
+		Vec2 lensletIndReal;
+		LensletHit( offsetOri, offsetDir, lensletX, lensletY, lensletIndReal );
+		LCDPixel( offsetDir, lensletX, lensletY, lensletIndX, lensletIndY, lcdPixelX, lcdPixelY );
+		return true;
+	}
+
+	const Int lcdresX;
+	const Int lcdresY;
+	const Real lcdSizeX;
+	const Real lcdSizeY;
+	const Real distLensletToOrigin;
+	const Real distLensletToLCD;
+	const Real focalLength;
+	const bool isLensletVertical;
+	const Vec2 lensletShift;
+	const Mat22 lensletOrientation;
+	const Vec2 lensletShiftInv;
+	const Mat22 lensletOrientationInv;
+	const LatticeCellLookup& lensletCells;
+};
+
+// Footprints which cover more lenslets than this are marked as affected without further checks.
+const lfrt::Int MaxFootprintLenslets = 64;
+
+// LCD lookup settings shared by Render and BuildLookupTable.
+struct LCDLookup
+{
+	using Int = lfrt::Int;
+	using VEC3 = lfrt::VEC3;
+	using LCDFilter = DisplayLensletShow::LCDFilter;
+
+	LCDFilter filter = LCDFilter::Nearest;
+	MipMap mipMap; // Built only for filtered lookups.
+	// Differentials of eye rays with respect to output raster coordinates, scaled by footprint scale.
+	VEC3 oriDx, dirDx, oriDy, dirDy;
+	Int maxAnisotropy = 8;
+};
+
+
+// Prepares lookup of an image of the display's LCD resolution.
+// Differentials are taken once at the image center; they are constant for the affine eye models.
+bool PrepareLCDLookup( const DisplayLensletShow& show, const cv::Mat& lcdImage,
+	const lfrt::RayGenerator& raygen, const lfrt::Int& width, const lfrt::Int& height, LCDLookup& lookup )
+{
+	using Real = lfrt::Real;
+	using VEC3 = lfrt::VEC3;
+	lookup.filter = show.Filter;
+	lookup.maxAnisotropy = show.MaxAnisotropy;
+	if ( show.Filter == DisplayLensletShow::LCDFilter::Nearest )
+		return true;
+	if ( !lookup.mipMap.Build( lcdImage ) )
+		return false;
+	VEC3 ori, dir;
+	const lfrt::VEC2 center({ 0.5*width, 0.5*height });
+	raygen.GenerateRayDifferential( center, lfrt::VEC2({ 0.5, 0.5 }), ori, dir, lookup.oriDx, lookup.dirDx, lookup.oriDy, lookup.dirDy );
+	const Real scale = show.FootprintScale;
+	for ( VEC3* diff : { &lookup.oriDx, &lookup.dirDx, &lookup.oriDy, &lookup.dirDy } )
+		*diff = { diff->x * scale, diff->y * scale, diff->z * scale };
+	return true;
+}
+
+
+// Visits LCD texels which the eye ray sees, as
+//     visitor( const Int& level, const Int& x, const Int& y, const float& weight ),
+// where level is the mip level (always 0 for nearest lookup).
+// Returns false if the ray misses the LCD; 'lcdPixelX' and 'lcdPixelY' are the continuous LCD coordinates of the hit.
+template< class VisitorT >
+bool VisitLCDTexels( const LensletMapping& mapping, const LCDLookup& lookup,
+	const lfrt::VEC3& ori, const lfrt::VEC3& dir, VisitorT& visitor, lfrt::Real& lcdPixelX, lfrt::Real& lcdPixelY )
+{
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+
+	if ( dir.z <= 0 )
+		return false;
+
+	// Find intersection of ray with lenslet plane, and the lenslet there.
+	Real lensletX;
+	Real lensletY;
+	Vec2 lensletIndReal;
+	mapping.LensletHit( ori, dir, lensletX, lensletY, lensletIndReal );
+	const Vec2i lensletInd = mapping.lensletCells.Cell( lensletIndReal );
+	const Int lensletIndX = lensletInd[0];
+	const Int lensletIndY = lensletInd[1];
+
+	mapping.LCDPixel( dir, lensletX, lensletY, lensletIndX, lensletIndY, lcdPixelX, lcdPixelY );
+
+	if ( lcdPixelX < 0 || lcdPixelX > mapping.lcdresX ||
+		 lcdPixelY < 0 || lcdPixelY > mapping.lcdresY )
+		return false;
+
+	if ( lookup.filter == DisplayLensletShow::LCDFilter::Nearest )
+	{
+		// Right and bottom LCD edges belong to the last pixel.
+		const Int x = std::min<Int>( Int(lcdPixelX), mapping.lcdresX-1 );
+		const Int y = std::min<Int>( Int(lcdPixelY), mapping.lcdresY-1 );
+		visitor( 0, x, y, 1.0f );
+		return true;
+	}
+
+	// Footprint axes are LCD offsets of the neighbouring pixels' rays through the same lenslet.
+	Real lcdPixelDx[2] = { 0, 0 };
+	Real lcdPixelDy[2] = { 0, 0 };
+	if ( mapping.OffsetLCDPixel( ori, dir, lookup.oriDx, lookup.dirDx, lensletIndX, lensletIndY, lcdPixelDx[0], lcdPixelDx[1] ) )
+	{
+		lcdPixelDx[0] -= lcdPixelX;
+		lcdPixelDx[1] -= lcdPixelY;
+	}
+	if ( mapping.OffsetLCDPixel( ori, dir, lookup.oriDy, lookup.dirDy, lensletIndX, lensletIndY, lcdPixelDy[0], lcdPixelDy[1] ) )
+	{
+		lcdPixelDy[0] -= lcdPixelX;
+		lcdPixelDy[1] -= lcdPixelY;
+	}
+	if ( lookup.filter == DisplayLensletShow::LCDFilter::Trilinear )
+	{
+		const Real widthX = std::sqrt( lcdPixelDx[0]*lcdPixelDx[0] + lcdPixelDx[1]*lcdPixelDx[1] );
+		const Real widthY = std::sqrt( lcdPixelDy[0]*lcdPixelDy[0] + lcdPixelDy[1]*lcdPixelDy[1] );
+		lookup.mipMap.VisitTrilinear( lcdPixelX, lcdPixelY, std::max( widthX, widthY ), 1.0f, visitor );
+	}
+	else
+	{
+		lookup.mipMap.VisitAnisotropic( lcdPixelX, lcdPixelY,
+			lcdPixelDx[0], lcdPixelDx[1], lcdPixelDy[0], lcdPixelDy[1], lookup.maxAnisotropy, 1.0f, visitor );
+	}
+	return true;
+}
+
+
+} // namespace
+
+
 bool DisplayLensletShow::Render( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen, lfrt::SampleAccumulator& sampleAccum ) const
 {
 	if ( DisplayModel == nullptr )
 		return false;
 
-	const Int lcdresX = DisplayModel->ResolutionLCD[0];
-	const Int lcdresY = DisplayModel->ResolutionLCD[1];
-	const Real lcdSizeX = DisplayModel->SizeLCD[0];
-	const Real lcdSizeY = DisplayModel->SizeLCD[1];
+	const LensletMapping mapping( *DisplayModel );
+	const Int lcdresX = mapping.lcdresX;
 
-	if ( DisplayImage.cols != lcdresX || DisplayImage.rows != lcdresY )
+	if ( DisplayImage.cols != lcdresX || DisplayImage.rows != mapping.lcdresY )
 		return false;
 	if ( DisplayImage.type() != CV_32FC3 )
 		return false;
@@ -66,139 +285,367 @@ bool DisplayLensletShow::Render( const lfrt::RayGenerator& raygen, const lfrt::S
 	if ( width <= 0 || height <= 0 )
 		return false;
 
-	Int globStartX;
-	Int globStartY;
-	Int globEndX;
-	Int globEndY;
-	if ( !sampleAccum.GetRenderBounds( globStartX, globStartY, globEndX, globEndY ) )
-		return false;
-	if ( globStartX < 0 || globStartX >= globEndX ||
-		 globStartY < 0 || globStartY >= globEndY )
+	LCDLookup lookup;
+	if ( !PrepareLCDLookup( *this, DisplayImage, raygen, width, height, lookup ) )
 		return false;
 
-	const Int globSizeX = globEndX - globStartX;
-	const Int globSizeY = globEndY - globStartY;
+	// Maps eye ray to the color of the LCD seen through the lenslet array.
+	// AOV depth is the distance to the lenslet plane, and id is the row-major index of the LCD pixel.
+	auto shader = [&]( const VEC3& ori, const VEC3& dir, Real& r, Real& g, Real& b, lfrt::SampleAOV& aov ) -> bool
+	{
+		Color color( 0, 0, 0 );
+		auto sumColor = [&]( const Int& level, const Int& x, const Int& y, const float& weight )
+		{
+			const cv::Mat& image = (level == 0) ? DisplayImage : lookup.mipMap.Level( level );
+			color += weight * image.ptr<Color>( y )[x];
+		};
+		Real lcdPixelX;
+		Real lcdPixelY;
+		if ( !VisitLCDTexels( mapping, lookup, ori, dir, sumColor, lcdPixelX, lcdPixelY ) )
+			return false;
+
+		r = color[2];
+		g = color[1];
+		b = color[0];
+
+		const Real dirLength = std::sqrt( dir.x*dir.x + dir.y*dir.y + dir.z*dir.z );
+		aov.depth = dirLength * ( mapping.distLensletToOrigin - ori.z ) / dir.z;
+		aov.normal = { 0, 0, -1 };
+		aov.id = Int(lcdPixelY) * lcdresX + Int(lcdPixelX);
+		return true;
+	};
+
+	return Engine.Render( raygen, sampleGen, sampleAccum, shader );
+}
 
-	const Int tileSize = 16;
 
-	const Int numTilesX = (globSizeX + tileSize - 1) / tileSize;
-	const Int numTilesY = (globSizeY + tileSize - 1) / tileSize;
+bool DisplayLensletShow::BuildLookupTable( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen,
+	const Int& width, const Int& height, LookupTable& table ) const
+{
+	if ( DisplayModel == nullptr )
+		return false;
+	if ( width <= 0 || height <= 0 )
+		return false;
 
-	const Real distLensletToOrigin = DisplayModel->LensletToOrigin;
-	const Real distLensletToLCD = DisplayModel->LensletToLCD;
-	const Real focalLength = DisplayModel->LensletFocalLength;
+	const LensletMapping mapping( *DisplayModel );
+	if ( mapping.lcdresX <= 0 || mapping.lcdresY <= 0 )
+		return false;
 
-	const bool isLensletVertical = DisplayModel->IsLensletVertical;
-	const Vec2& lensletShift = DisplayModel->LensletShift();
-	const Mat22& lensletOrientation = DisplayModel->LensletOrientation();
-	const Vec2& lensletShiftInv = DisplayModel->LensletShiftInv();
-	const Mat22& lensletOrientationInv = DisplayModel->LensletOrientationInv();
+	// Only the pyramid layout matters, so it is built for an empty image of the LCD size.
+	LCDLookup lookup;
+	const cv::Mat lcdImage = cv::Mat::zeros( int(mapping.lcdresY), int(mapping.lcdresX), CV_32FC3 );
+	if ( !PrepareLCDLookup( *this, lcdImage, raygen, width, height, lookup ) )
+		return false;
+	const bool usesPyramid = lookup.filter != LCDFilter::Nearest;
+	if ( usesPyramid && lookup.mipMap.NumTexels() > std::numeric_limits<std::uint32_t>::max() )
+		return false;
 
-	cv::parallel_for_( cv::Range( 0, numTilesX*numTilesY ),
-		[&]( const cv::Range& range )
+	// Rows are processed in parallel into separate lists, which are concatenated afterwards.
+	using Entry = std::pair<std::uint32_t,float>;
+	std::vector< std::vector<Entry> > rowEntries( height );
+	std::vector< std::vector<std::uint32_t> > rowPixelSizes( height );
+	cv::parallel_for_( cv::Range( 0, int(height) ), [&]( const cv::Range& range )
 		{
 			std::unique_ptr<lfrt::SampleGenerator> sampler( sampleGen.Clone() );
+			sampler->SetUsedDimensions( raygen.UsedDimensions() );
+			RenderKernelBuffers buffers;
+			std::vector<Entry> pixelEntries;
+			for ( Int y = range.start; y < range.end; ++y )
+			{
+				std::vector<Entry>& entries = rowEntries[y];
+				std::vector<std::uint32_t>& pixelSizes = rowPixelSizes[y];
+				pixelSizes.resize( width );
+				for ( Int x = 0; x < width; ++x )
+				{
+					sampler->ResetPixel( x, y );
+					buffers.Reserve( sampler->NumSamplesInPixel() );
+					const Int numSamples = sampler->GeneratePixelSamples(
+						x, y, buffers.sampleWeights.data(), buffers.rasters.data(), buffers.secondaries.data() );
+					const lfrt::RayBatch& rays = buffers.rays.Batch();
+					raygen.GenerateRays( numSamples, buffers.rasters.data(), buffers.secondaries.data(), rays );
+
+					// Same weighting as in SampleAccumCV: missed rays do not contribute to the normalization.
+					pixelEntries.clear();
+					Real sumWeights = 0;
+					for ( Int sampleInd = 0; sampleInd < numSamples; ++sampleInd )
+					{
+						const float sampleWeight = float( buffers.sampleWeights[sampleInd] * rays.weight[sampleInd] );
+						if ( sampleWeight == 0 )
+							continue;
+						const VEC3 ori({ rays.oriX[sampleInd], rays.oriY[sampleInd], rays.oriZ[sampleInd] });
+						const VEC3 dir({ rays.dirX[sampleInd], rays.dirY[sampleInd], rays.dirZ[sampleInd] });
+						auto record = [&]( const Int& level, const Int& texelX, const Int& texelY, const float& weight )
+						{
+							const std::size_t index = usesPyramid ?
+								lookup.mipMap.TexelIndex( level, texelX, texelY ) : std::size_t(texelY) * mapping.lcdresX + texelX;
+							pixelEntries.push_back( Entry( std::uint32_t(index), weight * sampleWeight ) );
+						};
+						Real lcdPixelX;
+						Real lcdPixelY;
+						if ( VisitLCDTexels( mapping, lookup, ori, dir, record, lcdPixelX, lcdPixelY ) )
+							sumWeights += sampleWeight;
+					}
 
-			Real weightSample;
-			Real weightRay;
-			VEC2 raster;
-			VEC2 secondary;
-			Real time;
-			VEC3 ori;
-			VEC3 dir;
-			Real r, g, b;
+					// Merge repeated texels and normalize.
+					std::sort( pixelEntries.begin(), pixelEntries.end(),
+						[]( const Entry& a, const Entry& b ) { return a.first < b.first; } );
+					const std::size_t pixelStart = entries.size();
+					for ( const Entry& entry : pixelEntries )
+					{
+						if ( entry.second == 0 )
+							continue;
+						if ( entries.size() > pixelStart && entries.back().first == entry.first )
+							entries.back().second += entry.second;
+						else
+							entries.push_back( entry );
+					}
+					const float invSum = sumWeights > 0 ? float( 1.0 / sumWeights ) : 0.0f;
+					for ( std::size_t i = pixelStart; i < entries.size(); ++i )
+						entries[i].second *= invSum;
+					pixelSizes[x] = std::uint32_t( entries.size() - pixelStart );
+				}
+			}
+		} );
+
+	table.Width = width;
+	table.Height = height;
+	table.LCDWidth = mapping.lcdresX;
+	table.LCDHeight = mapping.lcdresY;
+	table.UsesPyramid = usesPyramid;
+	table.PixelStarts.resize( std::size_t(width) * height + 1 );
+	std::size_t numEntries = 0;
+	for ( Int y = 0; y < height; ++y )
+		numEntries += rowEntries[y].size();
+	table.TexelIndices.resize( numEntries );
+	table.Weights.resize( numEntries );
+	std::size_t pixelInd = 0;
+	std::size_t entryInd = 0;
+	for ( Int y = 0; y < height; ++y )
+	{
+		const std::vector<Entry>& entries = rowEntries[y];
+		std::size_t pixelStart = entryInd;
+		for ( Int x = 0; x < width; ++x )
+		{
+			table.PixelStarts[pixelInd++] = pixelStart;
+			pixelStart += rowPixelSizes[y][x];
+		}
+		for ( std::size_t i = 0; i < entries.size(); ++i )
+		{
+			table.TexelIndices[entryInd + i] = entries[i].first;
+			table.Weights[entryInd + i] = entries[i].second;
+		}
+		entryInd += entries.size();
+		// Release row lists as soon as they are copied.
+		std::vector<Entry>().swap( rowEntries[y] );
+	}
+	table.PixelStarts[pixelInd] = entryInd;
+	return true;
+}
 
-			for ( int tileInd = range.start; tileInd < range.end; ++tileInd )
-			{
-				const Int tileIndX = tileInd % numTilesX;
-				const Int tileIndY = tileInd / numTilesX;
 
-				const Int tileStartX = globStartX + tileIndX * tileSize;
-				const Int tileStartY = globStartY + tileIndY * tileSize;
+bool DisplayLensletShow::RenderLookupTable( const LookupTable& table, cv::Mat& image ) const
+{
+	if ( DisplayImage.cols != table.LCDWidth || DisplayImage.rows != table.LCDHeight )
+		return false;
+	if ( DisplayImage.type() != CV_32FC3 )
+		return false;
+	if ( table.Width <= 0 || table.Height <= 0 ||
+		 table.PixelStarts.size() != std::size_t(table.Width) * table.Height + 1 )
+		return false;
 
-				lfrt::SampleTile* tile = sampleAccum.CreateSampleTile(
-					tileStartX, tileStartY, tileStartX+tileSize, tileStartY+tileSize );
+	// Texels in the order of table indices: the flattened pyramid, or the LCD image itself.
+	std::vector<Color> pyramidTexels;
+	cv::Mat lcdImage;
+	const Color* texels = nullptr;
+	if ( table.UsesPyramid )
+	{
+		MipMap mipMap;
+		if ( !mipMap.Build( DisplayImage ) )
+			return false;
+		mipMap.Flatten( pyramidTexels );
+		texels = pyramidTexels.data();
+	}
+	else
+	{
+		lcdImage = DisplayImage.isContinuous() ? DisplayImage : DisplayImage.clone();
+		texels = lcdImage.ptr<Color>( 0 );
+	}
 
-				for ( Int xLoc = 0; xLoc < tileSize; ++xLoc )
+	image = cv::Mat( int(table.Height), int(table.Width), CV_32FC3 );
+	const std::uint64_t* pixelStarts = table.PixelStarts.data();
+	const std::uint32_t* texelIndices = table.TexelIndices.data();
+	const float* weights = table.Weights.data();
+	cv::parallel_for_( cv::Range( 0, int(table.Height) ), [&]( const cv::Range& range )
+		{
+			for ( Int y = range.start; y < range.end; ++y )
+			{
+				Color* row = image.ptr<Color>( y );
+				const std::uint64_t* starts = pixelStarts + std::size_t(y) * table.Width;
+				for ( Int x = 0; x < table.Width; ++x )
 				{
-					for ( Int yLoc = 0; yLoc < tileSize; ++yLoc )
+					float sum0 = 0;
+					float sum1 = 0;
+					float sum2 = 0;
+					const std::uint64_t end = starts[x+1];
+					for ( std::uint64_t i = starts[x]; i < end; ++i )
 					{
-						const Int x = tileStartX + xLoc;
-						const Int y = tileStartY + yLoc;
-						sampler->ResetPixel( x, y );
+						const Color& texel = texels[texelIndices[i]];
+						const float weight = weights[i];
+						sum0 += weight * texel[0];
+						sum1 += weight * texel[1];
+						sum2 += weight * texel[2];
+					}
+					row[x] = Color( sum0, sum1, sum2 );
+				}
+			}
+		} );
+	return true;
+}
 
-						do
-						{
-							if ( !sampler->CurrentSample( weightSample, raster, secondary, time ) )
-								continue;
-							weightRay = raygen.GenerateRay( raster, secondary, ori, dir );
-							if ( weightRay == 0 )
-								continue;
-
-							if ( dir.z <= 0 )
-								continue;
-
-							// Compute 2D direction in terms of tangent values.
-							const Real dirTanX = dir.x / dir.z;
-							const Real dirTanY = dir.y / dir.z;
-
-							// Find intersection of ray with plane z=0.
-							const Real viewerX = ori.x - dirTanX * ori.z;
-							const Real viewerY = ori.y - dirTanY * ori.z;
-
-							// Find intersection of ray with lenslet plane.
-							const Real lensletX = ori.x + dirTanX * ( distLensletToOrigin - ori.z );
-							const Real lensletY = ori.y + dirTanY * ( distLensletToOrigin - ori.z );
-
-							// Find lenslet index and lenslet center.
-							const Vec2 lensletIndReal = lensletShiftInv + lensletOrientationInv * Vec2(lensletX,lensletY);
-							const Int lensletIndX = std::round( lensletIndReal[0] );
-							const Int lensletIndY = std::round( lensletIndReal[1] );
-							const Vec2 lensletCenter = lensletShift + lensletOrientation * Vec2(lensletIndX,lensletIndY);
-
-							Real lcdPosX;
-							Real lcdPosY;
-
-							if ( isLensletVertical )
-							{
-								// ToDo
-							}
-							else
-							{
-								// ToDo: consider tilted lens.
-								const Real lcdDirTanX = dirTanX - (lensletX - lensletCenter[0]) / focalLength;
-								const Real lcdDirTanY = dirTanY - (lensletY - lensletCenter[1]) / focalLength;
-								lcdPosX = lensletX + lcdDirTanX * distLensletToLCD;
-								lcdPosY = lensletY + lcdDirTanY * distLensletToLCD;
-							}
-
-							const Real lcdLambdaX = 0.5 + lcdPosX / lcdSizeX;
-							const Real lcdLambdaY = 0.5 - lcdPosY / lcdSizeY;
-
-							const Real lcdPixelX = lcdLambdaX * lcdresX;
-							const Real lcdPixelY = lcdLambdaY * lcdresY;
-
-							if ( lcdPixelX < 0 || lcdPixelX > lcdresX ||
-								 lcdPixelY < 0 || lcdPixelY > lcdresY )
-								continue;
-
-							Color color = DisplayImage.at<Color>( Int(lcdPixelY), Int(lcdPixelX) );
-
-							r = color[2];
-							g = color[1];
-							b = color[0];
-
-							tile->AddSample( raster, secondary, weightSample, weightRay, r, g, b );
-						}
-						while ( sampler->MoveToNextSample() );
+
+bool DisplayLensletShow::BuildSparseOperator( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen,
+	const Int& width, const Int& height, SparseMatrix& matrix ) const
+{
+	LookupTable table;
+	if ( !BuildLookupTable( raygen, sampleGen, width, height, table ) )
+		return false;
+	const std::size_t numLCDPixels = std::size_t(table.LCDWidth) * table.LCDHeight;
+	if ( numLCDPixels > std::size_t( std::numeric_limits<std::int32_t>::max() ) )
+		return false;
+
+	// Pyramid texels are expanded row by row in parallel, like the table itself was built.
+	MipMap mipMap;
+	if ( table.UsesPyramid && !mipMap.Build( cv::Mat::zeros( int(table.LCDHeight), int(table.LCDWidth), CV_32FC3 ) ) )
+		return false;
+	std::vector< std::vector<std::int32_t> > rowIndices( height );
+	std::vector< std::vector<float> > rowValues( height );
+	std::vector< std::vector<std::int64_t> > rowPixelSizes( height );
+	cv::parallel_for_( cv::Range( 0, int(height) ), [&]( const cv::Range& range )
+		{
+			std::vector<MipMap::Texel> texels;
+			for ( Int y = range.start; y < range.end; ++y )
+			{
+				std::vector<std::int64_t>& pixelSizes = rowPixelSizes[y];
+				pixelSizes.resize( width );
+				for ( Int x = 0; x < width; ++x )
+				{
+					const std::size_t pixelInd = std::size_t(y) * width + x;
+					texels.clear();
+					for ( std::uint64_t i = table.PixelStarts[pixelInd]; i < table.PixelStarts[pixelInd+1]; ++i )
+						texels.push_back( MipMap::Texel( table.TexelIndices[i], table.Weights[i] ) );
+					if ( table.UsesPyramid )
+						mipMap.ExpandToBase( texels );
+					for ( const MipMap::Texel& texel : texels )
+					{
+						rowIndices[y].push_back( std::int32_t( texel.first ) );
+						rowValues[y].push_back( texel.second );
 					}
+					pixelSizes[x] = std::int64_t( texels.size() );
 				}
+			}
+		} );
+	// Table is not needed any more.
+	table = LookupTable();
+
+	std::vector<std::int64_t> rowStarts( std::size_t(width) * height + 1 );
+	std::size_t numEntries = 0;
+	for ( Int y = 0; y < height; ++y )
+		numEntries += rowValues[y].size();
+	std::vector<std::int32_t> colIndices;
+	std::vector<float> values;
+	colIndices.reserve( numEntries );
+	values.reserve( numEntries );
+	std::size_t pixelInd = 0;
+	for ( Int y = 0; y < height; ++y )
+	{
+		for ( Int x = 0; x < width; ++x )
+		{
+			rowStarts[pixelInd+1] = rowStarts[pixelInd] + rowPixelSizes[y][x];
+			++pixelInd;
+		}
+		colIndices.insert( colIndices.end(), rowIndices[y].begin(), rowIndices[y].end() );
+		values.insert( values.end(), rowValues[y].begin(), rowValues[y].end() );
+		std::vector<std::int32_t>().swap( rowIndices[y] );
+		std::vector<float>().swap( rowValues[y] );
+	}
+	return matrix.Assign( width * height, Int(numLCDPixels),
+		std::move( rowStarts ), std::move( colIndices ), std::move( values ) );
+}
 
-				sampleAccum.MergeSampleTile( tile );
-				sampleAccum.DestroySampleTile( tile );
+
+bool DisplayLensletShow::FindAffectedPixels( const lfrt::RayGenerator& raygen, const Int& width, const Int& height,
+	const cv::Rect& changedLCD, cv::Mat& mask ) const
+{
+	if ( DisplayModel == nullptr )
+		return false;
+	if ( width <= 0 || height <= 0 )
+		return false;
+
+	const LensletMapping mapping( *DisplayModel );
+	const cv::Rect changed = changedLCD & cv::Rect( 0, 0, int(mapping.lcdresX), int(mapping.lcdresY) );
+	if ( changed.empty() )
+	{
+		mask = cv::Mat::zeros( int(height), int(width), CV_8UC1 );
+		return true;
+	}
+
+	// Lenslet plane hits and lenslet indices are affine in the footprint rays, so their bounding box
+	// gives all lenslets which the pixel can see; through each of them, LCD coordinates are affine again.
+	auto isAffected = [&]( const PixelFootprint& footprint ) -> bool
+	{
+		Real lensletX[PixelFootprint::NumRays];
+		Real lensletY[PixelFootprint::NumRays];
+		Real minIndX = std::numeric_limits<Real>::max();
+		Real minIndY = std::numeric_limits<Real>::max();
+		Real maxIndX = std::numeric_limits<Real>::lowest();
+		Real maxIndY = std::numeric_limits<Real>::lowest();
+		for ( Int rayInd = 0; rayInd < PixelFootprint::NumRays; ++rayInd )
+		{
+			if ( footprint.dir[rayInd].z <= 0 )
+				return true;
+			Vec2 lensletIndReal;
+			mapping.LensletHit( footprint.ori[rayInd], footprint.dir[rayInd], lensletX[rayInd], lensletY[rayInd], lensletIndReal );
+			minIndX = std::min( minIndX, lensletIndReal[0] );
+			minIndY = std::min( minIndY, lensletIndReal[1] );
+			maxIndX = std::max( maxIndX, lensletIndReal[0] );
+			maxIndY = std::max( maxIndY, lensletIndReal[1] );
+		}
+
+		// Voronoi cells reach beyond the parallelogram ones.
+		const Int margin = mapping.lensletCells.Margin();
+		const Int startIndX = Int( std::round( minIndX ) ) - margin;
+		const Int startIndY = Int( std::round( minIndY ) ) - margin;
+		const Int endIndX = Int( std::round( maxIndX ) ) + 1 + margin;
+		const Int endIndY = Int( std::round( maxIndY ) ) + 1 + margin;
+		if ( (endIndX - startIndX) * (endIndY - startIndY) > MaxFootprintLenslets )
+			return true;
+
+		for ( Int lensletIndY = startIndY; lensletIndY < endIndY; ++lensletIndY )
+		{
+			for ( Int lensletIndX = startIndX; lensletIndX < endIndX; ++lensletIndX )
+			{
+				Real minX = std::numeric_limits<Real>::max();
+				Real minY = std::numeric_limits<Real>::max();
+				Real maxX = std::numeric_limits<Real>::lowest();
+				Real maxY = std::numeric_limits<Real>::lowest();
+				for ( Int rayInd = 0; rayInd < PixelFootprint::NumRays; ++rayInd )
+				{
+					Real lcdPixelX;
+					Real lcdPixelY;
+					mapping.LCDPixel( footprint.dir[rayInd], lensletX[rayInd], lensletY[rayInd],
+						lensletIndX, lensletIndY, lcdPixelX, lcdPixelY );
+					minX = std::min( minX, lcdPixelX );
+					minY = std::min( minY, lcdPixelY );
+					maxX = std::max( maxX, lcdPixelX );
+					maxY = std::max( maxY, lcdPixelY );
+				}
+				if ( OverlapsPixelRect( minX, minY, maxX, maxY, changed ) )
+					return true;
 			}
 		}
-	);
+		return false;
+	};
 
+	::FindAffectedPixels( raygen, width, height, isAffected, mask );
 	return true;
-}
\ No newline at end of file
+}
@@ -2,10 +2,15 @@
 #define DISPLAYLENSLETSHOW_H
 
 #include "LFRayTracer.h"
+#include "TileRenderEngine.h"
 
 #include <opencv2/opencv.hpp>
 
+#include <cstdint>
+#include <vector>
+
 class DisplayLenslet;
+class SparseMatrix;
 
 
 // Class for simulating the lenslet display visual output.
@@ -19,6 +24,31 @@ public:
 	using VEC3 = lfrt::VEC3;
 	using Color = cv::Vec3f;
 
+	// Lookup of the LCD image.
+	enum class LCDFilter
+	{
+		Nearest, // LCD pixel hit by the ray.
+		Trilinear, // Mip-mapped, isotropic footprint.
+		Anisotropic, // Mip-mapped, footprint is stretched along the major axis.
+	};
+
+	// Precomputed contribution of LCD texels to every output pixel,
+	// for fixed display model, eye ray generator, sample generator and LCD filter.
+	// Entries of pixel p are [PixelStarts[p],PixelStarts[p+1]), pixels are row-major;
+	// texels index the LCD image row-major, or the flattened mip pyramid (see MipMap::TexelIndex) if UsesPyramid.
+	// Weights of a pixel are normalized the same way as in SampleAccumCV.
+	struct LookupTable
+	{
+		Int Width = 0;
+		Int Height = 0;
+		Int LCDWidth = 0;
+		Int LCDHeight = 0;
+		bool UsesPyramid = false;
+		std::vector<std::uint64_t> PixelStarts;
+		std::vector<std::uint32_t> TexelIndices;
+		std::vector<float> Weights;
+	};
+
 public:
 
 	DisplayLensletShow( const DisplayLenslet* displayModel = nullptr );
@@ -39,9 +69,36 @@ public:
 
 	virtual bool Render( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen, lfrt::SampleAccumulator& sampleAccum ) const override;
 
+	// Traces all samples of a 'width' x 'height' output image once and records which LCD texels they see.
+	// DisplayImage is not used, so the table can be applied to any display image afterwards.
+	bool BuildLookupTable( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen,
+		const Int& width, const Int& height, LookupTable& table ) const;
+
+	// Renders DisplayImage through the table into a CV_32FC3 image (BGR, as SampleAccumCV::SaveToImage);
+	// no rays are traced. Pixels without any hit are black.
+	bool RenderLookupTable( const LookupTable& table, cv::Mat& image ) const;
+
+	// Same samples as BuildLookupTable, exported as the matrix of the linear map from DisplayImage to the output image:
+	// rows are output pixels and columns are LCD pixels, both row-major. Filtered lookups are expanded to LCD pixels.
+	// E.g., matrix.Multiply( DisplayImage, image, cv::Size( width, height ) ) matches RenderLookupTable.
+	bool BuildSparseOperator( const lfrt::RayGenerator& raygen, const lfrt::SampleGenerator& sampleGen,
+		const Int& width, const Int& height, SparseMatrix& matrix ) const;
+
+	// Marks pixels of a 'width' x 'height' output image (CV_8UC1) which can see the given LCD pixels.
+	// Mapping is conservative for RayGenPinhole and RayGenFocusEye.
+	// Pass the mask to MultiPassAccumulator::SetDirtyMask to re-render only the affected pixels.
+	bool FindAffectedPixels( const lfrt::RayGenerator& raygen, const Int& width, const Int& height,
+		const cv::Rect& changedLCD, cv::Mat& mask ) const;
+
 public:
 	const DisplayLenslet* DisplayModel = nullptr;
 	cv::Mat DisplayImage = cv::Mat();
+	TileRenderEngine Engine; // Tile size, order and threading of Render.
+	// Filtered lookups integrate the LCD over the footprint of the output pixel, taken from ray differentials
+	// through the lenslet, so that few samples per pixel are enough. Mip pyramid is rebuilt on each Render.
+	LCDFilter Filter = LCDFilter::Nearest;
+	Real FootprintScale = 1.0; // Footprint relative to one output pixel, e.g., 1/sqrt(primary samples per pixel).
+	Int MaxAnisotropy = 8;
 };
 
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
@@ -6,13 +8,15 @@
 
 #include "DisplayLenslet.h"
 #include "DisplayLensletCapture.h"
+#include "DisplayLensletOptimization.h"
 #include "DisplayLensletShow.h"
 
+#include "Foveation.h"
 #include "Image.h"
 #include "ImageAnalysis.h"
 #include "SampleAccumCV.h"
 #include "SampleGenUniform.h"
-#include "SampleGenDisk.h"
+#include "SampleGenLowDiscrepancy.h"
 
 #include "RayGenFocusEye.h"
 
@@ -45,6 +49,7 @@ struct DisplayRenderCase
     std::string Name;
     DisplayLensletCapture::Sampling SamplingType;
     Int NumSecondarySamples;
+    bool IsOptimized = false; // Captured image is only the initial one for optimization over all perceived cases.
 };
 
 struct PerceivedRenderCase
@@ -59,13 +64,36 @@ const std::string output_folder = "output";
 //const Int NumSecondarySamples = 8;
 const Int NumPrimarySamples = 1;
 const Int NumSecondarySamples = 5;
+// Scrambled Sobol samples per pixel of the perceived image; they cover aperture more evenly than the 21-sample disk grid.
+const Int NumLowDiscrepancySamples = 16;
+// Simulated perceived images take fewer samples and lower resolution away from the gaze point (image center);
+// ground-true images are always rendered in full. Off by default, so that the plain metrics measure the full images.
+const bool UseFoveation = false;
+// Filtered LCD lookup removes aliasing of elemental images without extra samples.
+// Off by default, so that the simulation matches the nearest-texel display model.
+const bool UseFilteredLookup = false;
+// Iterations of display image optimization over the perceived cases.
+const Int NumOptimizationIterations = 20;
+
+
+FoveationSettings PerceivedFoveation()
+{
+    FoveationSettings settings;
+    settings.Gaze = lfrt::VEC2({ 0.5*width, 0.5*height });
+    settings.ReduceResolution = true;
+    return settings;
+}
 
 
-// Provided ray tracer must contain already-loaded scene.
-void RenderPerceivedImage( const LFRayTracer* raytracer, cv::Mat& perceived, const PerceivedRenderCase& testCase )
+// Samples per pixel of the perceived image at full acuity.
+Int PerceivedNumSamples( const PerceivedRenderCase& testCase )
 {
+    return (testCase.NumSecondarySamples > 1) ? NumLowDiscrepancySamples : 1;
+}
 
-    std::cout << "Perceived image render started." << std::endl;
+
+RayGenFocusEye* CreateEyeRaygen( const PerceivedRenderCase& testCase )
+{
     auto raygenFocus = new RayGenFocusEye();
     raygenFocus->Width  = width;
     raygenFocus->Height = height;
@@ -74,16 +102,62 @@ void RenderPerceivedImage( const LFRayTracer* raytracer, cv::Mat& perceived, con
     const Real retCoef = -RetinaToPupilDist / sceneDistance;
     raygenFocus->RetinaStart = lfrt::VEC2({ -sceneCornerX*retCoef, -sceneCornerY*retCoef });
     raygenFocus->RetinaEnd   = lfrt::VEC2({  sceneCornerX*retCoef,  sceneCornerY*retCoef });
+    return raygenFocus;
+}
+
+
+// If foveated, 'foveation' receives the maps which were used.
+SampleGenLowDiscrepancy* CreatePerceivedSampler( const RayGenFocusEye& raygen, const PerceivedRenderCase& testCase,
+    const bool isFoveated, FoveationMaps& foveation )
+{
+    const Int numSamples = PerceivedNumSamples( testCase );
+    SampleGenLowDiscrepancy* sampleGenLD = new SampleGenLowDiscrepancy( numSamples );
+    foveation = FoveationMaps();
+    if ( isFoveated && BuildFoveationMaps( raygen, PerceivedFoveation(), numSamples, foveation ) )
+        sampleGenLD->SetSampleCountMap( foveation.SampleCounts );
+    return sampleGenLD;
+}
+
+
+// Provided ray tracer must contain already-loaded scene.
+void RenderPerceivedImage( const LFRayTracer* raytracer, cv::Mat& perceived, const PerceivedRenderCase& testCase, const bool isFoveated )
+{
+
+    std::cout << "Perceived image render started." << std::endl;
+    RayGenFocusEye* raygenFocus = CreateEyeRaygen( testCase );
     std::shared_ptr<const RayGenerator> raygen( raygenFocus );
-    std::shared_ptr<SampleGenerator> sampleGen( new SampleGenDisk( NumPrimarySamples, testCase.NumSecondarySamples ) );
+    FoveationMaps foveation;
+    std::shared_ptr<SampleGenerator> sampleGen( CreatePerceivedSampler( *raygenFocus, testCase, isFoveated, foveation ) );
     SampleAccumCV* sampleAccumCV = new SampleAccumCV( width, height );
     std::shared_ptr<SampleAccumulator> sampleAccum( sampleAccumCV );
     raytracer->Render( *raygen, *sampleGen, *sampleAccum );
     sampleAccumCV->SaveToImage( perceived );
+    if ( !foveation.BlockSizes.empty() )
+        ExpandFoveationBlocks( foveation.BlockSizes, perceived );
     std::cout << "Perceived image render ended." << std::endl;
 }
 
 
+// Records the same samples as RenderPerceivedImage would trace through the display simulation.
+bool BuildPerceivedLookupTable( const DisplayLensletShow& renderer, const PerceivedRenderCase& testCase, const bool isFoveated,
+    DisplayLensletShow::LookupTable& table, FoveationMaps& foveation )
+{
+    std::unique_ptr<RayGenFocusEye> raygen( CreateEyeRaygen( testCase ) );
+    std::unique_ptr<SampleGenerator> sampleGen( CreatePerceivedSampler( *raygen, testCase, isFoveated, foveation ) );
+    return renderer.BuildLookupTable( *raygen, *sampleGen, width, height, table );
+}
+
+
+// Light transport of the view uses the same samples as BuildPerceivedLookupTable.
+bool AddPerceivedView( DisplayLensletOptimization& optimization, const PerceivedRenderCase& testCase, const bool isFoveated )
+{
+    std::unique_ptr<RayGenFocusEye> raygen( CreateEyeRaygen( testCase ) );
+    FoveationMaps foveation;
+    std::unique_ptr<SampleGenerator> sampleGen( CreatePerceivedSampler( *raygen, testCase, isFoveated, foveation ) );
+    return optimization.AddView( *raygen, *sampleGen, width, height );
+}
+
+
 
 int main(int argc, char** argv)
 {
@@ -123,7 +197,8 @@ int main(int argc, char** argv)
     const std::vector<DisplayRenderCase> rtCases({
         DisplayRenderCase({ "LC", DisplayLensletCapture::Sampling::LensletCenter, 1 }),
         DisplayRenderCase({ "PC", DisplayLensletCapture::Sampling::PupilCenter, 1 }),
-        DisplayRenderCase({ "LA", DisplayLensletCapture::Sampling::LensletAverage, 5 })
+        DisplayRenderCase({ "LA", DisplayLensletCapture::Sampling::LensletAverage, 5 }),
+        DisplayRenderCase({ "OPT", DisplayLensletCapture::Sampling::LensletCenter, 1, true })
         }
     );
 
@@ -157,7 +232,7 @@ int main(int argc, char** argv)
     {
         const auto& camCase = camCases[camCaseInd];
         cv::Mat& gt_image = gtimages[camCaseInd];
-        RenderPerceivedImage( raytracer, gt_image, camCase );
+        RenderPerceivedImage( raytracer, gt_image, camCase, false );
         const std::string filename = output_folder + "/gt_" + camCase.Name + ".exr";
         cv::imwrite( filename, gt_image );
     }
@@ -166,6 +241,43 @@ int main(int argc, char** argv)
     std::vector<cv::Scalar> msevals( numCamCases*numRtCases );
     std::vector<cv::Scalar> psnrvals( numCamCases*numRtCases );
     std::vector<cv::Scalar> msssimvals( numCamCases*numRtCases );
+    // Same metrics weighted by retinal eccentricity; eye geometry and gaze are the same for all cases.
+    std::vector<cv::Scalar> fovpsnrvals( numCamCases*numRtCases );
+    std::vector<cv::Scalar> fovmsssimvals( numCamCases*numRtCases );
+    FoveationMaps metricFoveation;
+    {
+        std::unique_ptr<RayGenFocusEye> eyeRaygen( CreateEyeRaygen( camCases[0] ) );
+        BuildFoveationMaps( *eyeRaygen, PerceivedFoveation(), 1, metricFoveation );
+    }
+    // Eye rays of the display simulation do not depend on the display image,
+    // so their LCD texels are recorded once per camera case and reused for all display images.
+    DisplayLensletShow renderer( &display );
+    if ( UseFilteredLookup )
+        renderer.Filter = DisplayLensletShow::LCDFilter::Anisotropic;
+    std::vector<DisplayLensletShow::LookupTable> simLookupTables( numCamCases );
+    std::vector<FoveationMaps> simFoveation( numCamCases );
+    // Optimization uses the display simulation of all perceived cases, with the same lookup settings.
+    DisplayLensletOptimization optimization( &renderer );
+    const bool isOptimized = std::any_of( rtCases.begin(), rtCases.end(),
+        []( const DisplayRenderCase& rtCase ) { return rtCase.IsOptimized; } );
+    std::cout << "Display simulation lookup started." << std::endl;
+    for ( Int camCaseInd = 0; camCaseInd < numCamCases; ++camCaseInd )
+    {
+        const auto& camCase = camCases[camCaseInd];
+        // Samples are spread over the pixel, so each of them filters its share of the pixel footprint.
+        renderer.FootprintScale = 1.0 / std::sqrt( Real( PerceivedNumSamples( camCase ) ) );
+        if ( !BuildPerceivedLookupTable( renderer, camCase, UseFoveation, simLookupTables[camCaseInd], simFoveation[camCaseInd] ) )
+        {
+            std::cout << "Error: Cannot build display simulation lookup." << std::endl;
+            return 1;
+        }
+        if ( isOptimized && !AddPerceivedView( optimization, camCase, UseFoveation ) )
+        {
+            std::cout << "Error: Cannot build display light transport." << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Display simulation lookup ended." << std::endl;
     for ( Int rtCaseInd = 0; rtCaseInd < numRtCases; ++rtCaseInd )
     {
         const auto& rtCase = rtCases[rtCaseInd];
@@ -178,23 +290,38 @@ int main(int argc, char** argv)
             DisplayLensletCapture* displayRaygen = new DisplayLensletCapture( &display, rtCase.SamplingType );
             std::shared_ptr<const RayGenerator> raygen( displayRaygen );
             std::shared_ptr<SampleGenerator> sampleGen( new SampleGenUniform( NumPrimarySamples, rtCase.NumSecondarySamples ) );
+            // Center sampling types do not use secondary samples; the external tracer does not collapse them itself.
+            sampleGen->SetUsedDimensions( raygen->UsedDimensions() );
             SampleAccumCV* sampleAccumCV = new SampleAccumCV( width, height );
             std::shared_ptr<SampleAccumulator> sampleAccum( sampleAccumCV );
             raytracer->Render( *raygen, *sampleGen, *sampleAccum );
             sampleAccumCV->SaveToImage( displayimage );
+            if ( rtCase.IsOptimized )
+            {
+                std::cout << "Display image optimization started." << std::endl;
+                std::vector<cv::Mat> iterations;
+                if ( !optimization.Iterate( gtimages, displayimage, iterations, NumOptimizationIterations ) )
+                {
+                    std::cout << "Error: Cannot optimize display image." << std::endl;
+                    return 1;
+                }
+                displayimage = iterations.back();
+                std::cout << "Display image optimization ended." << std::endl;
+            }
             const std::string filename = output_folder + "/display_" + rtCase.Name + ".exr";
             cv::imwrite( filename, displayimage );
         }
         std::cout << "Display image render ended." << std::endl;
-        // Create display simulation.
-        DisplayLensletShow renderer( &display );
-        renderer.DisplayImage = displayimage;
         // Render display simulation and compare to GT.
+        renderer.DisplayImage = displayimage;
         for ( Int camCaseInd = 0; camCaseInd < numCamCases; ++camCaseInd )
         {
             const auto& camCase = camCases[camCaseInd];
             cv::Mat perceived;
-            RenderPerceivedImage( &renderer, perceived, camCase );
+            renderer.RenderLookupTable( simLookupTables[camCaseInd], perceived );
+            const FoveationMaps& foveation = simFoveation[camCaseInd];
+            if ( !foveation.BlockSizes.empty() )
+                ExpandFoveationBlocks( foveation.BlockSizes, perceived );
             const std::string filename = output_folder + "/sim_" + rtCase.Name + "_" + camCase.Name + ".exr";
             cv::imwrite( filename, perceived );
             const auto& gtimage = gtimages[camCaseInd];
@@ -202,6 +329,8 @@ int main(int argc, char** argv)
             msevals[statInd] = ImageValueMSE( perceived, gtimage );
             psnrvals[statInd] = ImageValuePSNR( perceived, gtimage );
             msssimvals[statInd] = ImageValueMSSIM( perceived, gtimage );
+            fovpsnrvals[statInd] = ImageValueWeightedPSNR( perceived, gtimage, metricFoveation.Weights );
+            fovmsssimvals[statInd] = ImageValueWeightedMSSIM( perceived, gtimage, metricFoveation.Weights );
         }
     }
 
@@ -209,6 +338,8 @@ int main(int argc, char** argv)
     std::fstream msefile( output_folder + "/mse.txt", std::fstream::out );
     std::fstream psnrfile( output_folder + "/psnr.txt", std::fstream::out );
     std::fstream msssimfile( output_folder + "/msssim.txt", std::fstream::out );
+    std::fstream fovpsnrfile( output_folder + "/psnr_foveated.txt", std::fstream::out );
+    std::fstream fovmsssimfile( output_folder + "/msssim_foveated.txt", std::fstream::out );
     for ( Int rtCaseInd = 0; rtCaseInd < numRtCases; ++rtCaseInd )
     {
         const auto& rtCase = rtCases[rtCaseInd];
@@ -219,14 +350,20 @@ int main(int argc, char** argv)
             const auto& mse = msevals[statInd];
             const auto& psnr = psnrvals[statInd];
             const auto& msssim = msssimvals[statInd];
+            const auto& fovpsnr = fovpsnrvals[statInd];
+            const auto& fovmsssim = fovmsssimvals[statInd];
             msefile << (rtCase.Name+"_"+camCase.Name) << " " << mse[0] << " " << mse[1] << " " << mse[2] << std::endl;
             psnrfile << (rtCase.Name+"_"+camCase.Name) << " " << psnr[0] << " " << psnr[1] << " " << psnr[2] << std::endl;
             msssimfile << (rtCase.Name+"_"+camCase.Name) << " " << msssim[0] << " " << msssim[1] << " " << msssim[2] << std::endl;
+            fovpsnrfile << (rtCase.Name+"_"+camCase.Name) << " " << fovpsnr[0] << " " << fovpsnr[1] << " " << fovpsnr[2] << std::endl;
+            fovmsssimfile << (rtCase.Name+"_"+camCase.Name) << " " << fovmsssim[0] << " " << fovmsssim[1] << " " << fovmsssim[2] << std::endl;
         }
     }
     msefile.close();
     psnrfile.close();
     msssimfile.close();
+    fovpsnrfile.close();
+    fovmsssimfile.close();
 
     LFRayTRacerPBRTRelease();
 
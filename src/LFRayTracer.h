@@ -32,6 +32,49 @@ struct VEC2 { Real x; Real y; };
 struct VEC3 { Real x; Real y; Real z; };
 
 
+// Structure-of-arrays view of a batch of rays.
+// Buffers are owned by the caller and must hold at least as many elements as the batch.
+// Zero weight marks a ray which should not be traced.
+struct RayBatch
+{
+	Real* oriX; Real* oriY; Real* oriZ;
+	Real* dirX; Real* dirY; Real* dirZ;
+	Real* weight;
+};
+
+
+// Structure-of-arrays view of a batch of samples, as passed to SampleTile::AddSamples.
+// All arrays must hold at least 'count' elements.
+struct SampleBatch
+{
+	Int count;
+	const VEC2* raster;
+	const VEC2* secondary;
+	const Real* sampleWeight;
+	const Real* rayWeight;
+	const Real* r; const Real* g; const Real* b;
+};
+
+
+// Auxiliary output values (AOV) of one sample, reported next to its color.
+struct SampleAOV
+{
+	bool isHit; // False if ray did not hit anything; other values are then ignored.
+	Real depth; // Distance from ray origin to the hit point, along the ray.
+	VEC3 normal; // Surface normal at the hit point.
+	Int id; // Renderer-specific identifier of what was hit, e.g., primitive, LCD pixel or projector index.
+};
+
+
+// Bit flags of sample dimensions which are read by a ray generator.
+enum SampleDimension : unsigned
+{
+	SampleDimRaster = 1,
+	SampleDimSecondary = 2,
+	SampleDimAll = SampleDimRaster | SampleDimSecondary,
+};
+
+
 
 // Generates sequence of samples for each pixel.
 // Should be called sequentially for each pixel.
@@ -51,6 +94,31 @@ public:
     virtual bool CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time ) = 0;
 	// Move to the next sample for current pixel. True on success; False if this sample was the last one.
 	virtual bool MoveToNextSample() = 0;
+	// Packet version: set pixel (x,y) as the current one and write all its samples at once.
+	// Buffers must hold at least NumSamplesInPixel() elements. Returns number of written samples.
+	virtual Int GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary )
+	{
+		if ( !ResetPixel( x, y ) )
+			return 0;
+		Int count = 0;
+		Real time;
+		do
+		{
+			if ( CurrentSample( weight[count], raster[count], secondary[count], time ) )
+				++count;
+		}
+		while ( MoveToNextSample() );
+		return count;
+	}
+	// Select sample set for the given rendering pass. Pass 0 is the default set;
+	// other passes should produce samples different from the previous ones, so that they can be accumulated.
+	// False if generator cannot produce samples for this pass.
+	virtual bool SetPass( const Int& pass ) { return pass == 0; }
+	// Declare which sample dimensions are used by the ray generator (SampleDimension flags).
+	// Generator may then merge samples which differ only in unused dimensions into one sample,
+	// whose weight is the sum of their weights. Values of unused dimensions are then arbitrary.
+	// False if generator does not collapse samples.
+	virtual bool SetUsedDimensions( const unsigned& /*dims*/ ) { return false; }
 };
 
 
@@ -71,6 +139,24 @@ public:
 		const Real& r, const Real& g, const Real& b,
 		const bool isWeighted = true
 	) = 0;
+	// Batched version of AddSample. Returns number of accepted samples.
+	// Default implementation falls back to AddSample.
+	virtual Int AddSamples( const SampleBatch& samples, const bool isWeighted = true )
+	{
+		Int numAccepted = 0;
+		for ( Int i = 0; i < samples.count; ++i )
+		{
+			if ( AddSample( samples.raster[i], samples.secondary[i],
+				samples.sampleWeight[i], samples.rayWeight[i],
+				samples.r[i], samples.g[i], samples.b[i], isWeighted ) )
+				++numAccepted;
+		}
+		return numAccepted;
+	}
+	// True if the tile stores AOVs; otherwise there is no need to compute them.
+	virtual bool AcceptsAOV() const { return false; }
+	// Adds auxiliary values of a sample which was (or will be) added with the same raster position.
+	virtual bool AddSampleAOV( const VEC2& /*raster*/, const SampleAOV& /*aov*/ ) { return false; }
 };
 
 
@@ -103,6 +189,8 @@ public:
 		VEC3& ori, VEC3& dir
 	) const = 0;
 
+	// Differentials are derivatives of ray origin and direction with respect to raster coordinates.
+	// Default implementation uses finite differences, i.e., three GenerateRay calls.
 	virtual Real GenerateRayDifferential(
 		const VEC2& raster, // Coordinates from [0,Width]x[0,Height].
 		const VEC2& secondary, // Coordinates from [0,1]x[0,1].
@@ -139,9 +227,36 @@ public:
 	    dirdy.x = (dir1.x - dir.x) / epsilon;
 	    dirdy.y = (dir1.y - dir.y) / epsilon;
 	    dirdy.z = (dir1.z - dir.z) / epsilon;
-	    if ( weight1 <= 0 ) oridx = dirdx = { 0, 0, 0 };
+	    if ( weight1 <= 0 ) oridy = dirdy = { 0, 0, 0 };
 	    return weight;
 	}
+
+	// Batched version of GenerateRay for 'count' samples.
+	// Default implementation falls back to the scalar path.
+	virtual void GenerateRays(
+		const Int& count,
+		const VEC2* raster, // Coordinates from [0,Width]x[0,Height].
+		const VEC2* secondary, // Coordinates from [0,1]x[0,1].
+		const RayBatch& rays ) const
+	{
+		VEC3 ori;
+		VEC3 dir;
+		for ( Int i = 0; i < count; ++i )
+		{
+			ori = dir = { 0, 0, 0 };
+			rays.weight[i] = GenerateRay( raster[i], secondary[i], ori, dir );
+			rays.oriX[i] = ori.x;
+			rays.oriY[i] = ori.y;
+			rays.oriZ[i] = ori.z;
+			rays.dirX[i] = dir.x;
+			rays.dirY[i] = dir.y;
+			rays.dirZ[i] = dir.z;
+		}
+	}
+
+	// Sample dimensions which affect generated rays (SampleDimension flags).
+	// Samples which differ only in other dimensions produce the same ray.
+	virtual unsigned UsedDimensions() const { return SampleDimAll; }
 };
 
 
@@ -19,6 +19,17 @@ public:
 	// Returns parameter 'lambda' which corresponds to the maximal refracted ray intensity.
 	virtual Real FindMaxOnLine( const Vec3& rayOri, const Vec3& lineOri, const Vec3& lineDir = Vec3(1,0,0) ) const = 0;
 
+	// Derivative of FindMaxOnLine result when both 'rayOri' and 'lineOri' are moved along 'shift'.
+	// This corresponds to moving the ray intersection point by '-shift'.
+	// Default implementation uses central finite differences.
+	virtual Real FindMaxOnLineShiftDerivative( const Vec3& rayOri, const Vec3& lineOri, const Vec3& shift, const Vec3& lineDir = Vec3(1,0,0) ) const
+	{
+		const Real epsilon = 0.001;
+		const Real lambdaA = FindMaxOnLine( rayOri + epsilon*shift, lineOri + epsilon*shift, lineDir );
+		const Real lambdaB = FindMaxOnLine( rayOri - epsilon*shift, lineOri - epsilon*shift, lineDir );
+		return (lambdaA - lambdaB) / (2.0*epsilon);
+	}
+
 	// Returns intensity of refracted light ray which starts at 'pointA' and terminates at 'pointB'.
 	virtual Real Diffusion( const Vec3& pointA, const Vec3& pointB ) const = 0;
 };
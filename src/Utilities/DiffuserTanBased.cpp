@@ -58,6 +58,31 @@ Real DiffuserTanBased::FindMaxOnLine( const Vec3& rayOri, const Vec3& lineOri, c
 
 
 
+Real DiffuserTanBased::FindMaxOnLineShiftDerivative( const Vec3& rayOri, const Vec3& lineOri, const Vec3& shift, const Vec3& lineDir ) const
+{
+	if ( lineDir != Vec3(1,0,0) )
+		return DiffuserModel::FindMaxOnLineShiftDerivative( rayOri, lineOri, shift, lineDir );
+	// For d==(1,0,0), FindMaxOnLine picks the root with the same 'rho', i.e.
+	// lambda = -e(0) + signLine*signRay * r(0) * |e(1,2)| / |r(1,2)|,
+	// where r = rayOri and e = lineOri. Differentiate it along 'shift'.
+	const Vec3& r = rayOri;
+	const Vec3& e = lineOri;
+	const Vec3& v = shift;
+	const Real signRay  = r(2) < 0 ? -1 : 1;
+	const Real signLine = e(2) < 0 ? -1 : 1;
+	const Real lenE = std::sqrt( e(1)*e(1) + e(2)*e(2) );
+	const Real lenR = std::sqrt( r(1)*r(1) + r(2)*r(2) );
+	if ( lenE <= 0 || lenR <= 0 )
+		return -v(0);
+	const Real lenEDiff = ( e(1)*v(1) + e(2)*v(2) ) / lenE;
+	const Real lenRDiff = ( r(1)*v(1) + r(2)*v(2) ) / lenR;
+	const Real ratio = lenE / lenR;
+	const Real ratioDiff = ( lenEDiff - ratio*lenRDiff ) / lenR;
+	return -v(0) + signLine*signRay * ( v(0)*ratio + r(0)*ratioDiff );
+}
+
+
+
 Real DiffuserTanBased::Diffusion( const Vec3& pointA, const Vec3& pointB ) const
 {
 	const Vec3 dA = pointA;
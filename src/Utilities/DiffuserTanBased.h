@@ -11,6 +11,9 @@ public:
 
 	virtual Real FindMaxOnLine( const Vec3& rayOri, const Vec3& lineOri, const Vec3& lineDir = Vec3(1,0,0) ) const override;
 
+	// Closed form for lineDir=(1,0,0); otherwise falls back to finite differences.
+	virtual Real FindMaxOnLineShiftDerivative( const Vec3& rayOri, const Vec3& lineOri, const Vec3& shift, const Vec3& lineDir = Vec3(1,0,0) ) const override;
+
 	virtual Real Diffusion( const Vec3& pointA, const Vec3& pointB ) const override;
 
 
@@ -0,0 +1,20 @@
+#include "DirtyRegion.h"
+
+
+
+bool PixelFootprint::Generate( const lfrt::RayGenerator& raygen, const Int& x, const Int& y )
+{
+	Int rayInd = 0;
+	for ( Int corner = 0; corner < 4; ++corner )
+	{
+		const lfrt::VEC2 raster({ lfrt::Real( x + corner % 2 ), lfrt::Real( y + corner / 2 ) });
+		for ( Int secondaryCorner = 0; secondaryCorner < 4; ++secondaryCorner )
+		{
+			const lfrt::VEC2 secondary({ lfrt::Real( secondaryCorner % 2 ), lfrt::Real( secondaryCorner / 2 ) });
+			if ( raygen.GenerateRay( raster, secondary, ori[rayInd], dir[rayInd] ) <= 0 )
+				return false;
+			++rayInd;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,72 @@
+#ifndef UTILITIES_DIRTYREGION_H
+#define UTILITIES_DIRTYREGION_H
+
+#include "LFRayTracer.h"
+
+#include <opencv2/opencv.hpp>
+
+
+// Rays which bound all rays of one output pixel.
+// They pass through the four pixel corners, each with the four corners of the secondary domain.
+// If the ray generator is affine in raster and secondary coordinates (RayGenPinhole, RayGenFocusEye),
+// every ray of the pixel is a convex combination of them, so that any affine mapping of rays
+// to a plane maps the pixel into the bounding box of the mapped footprint rays.
+class PixelFootprint
+{
+public:
+	using Int = lfrt::Int;
+	using VEC3 = lfrt::VEC3;
+
+	static const Int NumRays = 16;
+
+	// False if some of the rays could not be generated.
+	bool Generate( const lfrt::RayGenerator& raygen, const Int& x, const Int& y );
+
+public:
+	VEC3 ori[NumRays];
+	VEC3 dir[NumRays];
+};
+
+
+// Marks pixels of a 'width' x 'height' output image (CV_8UC1, 255 if marked)
+// for which 'isAffected( const PixelFootprint& footprint )' returns true.
+// Pixels whose footprint cannot be generated are marked, so that the result stays conservative.
+// The mask is meant for MultiPassAccumulator::SetDirtyMask.
+template< class PredicateT >
+void FindAffectedPixels(
+	const lfrt::RayGenerator& raygen, const lfrt::Int& width, const lfrt::Int& height,
+	const PredicateT& isAffected, cv::Mat& mask )
+{
+	using Int = lfrt::Int;
+
+	mask = cv::Mat::zeros( int(height), int(width), CV_8UC1 );
+	cv::parallel_for_( cv::Range( 0, int(height) ),
+		[&]( const cv::Range& range )
+		{
+			PixelFootprint footprint;
+			for ( Int y = range.start; y < range.end; ++y )
+			{
+				unsigned char* row = mask.ptr<unsigned char>( int(y) );
+				for ( Int x = 0; x < width; ++x )
+				{
+					if ( !footprint.Generate( raygen, x, y ) || isAffected( footprint ) )
+						row[x] = 255;
+				}
+			}
+		}
+	);
+}
+
+
+// True if pixel range [minX,maxX]x[minY,maxY], given by continuous image coordinates
+// and truncated to pixel indices the same way as in lookups, overlaps 'rect'.
+inline bool OverlapsPixelRect(
+	const lfrt::Real& minX, const lfrt::Real& minY, const lfrt::Real& maxX, const lfrt::Real& maxY,
+	const cv::Rect& rect )
+{
+	return std::floor( maxX ) >= rect.x && std::floor( minX ) < rect.x + rect.width &&
+		   std::floor( maxY ) >= rect.y && std::floor( minY ) < rect.y + rect.height;
+}
+
+
+#endif // UTILITIES_DIRTYREGION_H
@@ -13,6 +13,7 @@ bool DisplayLenslet::SetLensletPositioning( const Vec2& shift, const Mat22& orie
 
 	lensletShiftInv = -inverse*shift;
 	lensletOrientationInv = inverse;
+	lensletCells.Build( orientation, cellShape );
 
 	return true;
 }
@@ -30,6 +31,22 @@ bool DisplayLenslet::SetEIPositioning(const Vec2& shift, const Mat22& orientatio
 
 	eiShiftInv = -inverse*shift;
 	eiOrientationInv = inverse;
+	eiCells.Build( orientation, cellShape );
+
+	return true;
+}
+
+
+bool DisplayLenslet::SetCellShape( const CellShape& shape )
+{
+	LatticeCellLookup lenslets;
+	LatticeCellLookup eis;
+	if ( !lenslets.Build( lensletOrientation, shape ) || !eis.Build( eiOrientation, shape ) )
+		return false;
+
+	cellShape = shape;
+	lensletCells = lenslets;
+	eiCells = eis;
 
 	return true;
 }
@@ -53,6 +70,7 @@ bool DisplayLenslet::Save( const std::string& filepath ) const
 
 	fs << "eishift" << this->eiShift;
 	fs << "eiorientation" << cv::Vec<double,4>( this->eiOrientation.val );
+	fs << "cellshape" << std::string( (this->cellShape == CellShape::Voronoi) ? "voronoi" : "parallelogram" );
 
 	fs.release();
 	return true;
@@ -71,6 +89,11 @@ bool DisplayLenslet::Load( const std::string& filepath )
 	fs["resolutionlcd"] >> this->ResolutionLCD;
 	fs["islensletvertical"] >> this->IsLensletVertical;
 
+	// Models without the key have parallelogram cells.
+	std::string cellShapeName;
+	fs["cellshape"] >> cellShapeName;
+	cellShape = (cellShapeName == "voronoi") ? CellShape::Voronoi : CellShape::Parallelogram;
+
 	Vec2 shift;
 	cv::Vec<double,4> mat22data;
 
@@ -2,6 +2,7 @@
 #define DISPLAYLENSLET_H
 
 #include "BaseTypes.h"
+#include "LatticeCellLookup.h"
 
 // Data storage for lenslet-based display.
 // Display geometry:
@@ -9,13 +10,20 @@
 // Observer plane: (x,y,0).
 // Lenslet plane: (x,y,f), where f = LensletToOrigin.
 // LCD plane: (x,y,d+f), where d = LensletToLCD.
+// Lenslets and elemental images form lattices with parallelogram or Voronoi cells (see LatticeCellLookup).
+// E.g., hexagonal lenslets of pitch p have orientation p*(1,1/2;0,sqrt(3)/2) and Voronoi cells.
 class DisplayLenslet
 {
+public:
+	using CellShape = LatticeCellLookup::CellShape;
+
 public:
 
 
 	bool SetLensletPositioning( const Vec2& shift, const Mat22& orientation );
 	bool SetEIPositioning( const Vec2& shift, const Mat22& orientation );
+	// Shape of both lenslet and elemental image cells.
+	bool SetCellShape( const CellShape& shape );
 
 
 	bool Save( const std::string& filepath ) const;
@@ -33,6 +41,11 @@ public:
 	const Vec2& EIShiftInv() const { return eiShiftInv; }
 	const Mat22& EIOrientationInv() const { return eiOrientationInv; }
 
+	CellShape GetCellShape() const { return cellShape; }
+	// Cell lookups take lattice coordinates, e.g., LensletShiftInv() + LensletOrientationInv() * P.
+	const LatticeCellLookup& LensletCells() const { return lensletCells; }
+	const LatticeCellLookup& EICells() const { return eiCells; }
+
 
 public:
 	Real LensletToLCD; // Distance from lenslet surface to LCD.
@@ -57,6 +70,9 @@ private:
 	Vec2 eiShiftInv = Vec2(0,0);
 	Mat22 eiOrientationInv = Mat22(1,0,0,1);
 
+	CellShape cellShape = CellShape::Parallelogram;
+	LatticeCellLookup lensletCells;
+	LatticeCellLookup eiCells;
 };
 
 #endif // DISPLAYLENSLET_H
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "Foveation.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace lfrt;
+
+
+Real FoveationSettings::Acuity( const Real& eccentricity ) const
+{
+	const Real excess = std::max<Real>( eccentricity - FovealRadius, 0 );
+	if ( HalfAcuityEccentricity <= 0 )
+		return excess > 0 ? 0 : 1;
+	return HalfAcuityEccentricity / (HalfAcuityEccentricity + excess);
+}
+
+
+Real FoveationSettings::Density( const Real& eccentricity ) const
+{
+	const Real acuity = Acuity( eccentricity );
+	return std::min<Real>( std::max<Real>( acuity*acuity, MinDensity ), 1 );
+}
+
+
+bool BuildFoveationMaps( const RayGenFocusEye& raygen, const FoveationSettings& settings,
+	const Int& maxSamples, FoveationMaps& maps )
+{
+	const Int width = raygen.Width;
+	const Int height = raygen.Height;
+	if ( width <= 0 || height <= 0 || maxSamples <= 0 )
+		return false;
+	const Int maxBlockSize = settings.ReduceResolution ? settings.MaxBlockSize : 1;
+	if ( maxBlockSize <= 0 || (maxBlockSize & (maxBlockSize-1)) != 0 || maxBlockSize > 255 )
+		return false;
+
+	maps.SampleCounts = cv::Mat::zeros( height, width, CV_32SC1 );
+	maps.BlockSizes = cv::Mat::ones( height, width, CV_8UC1 );
+	maps.Weights = cv::Mat::zeros( height, width, CV_32FC1 );
+
+	// Image is split into cells of the maximum block size, and the whole cell uses the same block size,
+	// so that blocks never cross each other.
+	const Int numCellsY = (height + maxBlockSize - 1) / maxBlockSize;
+	cv::parallel_for_( cv::Range( 0, numCellsY ), [&]( const cv::Range& range )
+		{
+			for ( Int cellY = range.start; cellY < range.end; ++cellY )
+			{
+				const Int startY = cellY * maxBlockSize;
+				const Int endY = std::min<Int>( startY + maxBlockSize, height );
+				for ( Int startX = 0; startX < width; startX += maxBlockSize )
+				{
+					const Int endX = std::min<Int>( startX + maxBlockSize, width );
+
+					// Largest power-of-two block which is still resolved at the cell center.
+					Int blockSize = 1;
+					if ( maxBlockSize > 1 )
+					{
+						const VEC2 center({ 0.5*Real(startX+endX), 0.5*Real(startY+endY) });
+						const Real acuity = settings.Acuity( raygen.Eccentricity( center, settings.Gaze ) );
+						while ( blockSize < maxBlockSize && Real(2*blockSize)*acuity <= 1 )
+							blockSize *= 2;
+					}
+
+					for ( Int y = startY; y < endY; ++y )
+					{
+						int* countRow = maps.SampleCounts.ptr<int>( y );
+						unsigned char* blockRow = maps.BlockSizes.ptr<unsigned char>( y );
+						float* weightRow = maps.Weights.ptr<float>( y );
+						for ( Int x = startX; x < endX; ++x )
+						{
+							const VEC2 pixelCenter({ Real(x)+0.5, Real(y)+0.5 });
+							const Real density = settings.Density( raygen.Eccentricity( pixelCenter, settings.Gaze ) );
+							blockRow[x] = (unsigned char)blockSize;
+							weightRow[x] = float( density );
+							const bool isBlockCorner = ((x - startX) % blockSize) == 0 && ((y - startY) % blockSize) == 0;
+							if ( !isBlockCorner )
+								continue;
+							// Block corner takes the samples of the whole block.
+							const Real blockDensity = std::min<Real>( density * Real(blockSize*blockSize), 1 );
+							countRow[x] = std::max<int>( int( std::lround( blockDensity * Real(maxSamples) ) ), 1 );
+						}
+					}
+				}
+			}
+		} );
+	return true;
+}
+
+
+bool ExpandFoveationBlocks( const cv::Mat& blockSizes, cv::Mat& image )
+{
+	if ( blockSizes.type() != CV_8UC1 || image.empty() ||
+		 blockSizes.cols != image.cols || blockSizes.rows != image.rows )
+		return false;
+	const size_t pixelSize = image.elemSize();
+	cv::parallel_for_( cv::Range( 0, image.rows ), [&]( const cv::Range& range )
+		{
+			for ( Int y = range.start; y < range.end; ++y )
+			{
+				const unsigned char* blockRow = blockSizes.ptr<unsigned char>( y );
+				unsigned char* dst = image.ptr<unsigned char>( y );
+				for ( Int x = 0; x < image.cols; ++x )
+				{
+					const Int blockSize = blockRow[x];
+					if ( blockSize <= 1 )
+						continue;
+					// Blocks are aligned to multiples of their size.
+					const Int cornerX = x - x % blockSize;
+					const Int cornerY = y - y % blockSize;
+					if ( cornerX == x && cornerY == y )
+						continue;
+					const unsigned char* src = image.ptr<unsigned char>( cornerY ) + cornerX*pixelSize;
+					std::copy( src, src + pixelSize, dst + x*pixelSize );
+				}
+			}
+		} );
+	return true;
+}
@@ -0,0 +1,51 @@
+#ifndef UTILITIES_FOVEATION_H
+#define UTILITIES_FOVEATION_H
+
+#include "LFRayTracer.h"
+#include "RayGenFocusEye.h"
+
+#include <opencv2/opencv.hpp>
+
+
+// Falloff of visual acuity with retinal eccentricity 'e' (degrees from the gaze direction).
+// Minimum angle of resolution grows linearly outside the fovea:
+//     acuity(e) = E2 / (E2 + max(0, e - FovealRadius)).
+// Samples per area are needed in proportion to acuity squared.
+struct FoveationSettings
+{
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+
+	Real Acuity( const Real& eccentricity ) const;
+	// Relative sample density, in [MinDensity,1].
+	Real Density( const Real& eccentricity ) const;
+
+	lfrt::VEC2 Gaze = lfrt::VEC2({ 0, 0 }); // Gaze point, in raster coordinates.
+	Real FovealRadius = 2.5; // Eccentricity of full acuity, in degrees.
+	Real HalfAcuityEccentricity = 2.3; // E2: eccentricity beyond the fovea at which acuity halves, in degrees.
+	Real MinDensity = 1.0 / 16.0;
+	// If true, periphery is also rendered at lower resolution: one pixel per block of pixels, as acuity allows.
+	bool ReduceResolution = false;
+	Int MaxBlockSize = 4; // Power of two.
+};
+
+
+// Per-pixel maps for foveated rendering of one image.
+struct FoveationMaps
+{
+	cv::Mat SampleCounts; // CV_32SC1; zero for pixels which take the value of their block (see ExpandFoveationBlocks).
+	cv::Mat BlockSizes; // CV_8UC1; side of the pixel block, 1 for full resolution.
+	cv::Mat Weights; // CV_32FC1; relative sample density, to weight image metrics by eccentricity.
+};
+
+
+// Builds maps for the image of 'raygen', with 'maxSamples' samples per pixel at full acuity.
+// Sample counts are meant for SampleGenLowDiscrepancy::SetSampleCountMap.
+bool BuildFoveationMaps( const RayGenFocusEye& raygen, const FoveationSettings& settings,
+	const lfrt::Int& maxSamples, FoveationMaps& maps );
+
+// Copies the top-left pixel of every block to the rest of the block.
+bool ExpandFoveationBlocks( const cv::Mat& blockSizes, cv::Mat& image );
+
+
+#endif // UTILITIES_FOVEATION_H
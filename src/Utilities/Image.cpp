@@ -29,3 +29,13 @@ bool LoadImageRGB( const std::string& filepath, cv::Mat& image )
 	imageOriginal.convertTo( image, CV_MAKETYPE(CV_32F,3), scaling );
 	return true;
 }
+
+
+bool LoadImageRGBHalf( const std::string& filepath, cv::Mat& image )
+{
+	cv::Mat imageFloat;
+	if ( !LoadImageRGB( filepath, imageFloat ) )
+		return false;
+	imageFloat.convertTo( image, CV_MAKETYPE(CV_16F,3) );
+	return true;
+}
@@ -12,5 +12,8 @@ bool LoadImageGray( const std::string& filepath, cv::Mat& image );
 // Loads image and converts it into OpenCV 32FC3 format.
 bool LoadImageRGB( const std::string& filepath, cv::Mat& image );
 
+// Loads image and converts it into OpenCV 16FC3 (half-precision) format.
+bool LoadImageRGBHalf( const std::string& filepath, cv::Mat& image );
+
 
 #endif // UTILITIES_IMAGE_H
\ No newline at end of file
@@ -8,6 +8,30 @@
 const double Infinity = std::numeric_limits<double>::infinity();
 
 
+namespace
+{
+
+// Per-channel weighted mean of 'values' (CV_32F with any number of channels).
+cv::Scalar WeightedMean( const cv::Mat& values, const cv::Mat& weights )
+{
+    const double sumWeights = cv::sum( weights )[0];
+    if ( sumWeights <= 0 )
+        return cv::Scalar::all( 0 );
+    std::vector<cv::Mat> channels;
+    cv::split( values, channels );
+    cv::Scalar result;
+    for ( size_t c = 0; c < channels.size() && c < 4; ++c )
+        result[c] = channels[c].dot( weights ) / sumWeights;
+    return result;
+}
+
+
+// Structural similarity of every pixel, CV_32F with the channels of the input images.
+void SSIMMap( const cv::Mat& i1, const cv::Mat& i2, cv::Mat& ssim_map );
+
+} // namespace
+
+
 
 cv::Scalar ImageValueMSE( const cv::Mat& imageA, const cv::Mat& imageB )
 {
@@ -40,6 +64,46 @@ cv::Scalar MSE_to_PSNR( const cv::Scalar& mse )
 
 
 cv::Scalar ImageValueMSSIM( const cv::Mat& i1, const cv::Mat& i2)
+{
+    cv::Mat ssim_map;
+    SSIMMap( i1, i2, ssim_map );
+    cv::Scalar mssim = cv::mean(ssim_map);   // mssim = average of ssim map
+    return mssim;
+}
+
+
+
+cv::Scalar ImageValueWeightedMSE( const cv::Mat& imageA, const cv::Mat& imageB, const cv::Mat& weights )
+{
+    cv::Mat imageDiff;
+    absdiff( imageA, imageB, imageDiff );
+    imageDiff.convertTo( imageDiff, CV_32F );
+    imageDiff = imageDiff.mul( imageDiff );
+    return WeightedMean( imageDiff, weights );
+}
+
+
+
+cv::Scalar ImageValueWeightedPSNR( const cv::Mat& imageA, const cv::Mat& imageB, const cv::Mat& weights )
+{
+    return MSE_to_PSNR( ImageValueWeightedMSE( imageA, imageB, weights ) );
+}
+
+
+
+cv::Scalar ImageValueWeightedMSSIM( const cv::Mat& i1, const cv::Mat& i2, const cv::Mat& weights )
+{
+    cv::Mat ssim_map;
+    SSIMMap( i1, i2, ssim_map );
+    return WeightedMean( ssim_map, weights );
+}
+
+
+
+namespace
+{
+
+void SSIMMap( const cv::Mat& i1, const cv::Mat& i2, cv::Mat& ssim_map )
 {
     // Source: https://docs.opencv.org/3.4/d5/dc4/tutorial_video_input_psnr_ssim.html
     const double C1 = 6.5025, C2 = 58.5225;
@@ -72,12 +136,11 @@ cv::Scalar ImageValueMSSIM( const cv::Mat& i1, const cv::Mat& i2)
     t1 = mu1_2 + mu2_2 + C1;
     t2 = sigma1_2 + sigma2_2 + C2;
     t1 = t1.mul(t2);                 // t1 =((mu1_2 + mu2_2 + C1).*(sigma1_2 + sigma2_2 + C2))
-    cv::Mat ssim_map;
     cv::divide(t3, t1, ssim_map);        // ssim_map =  t3./t1;
-    cv::Scalar mssim = cv::mean(ssim_map);   // mssim = average of ssim map
-    return mssim;
 }
 
+} // namespace
+
 
 
 bool ClampImages( std::vector<cv::Mat>& images )
@@ -14,6 +14,15 @@ cv::Scalar MSE_to_PSNR( const cv::Scalar& mse );
 cv::Scalar ImageValueMSSIM( const cv::Mat& I1, const cv::Mat& I2);
 
 
+// Weighted metrics: every pixel contributes in proportion to 'weights' (CV_32FC1 of image size),
+// e.g., eccentricity weights of FoveationMaps.
+cv::Scalar ImageValueWeightedMSE( const cv::Mat& imageA, const cv::Mat& imageB, const cv::Mat& weights );
+
+cv::Scalar ImageValueWeightedPSNR( const cv::Mat& imageA, const cv::Mat& imageB, const cv::Mat& weights );
+
+cv::Scalar ImageValueWeightedMSSIM( const cv::Mat& I1, const cv::Mat& I2, const cv::Mat& weights );
+
+
 bool ClampImages( std::vector<cv::Mat>& images );
 
 
@@ -0,0 +1,52 @@
+#ifndef UTILITIES_IMAGEPIXEL_H
+#define UTILITIES_IMAGEPIXEL_H
+
+#include <opencv2/opencv.hpp>
+
+
+// Access to pixels of color images stored either as CV_32FC3 or as CV_16FC3.
+// Half-precision values are converted to float at the point of use.
+
+
+// True if image is a color image in one of the supported formats.
+inline bool IsColorImage( const cv::Mat& image )
+{
+	return image.type() == CV_32FC3 || image.type() == CV_16FC3;
+}
+
+
+// Element type is a template parameter, so that the format check can be hoisted out of pixel loops.
+template< class ElementT >
+inline cv::Vec3f ReadColor( const cv::Mat& image, const int y, const int x )
+{
+	const ElementT* pixel = image.ptr<ElementT>(y) + 3*x;
+	return cv::Vec3f( float(pixel[0]), float(pixel[1]), float(pixel[2]) );
+}
+
+
+template< class ElementT >
+inline void WriteColorChannel( cv::Mat& image, const int y, const int x, const int channel, const float value )
+{
+	image.ptr<ElementT>(y)[3*x + channel] = ElementT( value );
+}
+
+
+// Runtime-dispatched versions for code which is not performance-critical.
+inline cv::Vec3f ReadColor( const cv::Mat& image, const int y, const int x )
+{
+	return image.depth() == CV_16F
+		? ReadColor<cv::float16_t>( image, y, x )
+		: ReadColor<float>( image, y, x );
+}
+
+
+inline void WriteColorChannel( cv::Mat& image, const int y, const int x, const int channel, const float value )
+{
+	if ( image.depth() == CV_16F )
+		WriteColorChannel<cv::float16_t>( image, y, x, channel, value );
+	else
+		WriteColorChannel<float>( image, y, x, channel, value );
+}
+
+
+#endif // UTILITIES_IMAGEPIXEL_H
@@ -0,0 +1,160 @@
+#include "LatticeCellLookup.h"
+
+#include <utility>
+
+
+namespace
+{
+
+// Distance from origin to segment [a,b].
+Real SegmentDistance( const Vec2& a, const Vec2& b )
+{
+	const Vec2 ab = b - a;
+	const Real length2 = ab.dot( ab );
+	const Real t = (length2 > 0) ? std::min<Real>( std::max<Real>( -a.dot( ab ) / length2, 0 ), 1 ) : 0;
+	return cv::norm( a + t*ab );
+}
+
+// Lagrange-Gauss reduction. Columns 'first' and 'second' of the returned unimodular matrix
+// give the two shortest lattice vectors as integer combinations of the basis columns.
+void ReduceBasis( const Mat22& basis, Vec2i& first, Vec2i& second )
+{
+	Vec2 b1( basis(0,0), basis(1,0) );
+	Vec2 b2( basis(0,1), basis(1,1) );
+	first = Vec2i( 1, 0 );
+	second = Vec2i( 0, 1 );
+	if ( b1.dot( b1 ) > b2.dot( b2 ) )
+	{
+		std::swap( b1, b2 );
+		std::swap( first, second );
+	}
+	// |b1| decreases strictly on every swap, so the loop terminates.
+	while ( true )
+	{
+		const Real mu = std::round( b1.dot( b2 ) / b1.dot( b1 ) );
+		if ( mu == 0 )
+			break;
+		b2 -= mu * b1;
+		second = Vec2i( second[0] - Int(mu)*first[0], second[1] - Int(mu)*first[1] );
+		if ( b2.dot( b2 ) >= b1.dot( b1 ) )
+			break;
+		std::swap( b1, b2 );
+		std::swap( first, second );
+	}
+}
+
+} // namespace
+
+
+bool LatticeCellLookup::Build( const Mat22& basis, const CellShape& cellShape )
+{
+	bool isInvertible = false;
+	basis.inv( 0, &isInvertible );
+	if ( !isInvertible )
+		return false;
+
+	shape = cellShape;
+	m00 = basis(0,0);
+	m01 = basis(0,1);
+	m10 = basis(1,0);
+	m11 = basis(1,1);
+	gridStarts.clear();
+	candidates.clear();
+	margin = 0;
+	if ( shape != CellShape::Voronoi )
+		return true;
+
+	// Candidates are searched in coordinates of the reduced basis, where the point nearest to a unit square
+	// is at most one lattice step away from it. Reduced coordinates are inverse(transform) * (u,v).
+	Vec2i first;
+	Vec2i second;
+	ReduceBasis( basis, first, second );
+	const Int det = first[0]*second[1] - first[1]*second[0];
+	const Int inv00 =  det*second[1];
+	const Int inv01 = -det*second[0];
+	const Int inv10 = -det*first[1];
+	const Int inv11 =  det*first[0];
+	const Real cellSize = 1.0 / Real(GridSize);
+	std::vector<Vec2i> offsets;
+	std::vector<Real> minDists;
+	gridStarts.reserve( GridSize*GridSize + 1 );
+	gridStarts.push_back( 0 );
+	for ( Int gridY = 0; gridY < GridSize; ++gridY )
+	{
+		for ( Int gridX = 0; gridX < GridSize; ++gridX )
+		{
+			const Real u0 = gridX * cellSize;
+			const Real v0 = gridY * cellSize;
+			const Real u1 = u0 + cellSize;
+			const Real v1 = v0 + cellSize;
+			// Keep the offsets which are closer than the farthest point of the grid cell to some other offset;
+			// the grid cell is a parallelogram in space, so both distances are found from its corners and edges.
+			offsets.clear();
+			minDists.clear();
+			const Real cornerU[4] = { u0, u1, u1, u0 };
+			const Real cornerV[4] = { v0, v0, v1, v1 };
+			Real minReducedX = std::numeric_limits<Real>::max();
+			Real minReducedY = std::numeric_limits<Real>::max();
+			Real maxReducedX = std::numeric_limits<Real>::lowest();
+			Real maxReducedY = std::numeric_limits<Real>::lowest();
+			for ( Int i = 0; i < 4; ++i )
+			{
+				const Real reducedX = inv00*cornerU[i] + inv01*cornerV[i];
+				const Real reducedY = inv10*cornerU[i] + inv11*cornerV[i];
+				minReducedX = std::min( minReducedX, reducedX );
+				minReducedY = std::min( minReducedY, reducedY );
+				maxReducedX = std::max( maxReducedX, reducedX );
+				maxReducedY = std::max( maxReducedY, reducedY );
+			}
+			Real bestMaxDist = std::numeric_limits<Real>::max();
+			for ( Int reducedY = Int( std::floor( minReducedY ) ) - 1; reducedY <= Int( std::floor( maxReducedY ) ) + 2; ++reducedY )
+			{
+				for ( Int reducedX = Int( std::floor( minReducedX ) ) - 1; reducedX <= Int( std::floor( maxReducedX ) ) + 2; ++reducedX )
+				{
+					const Int offsetX = first[0]*reducedX + second[0]*reducedY;
+					const Int offsetY = first[1]*reducedX + second[1]*reducedY;
+					Vec2 corners[4];
+					Real maxDist = 0;
+					for ( Int i = 0; i < 4; ++i )
+					{
+						const Real du = cornerU[i] - offsetX;
+						const Real dv = cornerV[i] - offsetY;
+						corners[i] = Vec2( m00*du + m01*dv, m10*du + m11*dv );
+						maxDist = std::max<Real>( maxDist, cv::norm( corners[i] ) );
+					}
+					Real minDist = 0;
+					const bool isInside = offsetX >= u0 && offsetX <= u1 && offsetY >= v0 && offsetY <= v1;
+					if ( !isInside )
+					{
+						minDist = std::numeric_limits<Real>::max();
+						for ( Int i = 0; i < 4; ++i )
+							minDist = std::min( minDist, SegmentDistance( corners[i], corners[(i+1)%4] ) );
+					}
+					bestMaxDist = std::min( bestMaxDist, maxDist );
+					offsets.push_back( Vec2i( offsetX, offsetY ) );
+					minDists.push_back( minDist );
+				}
+			}
+			// Tolerance keeps ties at cell boundaries.
+			const Real threshold = bestMaxDist * (1.0 + 1e-9);
+			for ( size_t i = 0; i < offsets.size(); ++i )
+			{
+				if ( minDists[i] > threshold )
+					continue;
+				candidates.push_back( offsets[i] );
+				// Cell minus round(u,v), where round adds 0 or 1 to floor depending on the half of the unit square.
+				for ( Int axis = 0; axis < 2; ++axis )
+				{
+					const Real lower = (axis == 0) ? u0 : v0;
+					const Real upper = (axis == 0) ? u1 : v1;
+					if ( lower <= 0.5 )
+						margin = std::max<Int>( margin, std::abs( offsets[i][axis] ) );
+					if ( upper >= 0.5 )
+						margin = std::max<Int>( margin, std::abs( offsets[i][axis] - 1 ) );
+				}
+			}
+			gridStarts.push_back( Int( candidates.size() ) );
+		}
+	}
+	return true;
+}
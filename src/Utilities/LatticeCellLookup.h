@@ -0,0 +1,98 @@
+#ifndef UTILITIES_LATTICECELLLOOKUP_H
+#define UTILITIES_LATTICECELLLOOKUP_H
+
+#include "BaseTypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+// Finds the cell of a 2D lattice which contains a point given by its continuous lattice coordinates,
+// i.e., point P = Shift + Basis * (u,v) has coordinates (u,v), and lattice points have integer ones.
+// Parallelogram cells are centered at lattice points: the cell is (round(u),round(v)).
+// Voronoi cells contain points nearest to their lattice point, e.g., hexagons of a hexagonal lattice.
+// Lattice is periodic, so candidates of the nearest point are precomputed once for a coarse grid
+// over the unit square of lattice coordinates, and a lookup tests only the few candidates of one grid cell.
+class LatticeCellLookup
+{
+public:
+	enum class CellShape
+	{
+		Parallelogram = 0,
+		Voronoi = 1,
+	};
+
+public:
+
+	// Columns of 'basis' are the lattice vectors. Any basis of the lattice is accepted:
+	// Voronoi candidates are searched with the Lagrange-Gauss reduced basis, and cells keep indices of 'basis'.
+	bool Build( const Mat22& basis, const CellShape& shape );
+
+	CellShape Shape() const { return shape; }
+
+	// Lattice point whose cell contains the lattice coordinates.
+	Vec2i Cell( const Real& u, const Real& v ) const;
+	Vec2i Cell( const Vec2& lattice ) const { return Cell( lattice[0], lattice[1] ); }
+
+	// Cells which overlap lattice coordinates [minU,maxU]x[minV,maxV] have indices
+	// from round(min)-Margin() to round(max)+Margin().
+	// It is zero for parallelograms, and usually 1 for Voronoi cells of a reduced basis.
+	Int Margin() const { return margin; }
+
+private:
+	static const Int GridSize = 32;
+
+	CellShape shape = CellShape::Parallelogram;
+	Real m00 = 1;
+	Real m01 = 0;
+	Real m10 = 0;
+	Real m11 = 1;
+	Int margin = 0;
+	// Candidate offsets from floor(u,v) for grid cells, row-major; those of cell i are [gridStarts[i],gridStarts[i+1]).
+	std::vector<Int> gridStarts;
+	std::vector<Vec2i> candidates;
+};
+
+
+
+inline Vec2i LatticeCellLookup::Cell( const Real& u, const Real& v ) const
+{
+	if ( shape == CellShape::Parallelogram )
+		return Vec2i( Int( std::round(u) ), Int( std::round(v) ) );
+
+	const Real floorU = std::floor( u );
+	const Real floorV = std::floor( v );
+	const Real fracU = u - floorU;
+	const Real fracV = v - floorV;
+	// Fraction may round up to 1.
+	const Int gridX = std::min<Int>( Int( fracU * GridSize ), GridSize-1 );
+	const Int gridY = std::min<Int>( Int( fracV * GridSize ), GridSize-1 );
+	const Int gridInd = gridY * GridSize + gridX;
+	const Int start = gridStarts[gridInd];
+	const Int end = gridStarts[gridInd+1];
+	Vec2i best = candidates[start];
+	if ( end - start > 1 )
+	{
+		Real bestDist = std::numeric_limits<Real>::max();
+		for ( Int i = start; i < end; ++i )
+		{
+			const Vec2i& candidate = candidates[i];
+			const Real du = fracU - candidate[0];
+			const Real dv = fracV - candidate[1];
+			const Real x = m00*du + m01*dv;
+			const Real y = m10*du + m11*dv;
+			const Real dist = x*x + y*y;
+			if ( dist < bestDist )
+			{
+				bestDist = dist;
+				best = candidate;
+			}
+		}
+	}
+	return Vec2i( Int(floorU) + best[0], Int(floorV) + best[1] );
+}
+
+
+#endif // UTILITIES_LATTICECELLLOOKUP_H
@@ -0,0 +1,174 @@
+#include "LowDiscrepancy.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+
+using namespace lfrt;
+
+
+namespace
+{
+
+const Int SobolNumBits = 32;
+
+using SobolDirections = std::array< std::array<std::uint32_t,SobolNumBits>, SobolNumDimensions >;
+
+
+// Direction numbers for dimensions 0..3.
+// Dimension 0 is the van der Corput sequence; others use primitive polynomials x+1, x^2+x+1, x^3+x+1.
+SobolDirections BuildSobolDirections()
+{
+	struct Polynomial
+	{
+		Int degree;
+		std::uint32_t coefficients; // Inner coefficients, without the leading and trailing ones.
+		std::uint32_t initial[3]; // Initial direction numbers m_1..m_degree.
+	};
+	const Polynomial polynomials[SobolNumDimensions-1] = {
+		{ 1, 0, { 1, 0, 0 } },
+		{ 2, 1, { 1, 3, 0 } },
+		{ 3, 1, { 1, 3, 1 } },
+	};
+
+	SobolDirections directions;
+	for ( Int bit = 0; bit < SobolNumBits; ++bit )
+		directions[0][bit] = 1u << (SobolNumBits-1 - bit);
+
+	for ( Int dim = 1; dim < SobolNumDimensions; ++dim )
+	{
+		const Polynomial& poly = polynomials[dim-1];
+		const Int s = poly.degree;
+		std::array<std::uint32_t,SobolNumBits>& v = directions[dim];
+		for ( Int bit = 0; bit < s; ++bit )
+			v[bit] = poly.initial[bit] << (SobolNumBits-1 - bit);
+		for ( Int bit = s; bit < SobolNumBits; ++bit )
+		{
+			v[bit] = v[bit-s] ^ (v[bit-s] >> s);
+			for ( Int k = 1; k < s; ++k )
+			{
+				if ( (poly.coefficients >> (s-1 - k)) & 1 )
+					v[bit] ^= v[bit-k];
+			}
+		}
+	}
+	return directions;
+}
+
+
+const SobolDirections& Directions()
+{
+	static const SobolDirections directions = BuildSobolDirections();
+	return directions;
+}
+
+
+std::uint32_t ReverseBits( std::uint32_t value )
+{
+	value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+	value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+	value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+	value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+	return (value >> 16) | (value << 16);
+}
+
+} // namespace
+
+
+
+std::uint32_t SobolSample( const std::uint32_t& index, const Int& dim )
+{
+	const std::array<std::uint32_t,SobolNumBits>& v = Directions()[dim];
+	std::uint32_t result = 0;
+	std::uint32_t bits = index;
+	for ( Int bit = 0; bits != 0; ++bit, bits >>= 1 )
+	{
+		if ( bits & 1 )
+			result ^= v[bit];
+	}
+	return result;
+}
+
+
+std::uint32_t OwenScramble( const std::uint32_t& value, const std::uint32_t& seed )
+{
+	// Laine-Karras permutation only propagates from lower to higher bits, so it is applied to reversed bits.
+	std::uint32_t x = ReverseBits( value );
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return ReverseBits( x );
+}
+
+
+Real OwenScrambledRadicalInverse( std::uint64_t index, const std::uint32_t& base, const std::uint32_t& seed )
+{
+	const double invBase = 1.0 / double(base);
+	double digitScale = 1.0;
+	double result = 0.0;
+	std::uint32_t prefix = seed;
+	// Digits beyond double precision do not change the result; leading zero digits are scrambled too.
+	while ( digitScale > 1e-16 )
+	{
+		const std::uint32_t digit = std::uint32_t( index % base );
+		index /= base;
+		const std::uint32_t permuted = (digit + HashCombine( prefix, 0x9e3779b9u ) % base) % base;
+		digitScale *= invBase;
+		result += permuted * digitScale;
+		prefix = HashCombine( prefix, digit + 1 );
+	}
+	return Real( std::min( result, 1.0 - 1e-16 ) );
+}
+
+
+std::uint32_t HaltonBase( const Int& dim )
+{
+	static const std::uint32_t primes[SobolNumDimensions] = { 2, 3, 5, 7 };
+	return primes[dim];
+}
+
+
+std::uint32_t HashCombine( const std::uint32_t& seed, const std::uint32_t& value )
+{
+	// Murmur3 finalizer over the combined value.
+	std::uint32_t h = seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+
+Real FixedToUnit( const std::uint32_t& value )
+{
+	const Real unit = Real( value ) * Real( 1.0 / 4294967296.0 );
+	return std::min<Real>( unit, Real( 1.0 - 1e-7 ) );
+}
+
+
+VEC2 ConcentricSquareToDisk( const VEC2& square )
+{
+	const Real pi = 3.14159265358979323846;
+	const Real a = 2.0 * square.x - 1.0;
+	const Real b = 2.0 * square.y - 1.0;
+	if ( a == 0 && b == 0 )
+		return { 0.5, 0.5 };
+	Real radius;
+	Real angle;
+	if ( std::abs( a ) > std::abs( b ) )
+	{
+		radius = a;
+		angle = (pi / 4.0) * (b / a);
+	}
+	else
+	{
+		radius = b;
+		angle = (pi / 2.0) - (pi / 4.0) * (a / b);
+	}
+	return { 0.5 + 0.5 * radius * std::cos( angle ), 0.5 + 0.5 * radius * std::sin( angle ) };
+}
@@ -0,0 +1,37 @@
+#ifndef UTILITIES_LOWDISCREPANCY_H
+#define UTILITIES_LOWDISCREPANCY_H
+
+#include "LFRayTracer.h"
+
+#include <cstdint>
+
+
+// Number of dimensions covered by the Sobol direction table.
+const lfrt::Int SobolNumDimensions = 4;
+
+// Component 'dim' of the 'index'-th Sobol point, as 32-bit fixed point in [0,1).
+// Direction numbers are precomputed once (Joe-Kuo primitive polynomials).
+std::uint32_t SobolSample( const std::uint32_t& index, const lfrt::Int& dim );
+
+// Owen (nested uniform) scrambling of a base-2 fixed-point value, hash-based (Laine-Karras permutation).
+std::uint32_t OwenScramble( const std::uint32_t& value, const std::uint32_t& seed );
+
+// Radical inverse of 'index' in the given prime base, with Owen scrambling:
+// every digit is shifted by a hash of the seed and of all preceding digits.
+lfrt::Real OwenScrambledRadicalInverse( std::uint64_t index, const std::uint32_t& base, const std::uint32_t& seed );
+
+// Prime base of the Halton sequence for the given dimension; supports SobolNumDimensions dimensions.
+std::uint32_t HaltonBase( const lfrt::Int& dim );
+
+// Mixes value into a 32-bit seed.
+std::uint32_t HashCombine( const std::uint32_t& seed, const std::uint32_t& value );
+
+// 32-bit fixed point to [0,1), never rounding up to 1.
+lfrt::Real FixedToUnit( const std::uint32_t& value );
+
+// Shirley-Chiu concentric mapping of [0,1]x[0,1] onto the incircle of the same square.
+// Keeps stratification of the input points.
+lfrt::VEC2 ConcentricSquareToDisk( const lfrt::VEC2& square );
+
+
+#endif // UTILITIES_LOWDISCREPANCY_H
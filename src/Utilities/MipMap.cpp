@@ -0,0 +1,159 @@
+#include "MipMap.h"
+
+using namespace lfrt;
+
+
+bool MipMap::Build( const cv::Mat& image )
+{
+	levels.clear();
+	levelOffsets.clear();
+	weightsX.clear();
+	weightsY.clear();
+	if ( image.empty() || image.type() != CV_32FC3 )
+		return false;
+	levels.push_back( image );
+	weightsX.push_back( AxisWeights() );
+	weightsY.push_back( AxisWeights() );
+	while ( levels.back().cols > 1 || levels.back().rows > 1 )
+	{
+		const cv::Mat& prev = levels.back();
+		const cv::Size size( std::max( (prev.cols+1) / 2, 1 ), std::max( (prev.rows+1) / 2, 1 ) );
+		cv::Mat next;
+		cv::resize( prev, next, size, 0, 0, cv::INTER_AREA );
+		levels.push_back( next );
+		weightsX.push_back( AreaWeights( prev.cols, size.width ) );
+		weightsY.push_back( AreaWeights( prev.rows, size.height ) );
+	}
+	levelOffsets.resize( levels.size() + 1 );
+	levelOffsets[0] = 0;
+	for ( size_t level = 0; level < levels.size(); ++level )
+		levelOffsets[level+1] = levelOffsets[level] + levels[level].total();
+	return true;
+}
+
+
+void MipMap::Flatten( std::vector<Color>& texels ) const
+{
+	texels.resize( NumTexels() );
+	for ( Int level = 0; level < NumLevels(); ++level )
+	{
+		const cv::Mat& image = levels[level];
+		for ( Int y = 0; y < image.rows; ++y )
+		{
+			const Color* row = image.ptr<Color>( y );
+			std::copy( row, row + image.cols, texels.begin() + TexelIndex( level, 0, y ) );
+		}
+	}
+}
+
+
+namespace
+{
+
+// Sorts texels by index, sums repeated ones and drops zero weights.
+void MergeTexels( std::vector<MipMap::Texel>& texels )
+{
+	std::sort( texels.begin(), texels.end(),
+		[]( const MipMap::Texel& a, const MipMap::Texel& b ) { return a.first < b.first; } );
+	std::size_t count = 0;
+	for ( const MipMap::Texel& texel : texels )
+	{
+		if ( count > 0 && texels[count-1].first == texel.first )
+			texels[count-1].second += texel.second;
+		else
+			texels[count++] = texel;
+	}
+	texels.resize( count );
+	texels.erase( std::remove_if( texels.begin(), texels.end(),
+		[]( const MipMap::Texel& texel ) { return texel.second == 0; } ), texels.end() );
+}
+
+} // namespace
+
+
+void MipMap::ExpandToBase( std::vector<Texel>& texels ) const
+{
+	MergeTexels( texels );
+	if ( texels.empty() )
+		return;
+	// Levels are pushed down one at a time, merging on the way, so that overlapping footprints do not multiply.
+	std::vector<Texel> expanded;
+	const Int topLevel = Int( std::upper_bound( levelOffsets.begin(), levelOffsets.end(), texels.back().first )
+		- levelOffsets.begin() ) - 1;
+	for ( Int level = topLevel; level >= 1; --level )
+	{
+		const std::size_t levelStart = levelOffsets[level];
+		const std::size_t levelEnd = levelOffsets[level+1];
+		const Int cols = levels[level].cols;
+		expanded.clear();
+		for ( const Texel& texel : texels )
+		{
+			if ( texel.first < levelStart || texel.first >= levelEnd )
+			{
+				expanded.push_back( texel );
+				continue;
+			}
+			const std::size_t local = texel.first - levelStart;
+			const Int x = Int( local % cols );
+			const Int y = Int( local / cols );
+			for ( const auto& sourceY : weightsY[level][y] )
+			{
+				for ( const auto& sourceX : weightsX[level][x] )
+				{
+					expanded.push_back( Texel( TexelIndex( level-1, sourceX.first, sourceY.first ),
+						texel.second * sourceX.second * sourceY.second ) );
+				}
+			}
+		}
+		MergeTexels( expanded );
+		texels.swap( expanded );
+	}
+}
+
+
+// Same weights as cv::resize with INTER_AREA: every destination pixel averages the source interval it covers,
+// with partially covered source pixels weighted by their coverage.
+MipMap::AxisWeights MipMap::AreaWeights( const Int& srcSize, const Int& dstSize )
+{
+	AxisWeights weights( dstSize );
+	const Real scale = Real(srcSize) / Real(dstSize);
+	for ( Int dst = 0; dst < dstSize; ++dst )
+	{
+		const Real start = dst * scale;
+		const Real end = std::min<Real>( start + scale, srcSize );
+		const Real width = end - start;
+		for ( Int src = Int( std::floor( start ) ); src < end; ++src )
+		{
+			const Real overlap = std::min<Real>( src+1, end ) - std::max<Real>( src, start );
+			if ( overlap > 0 )
+				weights[dst].push_back( std::make_pair( src, float( overlap / width ) ) );
+		}
+	}
+	return weights;
+}
+
+
+MipMap::Color MipMap::Bilinear( const Int& level, const Real& x, const Real& y ) const
+{
+	ColorSum visitor{ *this, Color( 0, 0, 0 ) };
+	VisitBilinear( level, x, y, 1.0f, visitor );
+	return visitor.sum;
+}
+
+
+MipMap::Color MipMap::Trilinear( const Real& x, const Real& y, const Real& width ) const
+{
+	ColorSum visitor{ *this, Color( 0, 0, 0 ) };
+	VisitTrilinear( x, y, width, 1.0f, visitor );
+	return visitor.sum;
+}
+
+
+MipMap::Color MipMap::Anisotropic( const Real& x, const Real& y,
+	const Real& dx0, const Real& dy0, const Real& dx1, const Real& dy1,
+	const Int& maxAnisotropy ) const
+{
+	ColorSum visitor{ *this, Color( 0, 0, 0 ) };
+	VisitAnisotropic( x, y, dx0, dy0, dx1, dy1, maxAnisotropy, 1.0f, visitor );
+	return visitor.sum;
+}
@@ -0,0 +1,181 @@
+#ifndef UTILITIES_MIPMAP_H
+#define UTILITIES_MIPMAP_H
+
+#include "LFRayTracer.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Mip pyramid of a CV_32FC3 image with filtered lookups.
+// Coordinates are continuous pixel coordinates of level 0: pixel (x,y) covers [x,x+1)x[y,y+1).
+// Lookups clamp to the image border.
+// Every lookup is a weighted sum of texels; Visit* versions report them as
+//     visitor( const Int& level, const Int& x, const Int& y, const float& weight ),
+// so that the weights can be recorded and applied to another image of the same size later.
+class MipMap
+{
+public:
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+	using Color = cv::Vec3f;
+	// Pyramid texel index (see TexelIndex) and its weight.
+	using Texel = std::pair<std::size_t,float>;
+
+	// Builds the pyramid down to 1x1; every level halves the previous one with area averaging.
+	bool Build( const cv::Mat& image );
+
+	Int NumLevels() const { return Int(levels.size()); }
+	const cv::Mat& Level( const Int& level ) const { return levels[level]; }
+
+	// Index of texel (x,y) of the given level in the pyramid flattened level by level, row-major.
+	std::size_t TexelIndex( const Int& level, const Int& x, const Int& y ) const
+	{
+		return levelOffsets[level] + std::size_t(y) * levels[level].cols + x;
+	}
+	std::size_t NumTexels() const { return levelOffsets.empty() ? 0 : levelOffsets.back(); }
+	// All texels in TexelIndex order.
+	void Flatten( std::vector<Color>& texels ) const;
+
+	// Replaces texels of coarser levels by the level-0 pixels they average, so that the weighted sum is unchanged.
+	// Result is sorted by index, without repeated or zero-weight texels.
+	// Coarse texels expand to many pixels, as many as their footprint covers.
+	void ExpandToBase( std::vector<Texel>& texels ) const;
+
+	// Bilinear lookup in the given level.
+	Color Bilinear( const Int& level, const Real& x, const Real& y ) const;
+
+	// Trilinear lookup of an isotropic footprint of the given width, in level-0 pixels.
+	Color Trilinear( const Real& x, const Real& y, const Real& width ) const;
+
+	// Anisotropic lookup of the parallelogram footprint spanned by the axes (dx0,dy0) and (dx1,dy1), in level-0 pixels.
+	// Level is selected by the minor axis, and up to 'maxAnisotropy' trilinear probes are spread along the major one.
+	Color Anisotropic( const Real& x, const Real& y,
+		const Real& dx0, const Real& dy0, const Real& dx1, const Real& dy1,
+		const Int& maxAnisotropy = 8 ) const;
+
+	template< class VisitorT >
+	void VisitBilinear( const Int& level, const Real& x, const Real& y, const float& weight, VisitorT& visitor ) const;
+
+	template< class VisitorT >
+	void VisitTrilinear( const Real& x, const Real& y, const Real& width, const float& weight, VisitorT& visitor ) const;
+
+	template< class VisitorT >
+	void VisitAnisotropic( const Real& x, const Real& y,
+		const Real& dx0, const Real& dy0, const Real& dx1, const Real& dy1,
+		const Int& maxAnisotropy, const float& weight, VisitorT& visitor ) const;
+
+private:
+	// Visitor which sums texel colors.
+	struct ColorSum
+	{
+		void operator()( const Int& level, const Int& x, const Int& y, const float& weight )
+		{
+			sum += weight * map.levels[level].ptr<Color>( y )[x];
+		}
+		const MipMap& map;
+		Color sum;
+	};
+
+private:
+	// Area weights along one axis: pixels of the previous (finer) level averaged by every pixel of a level.
+	using AxisWeights = std::vector< std::vector< std::pair<Int,float> > >;
+
+	static AxisWeights AreaWeights( const Int& srcSize, const Int& dstSize );
+
+private:
+	std::vector<cv::Mat> levels;
+	std::vector<std::size_t> levelOffsets; // NumLevels()+1 elements.
+	std::vector<AxisWeights> weightsX; // Per level; empty for level 0.
+	std::vector<AxisWeights> weightsY;
+};
+
+
+
+template< class VisitorT >
+void MipMap::VisitBilinear( const Int& level, const Real& x, const Real& y, const float& weight, VisitorT& visitor ) const
+{
+	const cv::Mat& image = levels[level];
+	// Level coordinates, with pixel centers at integers.
+	const Real levelX = x * Real(image.cols) / Real(levels[0].cols) - 0.5;
+	const Real levelY = y * Real(image.rows) / Real(levels[0].rows) - 0.5;
+	const Real floorX = std::floor( levelX );
+	const Real floorY = std::floor( levelY );
+	const float fracX = float( levelX - floorX );
+	const float fracY = float( levelY - floorY );
+	const Int x0 = std::min<Int>( std::max<Int>( Int(floorX), 0 ), image.cols-1 );
+	const Int y0 = std::min<Int>( std::max<Int>( Int(floorY), 0 ), image.rows-1 );
+	const Int x1 = std::min<Int>( std::max<Int>( Int(floorX)+1, 0 ), image.cols-1 );
+	const Int y1 = std::min<Int>( std::max<Int>( Int(floorY)+1, 0 ), image.rows-1 );
+	visitor( level, x0, y0, weight * (1.0f - fracX) * (1.0f - fracY) );
+	visitor( level, x1, y0, weight * fracX * (1.0f - fracY) );
+	visitor( level, x0, y1, weight * (1.0f - fracX) * fracY );
+	visitor( level, x1, y1, weight * fracX * fracY );
+}
+
+
+template< class VisitorT >
+void MipMap::VisitTrilinear( const Real& x, const Real& y, const Real& width, const float& weight, VisitorT& visitor ) const
+{
+	if ( levels.empty() )
+		return;
+	// Level whose pixel size equals footprint width.
+	const Real level = std::log2( std::max<Real>( width, 1 ) );
+	const Int maxLevel = NumLevels() - 1;
+	if ( level >= maxLevel )
+	{
+		VisitBilinear( maxLevel, x, y, weight, visitor );
+		return;
+	}
+	const Int level0 = Int( level );
+	const float frac = float( level - Real(level0) );
+	VisitBilinear( level0, x, y, weight * (1.0f - frac), visitor );
+	if ( frac != 0 )
+		VisitBilinear( level0+1, x, y, weight * frac, visitor );
+}
+
+
+template< class VisitorT >
+void MipMap::VisitAnisotropic( const Real& x, const Real& y,
+	const Real& dx0, const Real& dy0, const Real& dx1, const Real& dy1,
+	const Int& maxAnisotropy, const float& weight, VisitorT& visitor ) const
+{
+	const Real length0 = std::sqrt( dx0*dx0 + dy0*dy0 );
+	const Real length1 = std::sqrt( dx1*dx1 + dy1*dy1 );
+	const bool isFirstMajor = length0 >= length1;
+	const Real majorLength = isFirstMajor ? length0 : length1;
+	const Real majorX = isFirstMajor ? dx0 : dx1;
+	const Real majorY = isFirstMajor ? dy0 : dy1;
+	Real minorLength = isFirstMajor ? length1 : length0;
+	if ( majorLength <= 1 )
+	{
+		VisitTrilinear( x, y, majorLength, weight, visitor );
+		return;
+	}
+
+	// Clamp eccentricity by blurring along the minor axis rather than taking more probes.
+	const Int maxProbes = std::max<Int>( maxAnisotropy, 1 );
+	minorLength = std::max( minorLength, majorLength / Real(maxProbes) );
+	const Int numProbes = std::min<Int>( Int( std::ceil( majorLength / minorLength ) ), maxProbes );
+	if ( numProbes <= 1 )
+	{
+		VisitTrilinear( x, y, majorLength, weight, visitor );
+		return;
+	}
+
+	// Probes are placed at the centers of equal segments of the major axis.
+	const float probeWeight = weight / float(numProbes);
+	for ( Int i = 0; i < numProbes; ++i )
+	{
+		const Real t = (Real(i) + 0.5) / Real(numProbes) - 0.5;
+		VisitTrilinear( x + t*majorX, y + t*majorY, minorLength, probeWeight, visitor );
+	}
+}
+
+
+#endif // UTILITIES_MIPMAP_H
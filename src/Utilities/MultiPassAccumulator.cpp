@@ -0,0 +1,143 @@
+#include "MultiPassAccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+using namespace lfrt;
+
+
+bool MultiPassAccumulator::GetRenderBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const
+{
+    if ( hasDirtyRegions )
+    {
+        startX = dirtyBounds.x;
+        startY = dirtyBounds.y;
+        endX = dirtyBounds.x + dirtyBounds.width;
+        endY = dirtyBounds.y + dirtyBounds.height;
+        return true;
+    }
+    startX = 0;
+    startY = 0;
+    endX = Width();
+    endY = Height();
+    return true;
+}
+
+
+bool MultiPassAccumulator::GetSamplingBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const
+{
+    if ( !GetRenderBounds( startX, startY, endX, endY ) )
+        return false;
+    const Int margin = SamplingMargin();
+    startX = std::max<Int>( startX - margin, 0 );
+    startY = std::max<Int>( startY - margin, 0 );
+    endX = std::min<Int>( endX + margin, Width() );
+    endY = std::min<Int>( endY + margin, Height() );
+    return true;
+}
+
+
+void MultiPassAccumulator::SetDirtyRegions( const std::vector<cv::Rect>& regions )
+{
+    cv::Mat mask = cv::Mat::zeros( Height(), Width(), CV_8UC1 );
+    const cv::Rect image( 0, 0, Width(), Height() );
+    for ( const cv::Rect& region : regions )
+    {
+        const cv::Rect clipped = region & image;
+        if ( !clipped.empty() )
+            mask( clipped ).setTo( cv::Scalar::all(255) );
+    }
+    SetDirtyMask( mask );
+}
+
+
+bool MultiPassAccumulator::SetDirtyMask( const cv::Mat& mask )
+{
+    if ( mask.rows != Height() || mask.cols != Width() || mask.type() != CV_8UC1 )
+        return false;
+
+    // Bounding box of dirty pixels.
+    Int minX = Width();
+    Int minY = Height();
+    Int maxX = -1;
+    Int maxY = -1;
+    renderMask = cv::Mat::zeros( Height(), Width(), CV_8UC1 );
+    for ( Int y = 0; y < Height(); ++y )
+    {
+        const unsigned char* src = mask.ptr<unsigned char>(y);
+        unsigned char* dst = renderMask.ptr<unsigned char>(y);
+        for ( Int x = 0; x < Width(); ++x )
+        {
+            if ( src[x] == 0 )
+                continue;
+            dst[x] = 255;
+            minX = std::min( minX, x );
+            minY = std::min( minY, y );
+            maxX = std::max( maxX, x );
+            maxY = std::max( maxY, y );
+        }
+    }
+    hasDirtyRegions = true;
+    dirtyBounds = maxX >= minX ? cv::Rect( minX, minY, maxX-minX+1, maxY-minY+1 ) : cv::Rect( 0, 0, 0, 0 );
+
+    const Int margin = SamplingMargin();
+    if ( margin > 0 )
+    {
+        const cv::Mat kernel = cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 2*margin+1, 2*margin+1 ) );
+        cv::dilate( renderMask, samplingMask, kernel );
+    }
+    else
+    {
+        samplingMask = renderMask;
+    }
+    return true;
+}
+
+
+void MultiPassAccumulator::ClearDirtyRegions()
+{
+    hasDirtyRegions = false;
+    dirtyBounds = cv::Rect();
+    renderMask.release();
+    samplingMask.release();
+}
+
+
+Int MultiPassAccumulator::SelectUnconverged( const Real& threshold, cv::Mat& mask ) const
+{
+    mask = cv::Mat::zeros( Height(), Width(), CV_8UC1 );
+    Int startX, startY, endX, endY;
+    if ( !GetRenderBounds( startX, startY, endX, endY ) )
+        return 0;
+    cv::Mat error;
+    EstimateError( error );
+    Int numSelected = 0;
+    for ( Int y = startY; y < endY; ++y )
+    {
+        const float* errorRow = error.ptr<float>(y);
+        const unsigned char* dirtyRow = hasDirtyRegions ? renderMask.ptr<unsigned char>(y) : nullptr;
+        unsigned char* row = mask.ptr<unsigned char>(y);
+        for ( Int x = startX; x < endX; ++x )
+        {
+            if ( dirtyRow != nullptr && dirtyRow[x] == 0 )
+                continue;
+            if ( errorRow[x] > threshold )
+            {
+                row[x] = 255;
+                ++numSelected;
+            }
+        }
+    }
+    return numSelected;
+}
+
+
+Real MultiPassAccumulator::StandardError( const Real& sumLum, const Real& sumWeight, const Real& sumSqLum, const Real& count )
+{
+    if ( sumWeight <= 0 || count <= 0 )
+        return 0;
+    const Real mean = sumLum / sumWeight;
+    const Real variance = std::max<Real>( sumSqLum / sumWeight - mean*mean, 0 );
+    return std::sqrt( variance / count );
+}
@@ -0,0 +1,77 @@
+#ifndef UTILITIES_MULTIPASSACCUMULATOR_H
+#define UTILITIES_MULTIPASSACCUMULATOR_H
+
+#include "LFRayTracer.h"
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+
+// Accumulator which can collect several rendering passes and estimate per-pixel error.
+// Rendering may be restricted to dirty regions, keeping the previous result elsewhere.
+// Is used by TileRenderEngine for adaptive, progressive and incremental rendering.
+class MultiPassAccumulator : public lfrt::SampleAccumulator
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+
+public:
+    // Bounding box of dirty regions, or the whole image if there are none.
+    virtual bool GetRenderBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const override;
+    // Render bounds extended by SamplingMargin.
+    virtual bool GetSamplingBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const override;
+
+    // Distance in pixels at which samples still contribute to a pixel.
+    virtual Int SamplingMargin() const { return 0; }
+
+    // Restrict rendering to the given pixel rectangles. Should be called after SetSize; SetSize resets regions.
+    void SetDirtyRegions( const std::vector<cv::Rect>& regions );
+    // Restrict rendering to non-zero pixels of 'mask' (CV_8UC1 of accumulator size).
+    bool SetDirtyMask( const cv::Mat& mask );
+    // Render whole image again.
+    void ClearDirtyRegions();
+    bool HasDirtyRegions() const { return hasDirtyRegions; }
+    // Dirty pixels (CV_8UC1), valid if HasDirtyRegions.
+    const cv::Mat& RenderMask() const { return renderMask; }
+    // Dirty pixels extended by SamplingMargin (CV_8UC1), valid if HasDirtyRegions.
+    const cv::Mat& SamplingMask() const { return samplingMask; }
+
+    // Add tile content to the accumulated values instead of replacing them, as MergeSampleTile does.
+    virtual bool AddSampleTile( lfrt::SampleTile* tile ) = 0;
+
+    // Per-pixel standard error of the mean luminance (CV_32FC1), estimated from running variance.
+    virtual void EstimateError( cv::Mat& error ) const = 0;
+
+    // Reset accumulated values of pixels [startX,endX)x[startY,endY) to zero.
+    // Is called before the first pass, so that accumulators with additive merge start from scratch.
+    virtual void Clear( const Int& startX, const Int& startY, const Int& endX, const Int& endY ) = 0;
+
+    // Resolved image (BGR), CV_32FC3 or CV_16FC3 if HalfPrecisionOutput is set.
+    virtual void SaveToImage( cv::Mat& image ) const = 0;
+
+    // Mark pixels of render bounds whose estimated error is above 'threshold' (CV_8UC1, non-zero if marked).
+    // Only dirty pixels are marked if dirty regions are set. Returns number of marked pixels.
+    Int SelectUnconverged( const Real& threshold, cv::Mat& mask ) const;
+
+    static Real Luminance( const Real& r, const Real& g, const Real& b )
+    {
+        return 0.2126*r + 0.7152*g + 0.0722*b;
+    }
+
+    // Standard error of the mean from weighted sums of luminance and squared luminance.
+    static Real StandardError( const Real& sumLum, const Real& sumWeight, const Real& sumSqLum, const Real& count );
+
+public:
+    // Only the resolved image is stored in half precision; accumulation stays in float.
+    bool HalfPrecisionOutput = false;
+
+private:
+    bool hasDirtyRegions = false;
+    cv::Rect dirtyBounds;
+    cv::Mat renderMask;
+    cv::Mat samplingMask;
+};
+
+
+#endif // UTILITIES_MULTIPASSACCUMULATOR_H
@@ -4,12 +4,13 @@
 void CVParallel2D( const Int& width, const Int& height, std::function<void(const Int x, const Int y)> functor )
 {
 	cv::parallel_for_(
-		cv::Range( 0, width*height ),
+		cv::Range( 0, height ),
 		cv::ParallelLoopBodyLambdaWrapper( [&]( const cv::Range& range )
 			{
-				for ( int pixelInd = range.start; pixelInd < range.end; ++pixelInd )
+				for ( Int y = range.start; y < range.end; ++y )
 				{
-					functor( pixelInd % width, pixelInd / width );
+					for ( Int x = 0; x < width; ++x )
+						functor( x, y );
 				}
 			} )
 	);
@@ -0,0 +1,36 @@
+#include "Philox.h"
+
+
+namespace
+{
+
+const std::uint32_t PhiloxMul0 = 0xD2511F53u;
+const std::uint32_t PhiloxMul1 = 0xCD9E8D57u;
+const std::uint32_t PhiloxWeyl0 = 0x9E3779B9u;
+const std::uint32_t PhiloxWeyl1 = 0xBB67AE85u;
+const int PhiloxNumRounds = 10;
+
+
+inline void MulHiLo( const std::uint32_t& a, const std::uint32_t& b, std::uint32_t& hi, std::uint32_t& lo )
+{
+	const std::uint64_t product = std::uint64_t(a) * std::uint64_t(b);
+	hi = std::uint32_t( product >> 32 );
+	lo = std::uint32_t( product );
+}
+
+}
+
+
+PhiloxCounter Philox4x32( PhiloxCounter counter, PhiloxKey key )
+{
+	for ( int round = 0; round < PhiloxNumRounds; ++round )
+	{
+		std::uint32_t hi0, lo0, hi1, lo1;
+		MulHiLo( PhiloxMul0, counter[0], hi0, lo0 );
+		MulHiLo( PhiloxMul1, counter[2], hi1, lo1 );
+		counter = { hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0 };
+		key[0] += PhiloxWeyl0;
+		key[1] += PhiloxWeyl1;
+	}
+	return counter;
+}
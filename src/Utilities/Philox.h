@@ -0,0 +1,18 @@
+#ifndef UTILITIES_PHILOX_H
+#define UTILITIES_PHILOX_H
+
+#include <array>
+#include <cstdint>
+
+
+// Counter-based random number generator Philox-4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// Output is a pure function of counter and key, so that any sample can be generated independently
+// of the order in which threads visit pixels, and generator has no state to copy.
+using PhiloxCounter = std::array<std::uint32_t,4>;
+using PhiloxKey = std::array<std::uint32_t,2>;
+
+// Four independent 32-bit random words for the given counter and key.
+PhiloxCounter Philox4x32( PhiloxCounter counter, PhiloxKey key );
+
+
+#endif // UTILITIES_PHILOX_H
@@ -0,0 +1,27 @@
+#include "RayBatchBuffer.h"
+
+#include <algorithm>
+
+
+
+RayBatchBuffer::RayBatchBuffer( const Int& capacity )
+{
+	Reserve( capacity );
+}
+
+
+void RayBatchBuffer::Reserve( const Int& count )
+{
+	if ( count <= capacity && !storage.empty() )
+		return;
+	capacity = std::max<Int>( count, 1 );
+	storage.resize( 7 * capacity );
+	Real* data = storage.data();
+	batch.oriX   = data + 0*capacity;
+	batch.oriY   = data + 1*capacity;
+	batch.oriZ   = data + 2*capacity;
+	batch.dirX   = data + 3*capacity;
+	batch.dirY   = data + 4*capacity;
+	batch.dirZ   = data + 5*capacity;
+	batch.weight = data + 6*capacity;
+}
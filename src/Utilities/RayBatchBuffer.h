@@ -0,0 +1,33 @@
+#ifndef UTILITIES_RAYBATCHBUFFER_H
+#define UTILITIES_RAYBATCHBUFFER_H
+
+#include "LFRayTracer.h"
+
+#include <vector>
+
+
+// Owning storage for lfrt::RayBatch.
+// Capacity only grows, so the same buffer can be reused for every pixel of a tile.
+class RayBatchBuffer
+{
+public:
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+
+	RayBatchBuffer( const Int& capacity = 0 );
+
+	// Make sure that buffer can hold at least 'count' rays.
+	void Reserve( const Int& count );
+
+	Int Capacity() const { return capacity; }
+
+	const lfrt::RayBatch& Batch() const { return batch; }
+
+private:
+	std::vector<Real> storage;
+	lfrt::RayBatch batch = lfrt::RayBatch();
+	Int capacity = 0;
+};
+
+
+#endif // UTILITIES_RAYBATCHBUFFER_H
@@ -1,5 +1,7 @@
 #include "RayGenFocusEye.h"
 
+#include <cmath>
+
 using namespace lfrt;
 
 
@@ -43,4 +45,105 @@ Real RayGenFocusEye::GenerateRay( const VEC2& raster, const VEC2& secondary, VEC
 	}
 
 	return 1.0;
-}
\ No newline at end of file
+}
+
+void RayGenFocusEye::GenerateRays( const Int& count, const VEC2* raster, const VEC2* secondary, const lfrt::RayBatch& rays ) const
+{
+	const Real width = Real(Width);
+	const Real height = Real(Height);
+	const Real scaleX = (RetinaEnd.x - RetinaStart.x) / width;
+	const Real scaleY = (RetinaEnd.y - RetinaStart.y) / height;
+
+	// Branch on focus mode once, so that both loops are branch-free and vectorizable.
+	if ( InFocusPlaneZ != 0 )
+	{
+		const Real coef = InFocusPlaneZ / RetinaPlaneZ;
+		for ( Int i = 0; i < count; ++i )
+		{
+			const Real rasterX = raster[i].x;
+			const Real rasterY = raster[i].y;
+			const bool isInside = rasterX >= 0 && rasterY >= 0 && rasterX <= width && rasterY <= height;
+			const Real retinaX = RetinaStart.x + rasterX * scaleX;
+			const Real retinaY = RetinaEnd.y - rasterY * scaleY;
+			const Real apertureX = (-1.0 + 2.0*secondary[i].x)*ApertureRadius;
+			const Real apertureY = (-1.0 + 2.0*secondary[i].y)*ApertureRadius;
+			rays.oriX[i] = apertureX;
+			rays.oriY[i] = apertureY;
+			rays.oriZ[i] = 0;
+			rays.dirX[i] = retinaX*coef - apertureX;
+			rays.dirY[i] = retinaY*coef - apertureY;
+			rays.dirZ[i] = InFocusPlaneZ;
+			rays.weight[i] = isInside ? Real(1) : Real(0);
+		}
+	}
+	else
+	{
+		// Pinhole camera.
+		for ( Int i = 0; i < count; ++i )
+		{
+			const Real rasterX = raster[i].x;
+			const Real rasterY = raster[i].y;
+			const bool isInside = rasterX >= 0 && rasterY >= 0 && rasterX <= width && rasterY <= height;
+			rays.oriX[i] = 0;
+			rays.oriY[i] = 0;
+			rays.oriZ[i] = 0;
+			rays.dirX[i] = -(RetinaStart.x + rasterX * scaleX);
+			rays.dirY[i] = -(RetinaEnd.y - rasterY * scaleY);
+			rays.dirZ[i] = -RetinaPlaneZ;
+			rays.weight[i] = isInside ? Real(1) : Real(0);
+		}
+	}
+}
+
+
+Real RayGenFocusEye::GenerateRayDifferential(
+	const VEC2& raster, const VEC2& secondary,
+	VEC3& ori, VEC3& dir,
+	VEC3& oridx, VEC3& dirdx,
+	VEC3& oridy, VEC3& dirdy ) const
+{
+	const Real weight = GenerateRay( raster, secondary, ori, dir );
+	oridx = oridy = dirdx = dirdy = { 0, 0, 0 };
+	if ( weight <= 0 )
+		return weight;
+	// Origin depends only on the aperture position; direction is affine in retina position.
+	const Real retinaDx =  (RetinaEnd.x - RetinaStart.x) / Real(Width);
+	const Real retinaDy = -(RetinaEnd.y - RetinaStart.y) / Real(Height);
+	const Real coef = ( InFocusPlaneZ != 0 ) ? InFocusPlaneZ / RetinaPlaneZ : -1.0;
+	dirdx.x = retinaDx * coef;
+	dirdy.y = retinaDy * coef;
+	return weight;
+}
+
+
+unsigned RayGenFocusEye::UsedDimensions() const
+{
+	if ( InFocusPlaneZ == 0 )
+		return lfrt::SampleDimRaster;
+	return lfrt::SampleDimAll;
+}
+
+
+VEC2 RayGenFocusEye::RetinaPosition( const VEC2& raster ) const
+{
+	const VEC2 lambda({ raster.x / Real(Width), 1.0 - raster.y / Real(Height) });
+	return VEC2({
+		RetinaStart.x + lambda.x * (RetinaEnd.x - RetinaStart.x),
+		RetinaStart.y + lambda.y * (RetinaEnd.y - RetinaStart.y) });
+}
+
+
+Real RayGenFocusEye::Eccentricity( const VEC2& raster, const VEC2& gazeRaster ) const
+{
+	// Both chief rays pass through the aperture center at the origin.
+	const VEC2 posA = RetinaPosition( raster );
+	const VEC2 posB = RetinaPosition( gazeRaster );
+	const Real z = RetinaPlaneZ;
+	const Real dot = posA.x*posB.x + posA.y*posB.y + z*z;
+	const Real crossX = posA.y*z - z*posB.y;
+	const Real crossY = z*posB.x - posA.x*z;
+	const Real crossZ = posA.x*posB.y - posA.y*posB.x;
+	const Real cross = std::sqrt( crossX*crossX + crossY*crossY + crossZ*crossZ );
+	const Real radToDeg = 57.295779513082320876;
+	return std::atan2( cross, dot ) * radToDeg;
+}
@@ -11,7 +11,7 @@
 // Rays corresponding to the same retina point intersect at z=InFocusPlaneZ.
 // If InFocusPlaneZ=0, then use pinhole camera model.
 // Ray direction is from origin towards point on the image plane.
-class RayGenFocusEye : public lfrt::RayGenerator
+class RayGenFocusEye final : public lfrt::RayGenerator
 {
 public:
 	using Real = lfrt::Real;
@@ -27,6 +27,26 @@ public:
 		const VEC2& raster, const VEC2& secondary,
 		VEC3& ori, VEC3& dir ) const override;
 
+	virtual void GenerateRays(
+		const Int& count, const VEC2* raster, const VEC2* secondary,
+		const lfrt::RayBatch& rays ) const override;
+
+	virtual Real GenerateRayDifferential(
+		const VEC2& raster, const VEC2& secondary,
+		VEC3& ori, VEC3& dir,
+		VEC3& oridx, VEC3& dirdx,
+		VEC3& oridy, VEC3& dirdy ) const override;
+
+	// Pinhole model (InFocusPlaneZ=0) does not use secondary samples.
+	virtual unsigned UsedDimensions() const override;
+
+	// Position of the raster point on the retina plane.
+	VEC2 RetinaPosition( const VEC2& raster ) const;
+
+	// Visual angle in degrees between the chief rays (through aperture center) of two raster points,
+	// e.g., retinal eccentricity of a pixel relative to the gaze point.
+	Real Eccentricity( const VEC2& raster, const VEC2& gazeRaster ) const;
+
 	Real RetinaPlaneZ = -1.0;
 	Real InFocusPlaneZ = 0.0;
 	VEC2 RetinaStart = VEC2({ -1.0, -1.0 });
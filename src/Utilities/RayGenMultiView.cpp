@@ -0,0 +1,111 @@
+#include "RayGenMultiView.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace lfrt;
+
+
+namespace
+{
+
+// Number of local raster positions converted at once in GenerateRays.
+const Int LocalBatchSize = 64;
+
+} // namespace
+
+
+
+RayGenMultiView::RayGenMultiView( const Int& viewWidth, const Int& viewHeight )
+	:ViewWidth(viewWidth)
+	,ViewHeight(viewHeight)
+{
+}
+
+
+RayGenMultiView::RayGenMultiView( const Int& viewWidth, const Int& viewHeight,
+	const std::vector< std::shared_ptr<const lfrt::RayGenerator> >& views )
+	:ViewWidth(viewWidth)
+	,ViewHeight(viewHeight)
+	,Views(views)
+{
+}
+
+
+Int RayGenMultiView::ViewIndex( const VEC2& raster ) const
+{
+	if ( ViewHeight <= 0 || raster.y < 0 || raster.y > AtlasHeight() )
+		return -1;
+	// Bottom edge of the atlas belongs to the last view.
+	return std::min<Int>( Int( std::floor( raster.y / ViewHeight ) ), NumViews()-1 );
+}
+
+
+Real RayGenMultiView::GenerateRay( const VEC2& raster, const VEC2& secondary, VEC3& ori, VEC3& dir ) const
+{
+	const Int viewInd = ViewIndex( raster );
+	if ( viewInd < 0 )
+		return 0.0;
+	const VEC2 local({ raster.x, raster.y - viewInd*ViewHeight });
+	return Views[viewInd]->GenerateRay( local, secondary, ori, dir );
+}
+
+
+void RayGenMultiView::GenerateRays( const Int& count, const VEC2* raster, const VEC2* secondary, const lfrt::RayBatch& rays ) const
+{
+	VEC2 local[LocalBatchSize];
+	Int start = 0;
+	while ( start < count )
+	{
+		// Run of rays which belong to the same view.
+		const Int viewInd = ViewIndex( raster[start] );
+		Int end = start + 1;
+		while ( end < count && end - start < LocalBatchSize && ViewIndex( raster[end] ) == viewInd )
+			++end;
+
+		if ( viewInd < 0 )
+		{
+			for ( Int i = start; i < end; ++i )
+				rays.weight[i] = 0;
+		}
+		else
+		{
+			const Real offsetY = Real( viewInd*ViewHeight );
+			for ( Int i = start; i < end; ++i )
+				local[i-start] = VEC2({ raster[i].x, raster[i].y - offsetY });
+			const lfrt::RayBatch run = {
+				rays.oriX + start, rays.oriY + start, rays.oriZ + start,
+				rays.dirX + start, rays.dirY + start, rays.dirZ + start,
+				rays.weight + start };
+			Views[viewInd]->GenerateRays( end - start, local, secondary + start, run );
+		}
+		start = end;
+	}
+}
+
+
+Real RayGenMultiView::GenerateRayDifferential(
+	const VEC2& raster, const VEC2& secondary,
+	VEC3& ori, VEC3& dir,
+	VEC3& oridx, VEC3& dirdx,
+	VEC3& oridy, VEC3& dirdy ) const
+{
+	const Int viewInd = ViewIndex( raster );
+	if ( viewInd < 0 )
+	{
+		oridx = oridy = dirdx = dirdy = { 0, 0, 0 };
+		return 0.0;
+	}
+	const VEC2 local({ raster.x, raster.y - viewInd*ViewHeight });
+	return Views[viewInd]->GenerateRayDifferential( local, secondary, ori, dir, oridx, dirdx, oridy, dirdy );
+}
+
+
+unsigned RayGenMultiView::UsedDimensions() const
+{
+	// Raster is always used to select the view.
+	unsigned dims = SampleDimRaster;
+	for ( const auto& view : Views )
+		dims |= view->UsedDimensions();
+	return dims;
+}
@@ -0,0 +1,65 @@
+#ifndef UTILITIES_RAYGENMULTIVIEW_H
+#define UTILITIES_RAYGENMULTIVIEW_H
+
+#include "LFRayTracer.h"
+
+#include <memory>
+#include <vector>
+
+
+// Atlas of several views of equal size, stacked vertically:
+// view 'i' occupies raster rows [i*ViewHeight,(i+1)*ViewHeight).
+// Every raster position is passed to the ray generator of its view in that view's own coordinates,
+// so that all views are rendered by a single Render call into an atlas-sized accumulator (see SampleAccumLayered).
+class RayGenMultiView final : public lfrt::RayGenerator
+{
+public:
+	using Real = lfrt::Real;
+	using Int = lfrt::Int;
+	using VEC2 = lfrt::VEC2;
+	using VEC3 = lfrt::VEC3;
+
+	RayGenMultiView( const Int& viewWidth, const Int& viewHeight );
+
+	RayGenMultiView( const Int& viewWidth, const Int& viewHeight,
+		const std::vector< std::shared_ptr<const lfrt::RayGenerator> >& views );
+
+	virtual ~RayGenMultiView() = default;
+
+	void AddView( const std::shared_ptr<const lfrt::RayGenerator>& view ) { Views.push_back( view ); }
+
+	Int NumViews() const { return Int(Views.size()); }
+	Int AtlasWidth() const { return ViewWidth; }
+	Int AtlasHeight() const { return ViewHeight * NumViews(); }
+
+	virtual Real GenerateRay(
+		const VEC2& raster, const VEC2& secondary,
+		VEC3& ori, VEC3& dir ) const override;
+
+	// Consecutive rays of the same view are passed to its generator together.
+	virtual void GenerateRays(
+		const Int& count, const VEC2* raster, const VEC2* secondary,
+		const lfrt::RayBatch& rays ) const override;
+
+	virtual Real GenerateRayDifferential(
+		const VEC2& raster, const VEC2& secondary,
+		VEC3& ori, VEC3& dir,
+		VEC3& oridx, VEC3& dirdx,
+		VEC3& oridy, VEC3& dirdy ) const override;
+
+	// Union of dimensions used by the views.
+	virtual unsigned UsedDimensions() const override;
+
+private:
+	// View of the atlas raster position; -1 if it is outside of the atlas.
+	Int ViewIndex( const VEC2& raster ) const;
+
+public:
+	Int ViewWidth = 0;
+	Int ViewHeight = 0;
+	std::vector< std::shared_ptr<const lfrt::RayGenerator> > Views;
+};
+
+
+
+#endif // UTILITIES_RAYGENMULTIVIEW_H
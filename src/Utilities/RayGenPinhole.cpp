@@ -76,3 +76,46 @@ Real RayGenPinhole::GenerateRay(
 
     return 1.0;
 }
+
+
+void RayGenPinhole::GenerateRays(
+    const Int& count, const VEC2* raster, const VEC2* /*secondary*/,
+    const lfrt::RayBatch& rays ) const
+{
+    const Real width = Real(Width);
+    const Real height = Real(Height);
+    const Real scaleX = (MaxX - MinX) / width;
+    const Real scaleY = (MaxY - MinY) / height;
+
+    // Branch-free loop, so that compiler is able to vectorize it.
+    for ( Int i = 0; i < count; ++i )
+    {
+        const Real rasterX = raster[i].x;
+        const Real rasterY = raster[i].y;
+        const bool isInside = rasterX >= 0 && rasterY >= 0 && rasterX <= width && rasterY <= height;
+        rays.oriX[i] = OriginX;
+        rays.oriY[i] = OriginY;
+        rays.oriZ[i] = 0;
+        rays.dirX[i] = MinX + rasterX * scaleX - OriginX;
+        rays.dirY[i] = MaxY - rasterY * scaleY - OriginY;
+        rays.dirZ[i] = ImagePlaneDepth;
+        rays.weight[i] = isInside ? Real(1) : Real(0);
+    }
+}
+
+
+Real RayGenPinhole::GenerateRayDifferential(
+    const VEC2& raster, const VEC2& secondary,
+    VEC3& ori, VEC3& dir,
+    VEC3& oridx, VEC3& dirdx,
+    VEC3& oridy, VEC3& dirdy ) const
+{
+    const Real weight = GenerateRay( raster, secondary, ori, dir );
+    oridx = oridy = dirdx = dirdy = { 0, 0, 0 };
+    if ( weight <= 0 )
+        return weight;
+    // Origin is fixed; direction is affine in raster coordinates.
+    dirdx.x =  (MaxX - MinX) / Real(Width);
+    dirdy.y = -(MaxY - MinY) / Real(Height);
+    return weight;
+}
@@ -8,7 +8,7 @@
 // Image plane is at z=ImagePlaneDepth.
 // Ray origin is (X,Y,0).
 // Ray direction is from origin towards point on the image plane.
-class RayGenPinhole : public lfrt::RayGenerator
+class RayGenPinhole final : public lfrt::RayGenerator
 {
 public:
 	using Real = lfrt::Real;
@@ -45,6 +45,19 @@ public:
 		const VEC2& raster, const VEC2& secondary,
 		VEC3& ori, VEC3& dir ) const override;
 
+	virtual void GenerateRays(
+		const Int& count, const VEC2* raster, const VEC2* secondary,
+		const lfrt::RayBatch& rays ) const override;
+
+	virtual Real GenerateRayDifferential(
+		const VEC2& raster, const VEC2& secondary,
+		VEC3& ori, VEC3& dir,
+		VEC3& oridx, VEC3& dirdx,
+		VEC3& oridy, VEC3& dirdy ) const override;
+
+	// Secondary coordinates are ignored.
+	virtual unsigned UsedDimensions() const override { return lfrt::SampleDimRaster; }
+
 	Real ImagePlaneDepth = 1.0;
 	Real MinX = -1.0;
 	Real MinY = -1.0;
@@ -0,0 +1,48 @@
+#include "ReconstructionFilter.h"
+
+#include <algorithm>
+
+
+using namespace lfrt;
+
+
+ReconstructionFilter::ReconstructionFilter( const Type& type, const Real& radius )
+	:type(type)
+	,radius(radius > 0 ? radius : 0.5)
+{
+	scale = Real(TableSize) / this->radius;
+	table.resize( TableSize );
+	for ( Int i = 0; i < TableSize; ++i )
+		table[i] = EvaluateExact( (Real(i)+0.5) / scale );
+}
+
+
+Real ReconstructionFilter::EvaluateExact( const Real& d ) const
+{
+	const Real x = std::abs( d );
+	if ( x >= radius )
+		return 0;
+	switch ( type )
+	{
+	case Type::Box:
+		return 1;
+	case Type::Tent:
+		return 1 - x / radius;
+	case Type::Gaussian:
+	{
+		// Standard deviation of half a pixel, shifted to reach zero at the radius.
+		const Real alpha = 2.0;
+		return std::max<Real>( std::exp( -alpha*x*x ) - std::exp( -alpha*radius*radius ), 0 );
+	}
+	case Type::Mitchell:
+	{
+		const Real B = 1.0 / 3.0;
+		const Real C = 1.0 / 3.0;
+		const Real t = 2 * x / radius;
+		if ( t > 1 )
+			return ((-B - 6*C)*t*t*t + (6*B + 30*C)*t*t + (-12*B - 48*C)*t + (8*B + 24*C)) / 6;
+		return ((12 - 9*B - 6*C)*t*t*t + (-18 + 12*B + 6*C)*t*t + (6 - 2*B)) / 6;
+	}
+	}
+	return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef UTILITIES_RECONSTRUCTIONFILTER_H
+#define UTILITIES_RECONSTRUCTIONFILTER_H
+
+#include "LFRayTracer.h"
+
+#include <cmath>
+#include <vector>
+
+
+// Separable pixel reconstruction filter: weight(dx,dy) = Evaluate(dx) * Evaluate(dy).
+// One-dimensional profile is tabulated over [0,radius], so evaluation is a single lookup.
+class ReconstructionFilter
+{
+public:
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+
+	enum class Type
+	{
+		Box,
+		Tent,
+		Gaussian,
+		Mitchell, // B = C = 1/3.
+	};
+
+public:
+	// Radius is in pixels.
+	ReconstructionFilter( const Type& type = Type::Gaussian, const Real& radius = 1.5 );
+
+	Type FilterType() const { return type; }
+	Real Radius() const { return radius; }
+	// Number of neighbour pixels on each side which may receive a sample.
+	Int Halo() const { return Int( std::ceil( radius ) ); }
+
+	// Weight at distance 'd' (in pixels) from the pixel center.
+	Real Evaluate( const Real& d ) const
+	{
+		const Int index = Int( std::abs( d ) * scale );
+		return index < TableSize ? table[index] : 0;
+	}
+
+private:
+	Real EvaluateExact( const Real& d ) const;
+
+private:
+	static const Int TableSize = 64;
+
+	Type type = Type::Gaussian;
+	Real radius = 1.5;
+	Real scale = 1; // Table entries per pixel.
+	std::vector<Real> table;
+};
+
+
+#endif // UTILITIES_RECONSTRUCTIONFILTER_H
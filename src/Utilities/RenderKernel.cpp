@@ -0,0 +1,61 @@
+#include "RenderKernel.h"
+
+
+
+void RenderKernelBuffers::Reserve( const Int& count )
+{
+	rays.Reserve( count );
+	if ( Int(sampleWeights.size()) >= count )
+		return;
+	sampleWeights.resize( count );
+	rasters.resize( count );
+	secondaries.resize( count );
+	rayWeights.resize( count );
+	colorR.resize( count );
+	colorG.resize( count );
+	colorB.resize( count );
+	aovs.resize( count );
+}
+
+
+lfrt::SampleBatch RenderKernelBuffers::Samples( const Int& count ) const
+{
+	lfrt::SampleBatch samples;
+	samples.count = count;
+	samples.raster = rasters.data();
+	samples.secondary = secondaries.data();
+	samples.sampleWeight = sampleWeights.data();
+	samples.rayWeight = rayWeights.data();
+	samples.r = colorR.data();
+	samples.g = colorG.data();
+	samples.b = colorB.data();
+	return samples;
+}
+
+
+lfrt::Int CollapseConsecutiveSamples( const unsigned& usedDims, const lfrt::Int& count,
+	lfrt::Real* weight, lfrt::VEC2* raster, lfrt::VEC2* secondary )
+{
+	using Int = lfrt::Int;
+	if ( count <= 1 )
+		return count;
+	const bool useRaster = (usedDims & lfrt::SampleDimRaster) != 0;
+	const bool useSecondary = (usedDims & lfrt::SampleDimSecondary) != 0;
+	Int last = 0;
+	for ( Int i = 1; i < count; ++i )
+	{
+		const bool isSame =
+			(!useRaster || (raster[i].x == raster[last].x && raster[i].y == raster[last].y)) &&
+			(!useSecondary || (secondary[i].x == secondary[last].x && secondary[i].y == secondary[last].y));
+		if ( isSame )
+		{
+			weight[last] += weight[i];
+			continue;
+		}
+		++last;
+		weight[last] = weight[i];
+		raster[last] = raster[i];
+		secondary[last] = secondary[i];
+	}
+	return last + 1;
+}
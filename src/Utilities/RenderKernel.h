@@ -0,0 +1,252 @@
+#ifndef UTILITIES_RENDERKERNEL_H
+#define UTILITIES_RENDERKERNEL_H
+
+#include "LFRayTracer.h"
+#include "RayBatchBuffer.h"
+#include "RayGenFocusEye.h"
+#include "RayGenPinhole.h"
+#include "SampleAccumCV.h"
+#include "SampleAccumFilter.h"
+#include "SampleAccumPlanar.h"
+#include "SampleGenDisk.h"
+#include "SampleGenJittered.h"
+#include "SampleGenLowDiscrepancy.h"
+#include "SampleGenUniform.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+
+// Per-thread scratch storage for the render kernel. Is reused between pixels and tiles.
+class RenderKernelBuffers
+{
+public:
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+	using VEC2 = lfrt::VEC2;
+
+	// Make sure that buffers can hold at least 'count' samples.
+	void Reserve( const Int& count );
+
+	// Sample batch over the first 'count' samples.
+	lfrt::SampleBatch Samples( const Int& count ) const;
+
+public:
+	std::vector<Real> sampleWeights;
+	std::vector<VEC2> rasters;
+	std::vector<VEC2> secondaries;
+	std::vector<Real> rayWeights;
+	std::vector<Real> colorR;
+	std::vector<Real> colorG;
+	std::vector<Real> colorB;
+	std::vector<lfrt::SampleAOV> aovs;
+	RayBatchBuffer rays;
+};
+
+
+// Merges runs of consecutive samples which are equal in all 'usedDims' (SampleDimension flags)
+// into their first sample, summing weights. Returns the new number of samples.
+// Catches redundant samples of generators which do not collapse them themselves (see SampleGenerator::SetUsedDimensions).
+lfrt::Int CollapseConsecutiveSamples( const unsigned& usedDims, const lfrt::Int& count,
+	lfrt::Real* weight, lfrt::VEC2* raster, lfrt::VEC2* secondary );
+
+
+// True if shader also reports auxiliary values, i.e., it can be called as
+//     bool shader( const lfrt::VEC3& ori, const lfrt::VEC3& dir, Real& r, Real& g, Real& b, lfrt::SampleAOV& aov ).
+template< class ShaderT >
+constexpr bool ShaderHasAOV = std::is_invocable_r_v< bool, const ShaderT&,
+	const lfrt::VEC3&, const lfrt::VEC3&, lfrt::Real&, lfrt::Real&, lfrt::Real&, lfrt::SampleAOV& >;
+
+
+// Renders pixels [startX,endX)x[startY,endY) into the tile.
+// If 'activePixels' is given (CV_8UC1, accumulator coordinates), only its non-zero pixels are rendered.
+// Shader is called for every generated ray as
+//     bool shader( const lfrt::VEC3& ori, const lfrt::VEC3& dir, Real& r, Real& g, Real& b ),
+// and returns false if the ray does not contribute.
+// Shader may also take lfrt::SampleAOV& as the last argument and fill its depth, normal and id;
+// the return value is used as the hit flag. AOVs are passed to the tile if it accepts them.
+// Samples which differ only in dimensions unused by the ray generator are merged when they follow each other.
+// Returns number of traced samples.
+// When instantiated with concrete (final) types, all calls are resolved statically,
+// and the shader is inlined into the sample loop.
+template< class SamplerT, class RayGenT, class TileT, class ShaderT >
+lfrt::Int RenderTileKernel(
+	SamplerT& sampler, const RayGenT& raygen, TileT& tile, const ShaderT& shader,
+	const lfrt::Int& startX, const lfrt::Int& startY, const lfrt::Int& endX, const lfrt::Int& endY,
+	const cv::Mat* activePixels, RenderKernelBuffers& buffers )
+{
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+
+	lfrt::VEC3 ori;
+	lfrt::VEC3 dir;
+	Real r, g, b;
+	lfrt::SampleAOV aov = lfrt::SampleAOV();
+	Int totalSamples = 0;
+	const bool storeAOV = ShaderHasAOV<ShaderT> && tile.AcceptsAOV();
+	const unsigned usedDims = raygen.UsedDimensions();
+
+	// Row-major traversal, matching cv::Mat storage.
+	for ( Int y = startY; y < endY; ++y )
+	{
+		const unsigned char* activeRow = activePixels != nullptr ? activePixels->ptr<unsigned char>(y) : nullptr;
+		for ( Int x = startX; x < endX; ++x )
+		{
+			if ( activeRow != nullptr && activeRow[x] == 0 )
+				continue;
+			sampler.ResetPixel( x, y );
+			buffers.Reserve( sampler.NumSamplesInPixel() );
+			Int numSamples = sampler.GeneratePixelSamples(
+				x, y, buffers.sampleWeights.data(), buffers.rasters.data(), buffers.secondaries.data() );
+			if ( usedDims != lfrt::SampleDimAll )
+				numSamples = CollapseConsecutiveSamples( usedDims, numSamples,
+					buffers.sampleWeights.data(), buffers.rasters.data(), buffers.secondaries.data() );
+
+			const lfrt::RayBatch& rays = buffers.rays.Batch();
+			raygen.GenerateRays( numSamples, buffers.rasters.data(), buffers.secondaries.data(), rays );
+
+			for ( Int sampleInd = 0; sampleInd < numSamples; ++sampleInd )
+			{
+				// Rejected samples keep zero ray weight and do not contribute.
+				Real weightRay = rays.weight[sampleInd];
+				if ( weightRay != 0 )
+				{
+					ori = { rays.oriX[sampleInd], rays.oriY[sampleInd], rays.oriZ[sampleInd] };
+					dir = { rays.dirX[sampleInd], rays.dirY[sampleInd], rays.dirZ[sampleInd] };
+					bool isHit;
+					if constexpr ( ShaderHasAOV<ShaderT> )
+						isHit = shader( ori, dir, r, g, b, aov );
+					else
+						isHit = shader( ori, dir, r, g, b );
+					if ( !isHit )
+						weightRay = 0;
+				}
+				if ( weightRay == 0 )
+					r = g = b = 0;
+				if ( storeAOV )
+				{
+					aov.isHit = weightRay != 0;
+					buffers.aovs[sampleInd] = aov;
+				}
+				buffers.rayWeights[sampleInd] = weightRay;
+				buffers.colorR[sampleInd] = r;
+				buffers.colorG[sampleInd] = g;
+				buffers.colorB[sampleInd] = b;
+			}
+
+			tile.AddSamples( buffers.Samples( numSamples ) );
+			if ( storeAOV )
+			{
+				for ( Int sampleInd = 0; sampleInd < numSamples; ++sampleInd )
+					tile.AddSampleAOV( buffers.rasters[sampleInd], buffers.aovs[sampleInd] );
+			}
+			totalSamples += numSamples;
+		}
+	}
+	return totalSamples;
+}
+
+
+template< class ShaderT >
+using RenderKernelFunc = lfrt::Int (*)(
+	lfrt::SampleGenerator& sampler, const lfrt::RayGenerator& raygen, lfrt::SampleTile& tile, const ShaderT& shader,
+	const lfrt::Int& startX, const lfrt::Int& startY, const lfrt::Int& endX, const lfrt::Int& endY,
+	const cv::Mat* activePixels, RenderKernelBuffers& buffers );
+
+
+// Type-erased entry point of the specialized kernel.
+// Types must be already checked by the dispatcher.
+template< class SamplerT, class RayGenT, class TileT, class ShaderT >
+lfrt::Int RenderTileKernelEntry(
+	lfrt::SampleGenerator& sampler, const lfrt::RayGenerator& raygen, lfrt::SampleTile& tile, const ShaderT& shader,
+	const lfrt::Int& startX, const lfrt::Int& startY, const lfrt::Int& endX, const lfrt::Int& endY,
+	const cv::Mat* activePixels, RenderKernelBuffers& buffers )
+{
+	return RenderTileKernel(
+		static_cast<SamplerT&>( sampler ),
+		static_cast<const RayGenT&>( raygen ),
+		static_cast<TileT&>( tile ),
+		shader, startX, startY, endX, endY, activePixels, buffers );
+}
+
+
+template< class ShaderT >
+struct RenderKernelTableEntry
+{
+	const std::type_info* sampler;
+	const std::type_info* raygen;
+	const std::type_info* tile;
+	RenderKernelFunc<ShaderT> kernel;
+};
+
+
+// List of types, e.g., concrete types for which the render kernel is specialized.
+template< class... Ts >
+struct RenderKernelTypes
+{
+	static constexpr std::size_t Count = sizeof...( Ts );
+};
+
+// Concrete types known to the dispatcher; kernels are specialized for every combination of them.
+using RenderKernelSamplers = RenderKernelTypes< SampleGenUniform, SampleGenDisk, SampleGenLowDiscrepancy, SampleGenJittered >;
+using RenderKernelRayGens = RenderKernelTypes< RayGenPinhole, RayGenFocusEye >;
+using RenderKernelTiles = RenderKernelTypes< SampleTileCV, SampleTilePlanar, SampleTileFilter >;
+
+
+template< class ShaderT, class SamplerT, class RayGenT, class... TileTs >
+void AppendRenderKernelsForTiles( std::vector< RenderKernelTableEntry<ShaderT> >& table, RenderKernelTypes<TileTs...> )
+{
+	( table.push_back( { &typeid(SamplerT), &typeid(RayGenT), &typeid(TileTs),
+		&RenderTileKernelEntry<SamplerT, RayGenT, TileTs, ShaderT> } ), ... );
+}
+
+
+template< class ShaderT, class SamplerT, class TilesT, class... RayGenTs >
+void AppendRenderKernelsForRayGens( std::vector< RenderKernelTableEntry<ShaderT> >& table, RenderKernelTypes<RayGenTs...>, TilesT tiles )
+{
+	( AppendRenderKernelsForTiles<ShaderT, SamplerT, RayGenTs>( table, tiles ), ... );
+}
+
+
+template< class ShaderT, class RayGensT, class TilesT, class... SamplerTs >
+void AppendRenderKernelsForSamplers( std::vector< RenderKernelTableEntry<ShaderT> >& table, RenderKernelTypes<SamplerTs...>, RayGensT raygens, TilesT tiles )
+{
+	( AppendRenderKernelsForRayGens<ShaderT, SamplerTs>( table, raygens, tiles ), ... );
+}
+
+
+// Dispatch table of specialized kernels for all combinations of the known concrete types.
+template< class ShaderT >
+const std::vector< RenderKernelTableEntry<ShaderT> >& RenderKernelTable()
+{
+	static const std::vector< RenderKernelTableEntry<ShaderT> > table = []()
+	{
+		std::vector< RenderKernelTableEntry<ShaderT> > entries;
+		entries.reserve( RenderKernelSamplers::Count * RenderKernelRayGens::Count * RenderKernelTiles::Count );
+		AppendRenderKernelsForSamplers( entries, RenderKernelSamplers(), RenderKernelRayGens(), RenderKernelTiles() );
+		return entries;
+	}();
+	return table;
+}
+
+
+// Picks the specialized kernel if all dynamic types are recognized; otherwise the virtual one.
+template< class ShaderT >
+RenderKernelFunc<ShaderT> SelectRenderKernel(
+	const lfrt::SampleGenerator& sampler, const lfrt::RayGenerator& raygen, const lfrt::SampleTile& tile )
+{
+	const std::type_info& samplerType = typeid( sampler );
+	const std::type_info& raygenType = typeid( raygen );
+	const std::type_info& tileType = typeid( tile );
+	for ( const auto& entry : RenderKernelTable<ShaderT>() )
+	{
+		if ( *entry.sampler == samplerType && *entry.raygen == raygenType && *entry.tile == tileType )
+			return entry.kernel;
+	}
+	return &RenderTileKernelEntry<lfrt::SampleGenerator, lfrt::RayGenerator, lfrt::SampleTile, ShaderT>;
+}
+
+
+#endif // UTILITIES_RENDERKERNEL_H
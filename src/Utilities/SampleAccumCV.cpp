@@ -5,6 +5,22 @@
 using namespace lfrt;
 
 
+namespace
+{
+
+// Resets AOV storage in 'area' to the state without samples.
+void ClearAOVArea( cv::Mat& depth, cv::Mat& normal, cv::Mat& hits, cv::Mat& nearest, cv::Mat& id, const cv::Rect& area )
+{
+    depth( area ).setTo( cv::Scalar::all(0) );
+    normal( area ).setTo( cv::Scalar::all(0) );
+    hits( area ).setTo( cv::Scalar::all(0) );
+    nearest( area ).setTo( cv::Scalar::all( std::numeric_limits<float>::infinity() ) );
+    id( area ).setTo( cv::Scalar::all(-1) );
+}
+
+} // namespace
+
+
 
 SampleAccumCV::SampleAccumCV( const Int width, const Int height )
 {
@@ -12,6 +28,13 @@ SampleAccumCV::SampleAccumCV( const Int width, const Int height )
 }
 
 
+SampleAccumCV::~SampleAccumCV()
+{
+    for ( SampleTileCV* tile : tilePool )
+        delete tile;
+}
+
+
 
 bool SampleAccumCV::SetSize( const Int& width, const Int& height )
 {
@@ -20,36 +43,60 @@ bool SampleAccumCV::SetSize( const Int& width, const Int& height )
     weighted   = cv::Mat::zeros( height, width, CV_32FC3 );
     weights    = cv::Mat::zeros( height, width, CV_32FC1 );
     unweighted = cv::Mat::zeros( height, width, CV_32FC3 );
+    weightedSq = cv::Mat::zeros( height, width, CV_32FC1 );
+    counts     = cv::Mat::zeros( height, width, CV_32SC1 );
+    SetAOVEnabled( isAOVEnabled );
+    ClearDirtyRegions();
     return true;
 }
 
 
-
-bool SampleAccumCV::GetRenderBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const
+void SampleAccumCV::SetAOVEnabled( const bool enabled )
 {
-    startX = 0;
-    startY = 0;
-    endX = Width();
-    endY = Height();
-    return true;
+    isAOVEnabled = enabled;
+    if ( !enabled )
+    {
+        aovDepth.release();
+        aovNormal.release();
+        aovHits.release();
+        aovNearest.release();
+        aovId.release();
+        return;
+    }
+    aovDepth   = cv::Mat( Height(), Width(), CV_32FC1 );
+    aovNormal  = cv::Mat( Height(), Width(), CV_32FC3 );
+    aovHits    = cv::Mat( Height(), Width(), CV_32SC1 );
+    aovNearest = cv::Mat( Height(), Width(), CV_32FC1 );
+    aovId      = cv::Mat( Height(), Width(), CV_32SC1 );
+    ClearAOV( cv::Rect( 0, 0, Width(), Height() ) );
 }
 
 
-bool SampleAccumCV::GetSamplingBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const
+void SampleAccumCV::ClearAOV( const cv::Rect& area )
 {
-    startX = 0;
-    startY = 0;
-    endX = Width();
-    endY = Height();
-    return true;
+    if ( isAOVEnabled )
+        ClearAOVArea( aovDepth, aovNormal, aovHits, aovNearest, aovId, area );
 }
 
 
+
 SampleTile* SampleAccumCV::CreateSampleTile(
     const Int& startX, const Int& startY,
     const Int&   endX, const Int&   endY )
 {
-    return new SampleTileCV( startX, startY, endX, endY );
+    SampleTileCV* tile = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( tilePoolMutex );
+        if ( !tilePool.empty() )
+        {
+            tile = tilePool.back();
+            tilePool.pop_back();
+        }
+    }
+    if ( tile == nullptr )
+        return new SampleTileCV( startX, startY, endX, endY, isAOVEnabled );
+    tile->Reset( startX, startY, endX, endY, isAOVEnabled );
+    return tile;
 }
 
 
@@ -58,6 +105,7 @@ bool SampleAccumCV::MergeSampleTile( SampleTile* tile )
     SampleTileCV* filmTile = dynamic_cast<SampleTileCV*>( tile );
     if ( filmTile == nullptr )
         return false;
+    const bool withAOV = isAOVEnabled && filmTile->withAOV;
     const Int startX = filmTile->startX;
     const Int startY = filmTile->startY;
     for ( Int localX = 0; localX < filmTile->width; ++localX )
@@ -71,6 +119,55 @@ bool SampleAccumCV::MergeSampleTile( SampleTile* tile )
             weighted.at<RGB>( startY+localY, startX+localX ) = filmTile->weighted.at<RGB>( localY, localX );
             weights.at<Gray>( startY+localY, startX+localX ) = filmTile->weights.at<Gray>( localY, localX );
             unweighted.at<RGB>( startY+localY, startX+localX ) = filmTile->unweighted.at<RGB>( localY, localX );
+            weightedSq.at<Gray>( startY+localY, startX+localX ) = filmTile->weightedSq.at<Gray>( localY, localX );
+            counts.at<Count>( startY+localY, startX+localX ) = filmTile->counts.at<Count>( localY, localX );
+            if ( withAOV )
+            {
+                aovDepth.at<Gray>( y, x ) = filmTile->aovDepth.at<Gray>( localY, localX );
+                aovNormal.at<RGB>( y, x ) = filmTile->aovNormal.at<RGB>( localY, localX );
+                aovHits.at<Count>( y, x ) = filmTile->aovHits.at<Count>( localY, localX );
+                aovNearest.at<Gray>( y, x ) = filmTile->aovNearest.at<Gray>( localY, localX );
+                aovId.at<Count>( y, x ) = filmTile->aovId.at<Count>( localY, localX );
+            }
+        }
+    }
+    return true;
+}
+
+
+bool SampleAccumCV::AddSampleTile( SampleTile* tile )
+{
+    SampleTileCV* filmTile = dynamic_cast<SampleTileCV*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    const bool withAOV = isAOVEnabled && filmTile->withAOV;
+    for ( Int localY = 0; localY < filmTile->height; ++localY )
+    {
+        const Int y = filmTile->startY + localY;
+        if ( y < 0 || y >= weighted.rows )
+            continue;
+        for ( Int localX = 0; localX < filmTile->width; ++localX )
+        {
+            const Int x = filmTile->startX + localX;
+            if ( x < 0 || x >= weighted.cols )
+                continue;
+            weighted.ptr<RGB>(y)[x] += filmTile->weighted.ptr<RGB>(localY)[localX];
+            weights.ptr<Gray>(y)[x] += filmTile->weights.ptr<Gray>(localY)[localX];
+            unweighted.ptr<RGB>(y)[x] += filmTile->unweighted.ptr<RGB>(localY)[localX];
+            weightedSq.ptr<Gray>(y)[x] += filmTile->weightedSq.ptr<Gray>(localY)[localX];
+            counts.ptr<Count>(y)[x] += filmTile->counts.ptr<Count>(localY)[localX];
+            if ( withAOV )
+            {
+                aovDepth.ptr<Gray>(y)[x] += filmTile->aovDepth.ptr<Gray>(localY)[localX];
+                aovNormal.ptr<RGB>(y)[x] += filmTile->aovNormal.ptr<RGB>(localY)[localX];
+                aovHits.ptr<Count>(y)[x] += filmTile->aovHits.ptr<Count>(localY)[localX];
+                const Gray nearest = filmTile->aovNearest.ptr<Gray>(localY)[localX];
+                if ( nearest < aovNearest.ptr<Gray>(y)[x] )
+                {
+                    aovNearest.ptr<Gray>(y)[x] = nearest;
+                    aovId.ptr<Count>(y)[x] = filmTile->aovId.ptr<Count>(localY)[localX];
+                }
+            }
         }
     }
     return true;
@@ -82,7 +179,8 @@ bool SampleAccumCV::DestroySampleTile( SampleTile* tile )
     SampleTileCV* filmTile = dynamic_cast<SampleTileCV*>( tile );
     if ( filmTile == nullptr )
         return false;
-    delete filmTile;
+    std::lock_guard<std::mutex> lock( tilePoolMutex );
+    tilePool.push_back( filmTile );
     return true;
 }
 
@@ -107,39 +205,181 @@ bool SampleAccumCV::GetColor( const Int& x, const Int& y, Real& r, Real& g, Real
 }
 
 
+void SampleAccumCV::Clear( const Int& startX, const Int& startY, const Int& endX, const Int& endY )
+{
+    const cv::Rect area = cv::Rect( startX, startY, endX-startX, endY-startY ) & cv::Rect( 0, 0, Width(), Height() );
+    if ( area.empty() )
+        return;
+    weighted( area ).setTo( cv::Scalar::all(0) );
+    weights( area ).setTo( cv::Scalar::all(0) );
+    unweighted( area ).setTo( cv::Scalar::all(0) );
+    weightedSq( area ).setTo( cv::Scalar::all(0) );
+    counts( area ).setTo( cv::Scalar::all(0) );
+    ClearAOV( area );
+}
+
+
+bool SampleAccumCV::SaveAOVToImages( AOVImages& images ) const
+{
+    if ( !isAOVEnabled )
+        return false;
+    images.Depth = cv::Mat::zeros( Height(), Width(), CV_32FC1 );
+    images.Normal = cv::Mat::zeros( Height(), Width(), CV_32FC3 );
+    images.HitMask = cv::Mat::zeros( Height(), Width(), CV_8UC1 );
+    images.HitCount = aovHits.clone();
+    images.Id = aovId.clone();
+    images.SampleCount = counts.clone();
+    for ( Int y = 0; y < Height(); ++y )
+    {
+        const Count* hits = aovHits.ptr<Count>(y);
+        const Gray* depth = aovDepth.ptr<Gray>(y);
+        const RGB* normal = aovNormal.ptr<RGB>(y);
+        Gray* depthRow = images.Depth.ptr<Gray>(y);
+        RGB* normalRow = images.Normal.ptr<RGB>(y);
+        unsigned char* maskRow = images.HitMask.ptr<unsigned char>(y);
+        for ( Int x = 0; x < Width(); ++x )
+        {
+            if ( hits[x] <= 0 )
+                continue;
+            maskRow[x] = 255;
+            depthRow[x] = depth[x] / hits[x];
+            const double length = cv::norm( normal[x] );
+            if ( length > 0 )
+                normalRow[x] = normal[x] / float(length);
+        }
+    }
+    return true;
+}
+
+
 void SampleAccumCV::SaveToImage( cv::Mat& image ) const
 {
     const int width = Width();
     const int height = Height();
 
-    image = cv::Mat( height, width, CV_32FC3 );
+    image = cv::Mat( height, width, HalfPrecisionOutput ? CV_16FC3 : CV_32FC3 );
 
-    cv::parallel_for_( cv::Range( 0, width*height ),
+    // Pixels without weighted samples keep only the unweighted part.
+    cv::parallel_for_( cv::Range( 0, height ),
         [&]( const cv::Range& range )
         {
-            for ( int r = range.start; r < range.end; ++r )
+            for ( int y = range.start; y < range.end; ++y )
             {
-                const int x = r % width;
-                const int y = r / width;
-                const RGB& a = unweighted.at<RGB>(y,x);
-                const RGB& b = weighted.at<RGB>(y,x);
-                const Gray& c = weights.at<Gray>(y,x);
-                image.at<RGB>(y,x) = a + b / c;
+                const RGB* a = unweighted.ptr<RGB>(y);
+                const RGB* b = weighted.ptr<RGB>(y);
+                const Gray* c = weights.ptr<Gray>(y);
+                for ( int x = 0; x < width; ++x )
+                {
+                    const RGB value = c[x] > 0 ? RGB( a[x] + b[x] / c[x] ) : a[x];
+                    if ( HalfPrecisionOutput )
+                    {
+                        cv::float16_t* pixel = image.ptr<cv::float16_t>(y) + 3*x;
+                        for ( int ch = 0; ch < 3; ++ch )
+                            pixel[ch] = cv::float16_t( value[ch] );
+                    }
+                    else
+                    {
+                        image.ptr<RGB>(y)[x] = value;
+                    }
+                }
             }
         }
     );
 }
 
 
-SampleTileCV::SampleTileCV( const Int& startX, const Int& startY, const Int& endX, const Int& endY )
-    :startX(startX)
-    ,startY(startY)
-    ,width(endX-startX)
-    ,height(endY-startY)
+Real SampleAccumCV::ErrorAt( const Int& x, const Int& y ) const
 {
-    weighted   = cv::Mat::zeros( height, width, CV_32FC3 );
-    weights    = cv::Mat::zeros( height, width, CV_32FC1 );
-    unweighted = cv::Mat::zeros( height, width, CV_32FC3 );
+    const RGB& sum = weighted.ptr<RGB>(y)[x];
+    return StandardError(
+        Luminance( sum[2], sum[1], sum[0] ), weights.ptr<Gray>(y)[x],
+        weightedSq.ptr<Gray>(y)[x], counts.ptr<Count>(y)[x] );
+}
+
+
+void SampleAccumCV::EstimateError( cv::Mat& error ) const
+{
+    error = cv::Mat( Height(), Width(), CV_32FC1 );
+    for ( Int y = 0; y < Height(); ++y )
+    {
+        Gray* row = error.ptr<Gray>(y);
+        for ( Int x = 0; x < Width(); ++x )
+            row[x] = ErrorAt( x, y );
+    }
+}
+
+
+SampleTileCV::SampleTileCV( const Int& startX, const Int& startY, const Int& endX, const Int& endY, const bool withAOV )
+{
+    Reset( startX, startY, endX, endY, withAOV );
+}
+
+
+void SampleTileCV::Reset( const Int& startX, const Int& startY, const Int& endX, const Int& endY, const bool withAOV )
+{
+    const Int newWidth = std::max<Int>( endX-startX, 0 );
+    const Int newHeight = std::max<Int>( endY-startY, 0 );
+    if ( weightedStorage.cols < newWidth || weightedStorage.rows < newHeight )
+    {
+        const Int cols = std::max<Int>( weightedStorage.cols, newWidth );
+        const Int rows = std::max<Int>( weightedStorage.rows, newHeight );
+        weightedStorage   = cv::Mat::zeros( rows, cols, CV_32FC3 );
+        weightsStorage    = cv::Mat::zeros( rows, cols, CV_32FC1 );
+        unweightedStorage = cv::Mat::zeros( rows, cols, CV_32FC3 );
+        weightedSqStorage = cv::Mat::zeros( rows, cols, CV_32FC1 );
+        countsStorage     = cv::Mat::zeros( rows, cols, CV_32SC1 );
+    }
+    else if ( touchedStartX < touchedEndX && touchedStartY < touchedEndY )
+    {
+        const cv::Rect touched( touchedStartX, touchedStartY, touchedEndX-touchedStartX, touchedEndY-touchedStartY );
+        weightedStorage( touched ).setTo( cv::Scalar::all(0) );
+        weightsStorage( touched ).setTo( cv::Scalar::all(0) );
+        unweightedStorage( touched ).setTo( cv::Scalar::all(0) );
+        weightedSqStorage( touched ).setTo( cv::Scalar::all(0) );
+        countsStorage( touched ).setTo( cv::Scalar::all(0) );
+        // AOV storage keeps its size while tiles without AOVs grow the color storage.
+        const cv::Rect aovTouched = touched & cv::Rect( 0, 0, aovDepthStorage.cols, aovDepthStorage.rows );
+        if ( aovTouched.area() > 0 )
+            ClearAOVArea( aovDepthStorage, aovNormalStorage, aovHitsStorage, aovNearestStorage, aovIdStorage, aovTouched );
+    }
+
+    // AOV storage follows the size of the color storage.
+    if ( withAOV && (aovDepthStorage.cols != weightedStorage.cols || aovDepthStorage.rows != weightedStorage.rows) )
+    {
+        const Int cols = weightedStorage.cols;
+        const Int rows = weightedStorage.rows;
+        aovDepthStorage   = cv::Mat( rows, cols, CV_32FC1 );
+        aovNormalStorage  = cv::Mat( rows, cols, CV_32FC3 );
+        aovHitsStorage    = cv::Mat( rows, cols, CV_32SC1 );
+        aovNearestStorage = cv::Mat( rows, cols, CV_32FC1 );
+        aovIdStorage      = cv::Mat( rows, cols, CV_32SC1 );
+        ClearAOVArea( aovDepthStorage, aovNormalStorage, aovHitsStorage, aovNearestStorage, aovIdStorage, cv::Rect( 0, 0, cols, rows ) );
+    }
+
+    this->startX = startX;
+    this->startY = startY;
+    width = newWidth;
+    height = newHeight;
+    const cv::Rect area( 0, 0, width, height );
+    weighted   = weightedStorage( area );
+    weights    = weightsStorage( area );
+    unweighted = unweightedStorage( area );
+    weightedSq = weightedSqStorage( area );
+    counts     = countsStorage( area );
+    this->withAOV = withAOV;
+    if ( withAOV )
+    {
+        aovDepth   = aovDepthStorage( area );
+        aovNormal  = aovNormalStorage( area );
+        aovHits    = aovHitsStorage( area );
+        aovNearest = aovNearestStorage( area );
+        aovId      = aovIdStorage( area );
+    }
+
+    touchedStartX = width;
+    touchedStartY = height;
+    touchedEndX = 0;
+    touchedEndY = 0;
 }
 
 
@@ -151,19 +391,111 @@ bool SampleTileCV::AddSample(
 {
     const Int x = Int(raster.x) - startX;
     const Int y = Int(raster.y) - startY;
-    if ( x < 0 || y < 0 || x >= width || y >= width )
+    if ( x < 0 || y < 0 || x >= width || y >= height )
         return false;
+    Touch( x, y );
     if ( isWeighted )
     {
         const Real w = sampleWeight * rayWeight;
+        const Real lum = SampleAccumCV::Luminance( r, g, b );
         RGB& rgb = weighted.at<RGB>(y,x);
         rgb += w * RGB(b,g,r);
         weights.at<Gray>(y,x) += w;
+        weightedSq.at<Gray>(y,x) += w * lum * lum;
+        // Rejected samples (zero weight) carry no information for the error estimate.
+        counts.at<Count>(y,x) += (w > 0) ? 1 : 0;
     }
     else
     {
         RGB& rgb = unweighted.at<RGB>(y,x);
         rgb += RGB(b,g,r);
+        counts.at<Count>(y,x) += 1;
+    }
+    return true;
+}
+
+
+Int SampleTileCV::AddSamples( const lfrt::SampleBatch& samples, const bool isWeighted )
+{
+    const Int count = samples.count;
+    const VEC2* raster = samples.raster;
+    Int numAccepted = 0;
+    Int runStart = 0;
+    while ( runStart < count )
+    {
+        // Find run of consecutive samples which fall into the same pixel.
+        const Int pixelX = Int(raster[runStart].x);
+        const Int pixelY = Int(raster[runStart].y);
+        Int runEnd = runStart + 1;
+        while ( runEnd < count && Int(raster[runEnd].x) == pixelX && Int(raster[runEnd].y) == pixelY )
+            ++runEnd;
+
+        const Int x = pixelX - startX;
+        const Int y = pixelY - startY;
+        if ( x >= 0 && y >= 0 && x < width && y < height )
+        {
+            Touch( x, y );
+            // Reduce the whole run in a branch-free loop, then write the pixel once.
+            Real sumR = 0;
+            Real sumG = 0;
+            Real sumB = 0;
+            Real sumW = 0;
+            Real sumSq = 0;
+            Count numTaken = 0;
+            if ( isWeighted )
+            {
+                for ( Int i = runStart; i < runEnd; ++i )
+                {
+                    const Real w = samples.sampleWeight[i] * samples.rayWeight[i];
+                    const Real lum = SampleAccumCV::Luminance( samples.r[i], samples.g[i], samples.b[i] );
+                    sumR += w * samples.r[i];
+                    sumG += w * samples.g[i];
+                    sumB += w * samples.b[i];
+                    sumW += w;
+                    sumSq += w * lum * lum;
+                    // Rejected samples (zero weight) carry no information for the error estimate.
+                    numTaken += (w > 0) ? 1 : 0;
+                }
+                weighted.ptr<RGB>(y)[x] += RGB( sumB, sumG, sumR );
+                weights.ptr<Gray>(y)[x] += sumW;
+                weightedSq.ptr<Gray>(y)[x] += sumSq;
+            }
+            else
+            {
+                for ( Int i = runStart; i < runEnd; ++i )
+                {
+                    sumR += samples.r[i];
+                    sumG += samples.g[i];
+                    sumB += samples.b[i];
+                }
+                unweighted.ptr<RGB>(y)[x] += RGB( sumB, sumG, sumR );
+                numTaken = Count( runEnd - runStart );
+            }
+            counts.ptr<Count>(y)[x] += numTaken;
+            numAccepted += runEnd - runStart;
+        }
+        runStart = runEnd;
+    }
+    return numAccepted;
+}
+
+
+bool SampleTileCV::AddSampleAOV( const VEC2& raster, const lfrt::SampleAOV& aov )
+{
+    if ( !withAOV || !aov.isHit )
+        return false;
+    const Int x = Int(raster.x) - startX;
+    const Int y = Int(raster.y) - startY;
+    if ( x < 0 || y < 0 || x >= width || y >= height )
+        return false;
+    Touch( x, y );
+    aovDepth.ptr<Gray>(y)[x] += aov.depth;
+    aovNormal.ptr<RGB>(y)[x] += RGB( aov.normal.x, aov.normal.y, aov.normal.z );
+    aovHits.ptr<Count>(y)[x] += 1;
+    if ( aov.depth < aovNearest.ptr<Gray>(y)[x] )
+    {
+        aovNearest.ptr<Gray>(y)[x] = aov.depth;
+        aovId.ptr<Count>(y)[x] = Count( aov.id );
     }
     return true;
 }
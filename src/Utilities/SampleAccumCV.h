@@ -2,30 +2,51 @@
 #define SAMPLEACCUMCV_H
 
 #include "LFRayTracer.h"
+#include "MultiPassAccumulator.h"
 #include <opencv2/opencv.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
 
 
 
-class SampleAccumCV : public lfrt::SampleAccumulator
+
+class SampleTileCV;
+
+
+// Tiles are pooled: DestroySampleTile returns a tile to the pool, and CreateSampleTile reuses its storage.
+// Optionally stores auxiliary output values (AOV) of samples next to the color.
+class SampleAccumCV : public MultiPassAccumulator
 {
 public:
     using Int = lfrt::Int;
     using Real = lfrt::Real;
     using RGB = cv::Vec3f;
     using Gray = float;
+    using Count = int;
+
+    // Resolved AOVs. Pixels without hits have zero depth and normal, and id -1.
+    struct AOVImages
+    {
+        cv::Mat Depth; // CV_32FC1, mean depth of hits.
+        cv::Mat Normal; // CV_32FC3, normalized mean normal of hits, in (x,y,z) order.
+        cv::Mat HitMask; // CV_8UC1, 255 if any sample hit.
+        cv::Mat HitCount; // CV_32SC1, number of hits.
+        cv::Mat Id; // CV_32SC1, id of the nearest hit.
+        cv::Mat SampleCount; // CV_32SC1, number of samples with positive weight, including misses of the scene.
+    };
 
 public:
     SampleAccumCV( const Int width, const Int height );
+    virtual ~SampleAccumCV();
 
     // Inherited via SampleAccumulator
     virtual bool SetSize(const Int& width, const Int& height) override;
     virtual Int Width() const override { return weighted.cols;}
     virtual Int Height() const override { return weighted.rows; }
-    virtual bool GetRenderBounds(
-        Int& startX, Int& startY, Int& endX, Int& endY) const override;
-    virtual bool GetSamplingBounds(
-        Int& startX, Int& startY, Int& endX, Int& endY) const override;
     virtual lfrt::SampleTile* CreateSampleTile(
         const Int& startX, const Int& startY,
         const Int&   endX, const Int&   endY ) override;
@@ -37,26 +58,56 @@ public:
     const cv::Mat& Weighted() const { return weighted; }
     const cv::Mat& Weights() const { return weights; }
     const cv::Mat& Unweighted() const { return unweighted; }
+    // Number of samples taken in each pixel (CV_32SC1); weighted samples count only if their weight is positive.
+    const cv::Mat& SampleCounts() const { return counts; }
 
-    void SaveToImage( cv::Mat& image ) const;
+    // Inherited via MultiPassAccumulator
+    virtual void SaveToImage( cv::Mat& image ) const override;
+    virtual bool AddSampleTile( lfrt::SampleTile* tile ) override;
+    virtual void EstimateError( cv::Mat& error ) const override;
+    virtual void Clear( const Int& startX, const Int& startY, const Int& endX, const Int& endY ) override;
+
+    // AOVs are stored only if enabled; enabling allocates and clears them.
+    void SetAOVEnabled( const bool enabled );
+    bool AOVEnabled() const { return isAOVEnabled; }
+    // False if AOVs are not enabled.
+    bool SaveAOVToImages( AOVImages& images ) const;
+
+private:
+    Real ErrorAt( const Int& x, const Int& y ) const;
+    void ClearAOV( const cv::Rect& area );
 
 private:
     cv::Mat weighted;
     cv::Mat weights;
     cv::Mat unweighted;
+    cv::Mat weightedSq; // Weighted sum of squared luminance, for variance estimation.
+    cv::Mat counts;
+
+    bool isAOVEnabled = false;
+    cv::Mat aovDepth; // Sum over hits.
+    cv::Mat aovNormal; // Sum over hits.
+    cv::Mat aovHits;
+    cv::Mat aovNearest; // Depth of the nearest hit.
+    cv::Mat aovId; // Id of the nearest hit.
+
+    std::mutex tilePoolMutex;
+    std::vector<SampleTileCV*> tilePool;
 };
 
 
 
-class SampleTileCV : public lfrt::SampleTile
+class SampleTileCV final : public lfrt::SampleTile
 {
 public:
     friend class SampleAccumCV;
+    friend class SampleAccumTiledFile;
     using VEC2 = lfrt::VEC2;
     using Real = lfrt::Real;
     using Int = lfrt::Int;
     using RGB = cv::Vec3f;
     using Gray = float;
+    using Count = int;
 
 protected:
     virtual ~SampleTileCV() = default;
@@ -65,21 +116,70 @@ public:
 
     SampleTileCV(
         const Int& startX, const Int& startY,
-        const Int&   endX, const Int&   endY );
+        const Int&   endX, const Int&   endY,
+        const bool withAOV = false );
 
     virtual bool AddSample(const VEC2& raster, const VEC2& secondary,
         const Real& sampleWeight, const Real& rayWeight,
         const Real& r, const Real& g, const Real& b,
         const bool isWeighted = true) override;
 
+    // Samples which fall into the same pixel one after another are reduced together before writing.
+    virtual Int AddSamples( const lfrt::SampleBatch& samples, const bool isWeighted = true ) override;
+
+    virtual bool AcceptsAOV() const override { return withAOV; }
+    virtual bool AddSampleAOV( const VEC2& raster, const lfrt::SampleAOV& aov ) override;
+
+private:
+    // Move tile to another area. Storage is reallocated only if it is too small;
+    // otherwise only the part touched since the previous reset is cleared.
+    void Reset(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY,
+        const bool withAOV = false );
+
+    void Touch( const Int& x, const Int& y )
+    {
+        touchedStartX = std::min( touchedStartX, x );
+        touchedStartY = std::min( touchedStartY, y );
+        touchedEndX = std::max( touchedEndX, x+1 );
+        touchedEndY = std::max( touchedEndY, y+1 );
+    }
+
 private:
+    // Views of the top-left width x height part of the storage.
     cv::Mat weighted;
     cv::Mat weights;
     cv::Mat unweighted;
+    cv::Mat weightedSq;
+    cv::Mat counts;
+    // Storage which may be larger than the current tile.
+    cv::Mat weightedStorage;
+    cv::Mat weightsStorage;
+    cv::Mat unweightedStorage;
+    cv::Mat weightedSqStorage;
+    cv::Mat countsStorage;
+    // AOV views and storage; storage is allocated on the first use.
+    bool withAOV = false;
+    cv::Mat aovDepth;
+    cv::Mat aovNormal;
+    cv::Mat aovHits;
+    cv::Mat aovNearest;
+    cv::Mat aovId;
+    cv::Mat aovDepthStorage;
+    cv::Mat aovNormalStorage;
+    cv::Mat aovHitsStorage;
+    cv::Mat aovNearestStorage;
+    cv::Mat aovIdStorage;
     Int startX = 0;
     Int startY = 0;
     Int width = 0;
     Int height = 0;
+    // Bounding box of touched pixels, in local coordinates.
+    Int touchedStartX = 0;
+    Int touchedStartY = 0;
+    Int touchedEndX = 0;
+    Int touchedEndY = 0;
 };
 
 
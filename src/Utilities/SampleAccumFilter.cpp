@@ -0,0 +1,260 @@
+#include "SampleAccumFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+
+using namespace lfrt;
+
+
+
+SampleAccumFilter::SampleAccumFilter( const Int width, const Int height,
+    const ReconstructionFilter::Type& filterType, const Real& filterRadius )
+    :SampleAccumPlanar(width, height)
+    ,filter(filterType, filterRadius)
+{
+}
+
+
+SampleAccumFilter::~SampleAccumFilter()
+{
+    for ( SampleTileFilter* tile : tilePool )
+        delete tile;
+}
+
+
+SampleTile* SampleAccumFilter::CreateSampleTile(
+    const Int& startX, const Int& startY,
+    const Int&   endX, const Int&   endY )
+{
+    SampleTileFilter* tile = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( tilePoolMutex );
+        if ( !tilePool.empty() )
+        {
+            tile = tilePool.back();
+            tilePool.pop_back();
+        }
+    }
+    if ( tile == nullptr )
+        return new SampleTileFilter( startX, startY, endX, endY, &filter );
+    tile->Reset( startX, startY, endX, endY );
+    return tile;
+}
+
+
+bool SampleAccumFilter::MergeSampleTile( SampleTile* tile )
+{
+    return AddSampleTile( tile );
+}
+
+
+bool SampleAccumFilter::AddSampleTile( SampleTile* tile )
+{
+    SampleTileFilter* filmTile = dynamic_cast<SampleTileFilter*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    Int renderStartX, renderStartY, renderEndX, renderEndY;
+    if ( !GetRenderBounds( renderStartX, renderStartY, renderEndX, renderEndY ) )
+        return false;
+
+    // Only the touched part of the tile can be non-zero.
+    const Int startX = std::max<Int>( filmTile->storageX + filmTile->touchedStartX, std::max<Int>( renderStartX, 0 ) );
+    const Int endX = std::min<Int>( filmTile->storageX + filmTile->touchedEndX, std::min<Int>( renderEndX, width ) );
+    const Int startY = std::max<Int>( filmTile->storageY + filmTile->touchedStartY, std::max<Int>( renderStartY, 0 ) );
+    const Int endY = std::min<Int>( filmTile->storageY + filmTile->touchedEndY, std::min<Int>( renderEndY, height ) );
+    if ( startX >= endX || startY >= endY )
+        return true;
+    const Int length = endX - startX;
+    const Int localStartX = startX - filmTile->storageX;
+
+    std::lock_guard<std::mutex> lock( mergeMutex );
+    for ( Int y = startY; y < endY; ++y )
+    {
+        const Int localY = y - filmTile->storageY;
+        // Halo spills over dirty pixels into the ones which keep their previous values.
+        const unsigned char* dirty = HasDirtyRegions() ? RenderMask().ptr<unsigned char>(y) + startX : nullptr;
+        for ( Int plane = 0; plane < NumPlanes; ++plane )
+        {
+            const float* src = filmTile->PlaneRow( plane, localY ) + localStartX;
+            float* dst = WritablePlaneRow( plane, y ) + startX;
+            if ( dirty != nullptr )
+            {
+                for ( Int i = 0; i < length; ++i )
+                    dst[i] += dirty[i] != 0 ? src[i] : 0.0f;
+            }
+            else
+            {
+                for ( Int i = 0; i < length; ++i )
+                    dst[i] += src[i];
+            }
+        }
+        const int* srcCounts = filmTile->counts.data() + localY*filmTile->storageWidth + localStartX;
+        int* dstCounts = counts.data() + std::size_t(y)*width + startX;
+        for ( Int i = 0; i < length; ++i )
+        {
+            if ( dirty == nullptr || dirty[i] != 0 )
+                dstCounts[i] += srcCounts[i];
+        }
+    }
+    return true;
+}
+
+
+bool SampleAccumFilter::DestroySampleTile( SampleTile* tile )
+{
+    SampleTileFilter* filmTile = dynamic_cast<SampleTileFilter*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    std::lock_guard<std::mutex> lock( tilePoolMutex );
+    tilePool.push_back( filmTile );
+    return true;
+}
+
+
+
+SampleTileFilter::SampleTileFilter(
+    const Int& startX, const Int& startY,
+    const Int&   endX, const Int&   endY,
+    const ReconstructionFilter* filter )
+    :filter(filter)
+{
+    const Int footprint = 2 * filter->Halo() + 2;
+    weightsX.resize( footprint );
+    weightsY.resize( footprint );
+    Reset( startX, startY, endX, endY );
+}
+
+
+void SampleTileFilter::Reset( const Int& startX, const Int& startY, const Int& endX, const Int& endY )
+{
+    // Everything outside the touched box is already zero, so after this the whole storage is zero.
+    if ( touchedStartX < touchedEndX && touchedStartY < touchedEndY )
+    {
+        for ( Int y = touchedStartY; y < touchedEndY; ++y )
+        {
+            for ( Int plane = 0; plane < SampleAccumPlanar::NumPlanes; ++plane )
+            {
+                float* row = PlaneRow( plane, y );
+                std::fill( row + touchedStartX, row + touchedEndX, 0.0f );
+            }
+            int* countRow = counts.data() + y*storageWidth;
+            std::fill( countRow + touchedStartX, countRow + touchedEndX, 0 );
+        }
+    }
+
+    const Int halo = filter->Halo();
+    this->startX = startX;
+    this->startY = startY;
+    this->endX = std::max( endX, startX );
+    this->endY = std::max( endY, startY );
+    storageX = startX - halo;
+    storageY = startY - halo;
+    storageWidth = this->endX - startX + 2*halo;
+    storageHeight = this->endY - startY + 2*halo;
+    planes.resize( SampleAccumPlanar::NumPlanes * storageWidth * storageHeight, 0.0f );
+    counts.resize( storageWidth * storageHeight, 0 );
+
+    touchedStartX = storageWidth;
+    touchedStartY = storageHeight;
+    touchedEndX = 0;
+    touchedEndY = 0;
+}
+
+
+bool SampleTileFilter::Splat(
+    const VEC2& raster,
+    const Real& sampleWeight, const Real& rayWeight,
+    const Real& r, const Real& g, const Real& b,
+    const bool isWeighted )
+{
+    const Int pixelX = Int(raster.x);
+    const Int pixelY = Int(raster.y);
+    if ( pixelX < startX || pixelY < startY || pixelX >= endX || pixelY >= endY )
+        return false;
+    const Int localX = pixelX - storageX;
+    const Int localY = pixelY - storageY;
+    // Rejected samples (zero weight) carry no information for the error estimate.
+    const bool isTaken = !isWeighted || sampleWeight * rayWeight > 0;
+    counts[localY*storageWidth + localX] += isTaken ? 1 : 0;
+
+    Int x0 = localX;
+    Int x1 = localX;
+    Int y0 = localY;
+    Int y1 = localY;
+    if ( isWeighted )
+    {
+        // Pixels whose centers are closer than the filter radius.
+        const Real radius = filter->Radius();
+        const Real px = raster.x - Real(storageX);
+        const Real py = raster.y - Real(storageY);
+        x0 = std::max<Int>( Int( std::ceil( px - 0.5 - radius ) ), 0 );
+        x1 = std::min<Int>( Int( std::floor( px - 0.5 + radius ) ), storageWidth-1 );
+        y0 = std::max<Int>( Int( std::ceil( py - 0.5 - radius ) ), 0 );
+        y1 = std::min<Int>( Int( std::floor( py - 0.5 + radius ) ), storageHeight-1 );
+        for ( Int x = x0; x <= x1; ++x )
+            weightsX[x-x0] = filter->Evaluate( px - (Real(x)+0.5) );
+        for ( Int y = y0; y <= y1; ++y )
+            weightsY[y-y0] = filter->Evaluate( py - (Real(y)+0.5) );
+
+        const Real w = sampleWeight * rayWeight;
+        const Real lum = SampleAccumPlanar::Luminance( r, g, b );
+        const Real lumSq = lum * lum;
+        for ( Int y = y0; y <= y1; ++y )
+        {
+            const Real wy = w * weightsY[y-y0];
+            if ( wy == 0 )
+                continue;
+            float* rowR = PlaneRow( SampleAccumPlanar::PlaneR, y );
+            float* rowG = PlaneRow( SampleAccumPlanar::PlaneG, y );
+            float* rowB = PlaneRow( SampleAccumPlanar::PlaneB, y );
+            float* rowW = PlaneRow( SampleAccumPlanar::PlaneWeight, y );
+            float* rowSq = PlaneRow( SampleAccumPlanar::PlaneSumSq, y );
+            for ( Int x = x0; x <= x1; ++x )
+            {
+                const Real f = wy * weightsX[x-x0];
+                rowR[x] += f * r;
+                rowG[x] += f * g;
+                rowB[x] += f * b;
+                rowW[x] += f;
+                rowSq[x] += f * lumSq;
+            }
+        }
+    }
+    else
+    {
+        PlaneRow( SampleAccumPlanar::PlaneFlatR, localY )[localX] += r;
+        PlaneRow( SampleAccumPlanar::PlaneFlatG, localY )[localX] += g;
+        PlaneRow( SampleAccumPlanar::PlaneFlatB, localY )[localX] += b;
+    }
+
+    touchedStartX = std::min( touchedStartX, std::min( x0, localX ) );
+    touchedStartY = std::min( touchedStartY, std::min( y0, localY ) );
+    touchedEndX = std::max( touchedEndX, std::max( x1, localX ) + 1 );
+    touchedEndY = std::max( touchedEndY, std::max( y1, localY ) + 1 );
+    return true;
+}
+
+
+bool SampleTileFilter::AddSample(
+    const VEC2& raster, const VEC2& /*secondary*/,
+    const Real& sampleWeight, const Real& rayWeight,
+    const Real& r, const Real& g, const Real& b,
+    const bool isWeighted )
+{
+    return Splat( raster, sampleWeight, rayWeight, r, g, b, isWeighted );
+}
+
+
+Int SampleTileFilter::AddSamples( const lfrt::SampleBatch& samples, const bool isWeighted )
+{
+    Int numAccepted = 0;
+    for ( Int i = 0; i < samples.count; ++i )
+    {
+        if ( Splat( samples.raster[i], samples.sampleWeight[i], samples.rayWeight[i],
+                samples.r[i], samples.g[i], samples.b[i], isWeighted ) )
+            ++numAccepted;
+    }
+    return numAccepted;
+}
@@ -0,0 +1,120 @@
+#ifndef UTILITIES_SAMPLEACCUMFILTER_H
+#define UTILITIES_SAMPLEACCUMFILTER_H
+
+#include "LFRayTracer.h"
+#include "ReconstructionFilter.h"
+#include "SampleAccumPlanar.h"
+
+#include <mutex>
+#include <vector>
+
+
+class SampleTileFilter;
+
+
+// Planar accumulator which splats every weighted sample into all pixels under the reconstruction filter.
+// Sampling margin is the filter halo, and tiles keep a halo of the same size.
+// As neighbouring tiles overlap, merging always adds the tile, so every render has to start from cleared pixels.
+// Constructor and SetSize clear the whole image, and TileRenderEngine clears the render bounds before the first pass;
+// with other ray tracers, call SetSize or Clear before rendering into the same accumulator again.
+// Unweighted samples are not filtered and stay in their own pixel.
+class SampleAccumFilter : public SampleAccumPlanar
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+
+public:
+    SampleAccumFilter( const Int width, const Int height,
+        const ReconstructionFilter::Type& filterType = ReconstructionFilter::Type::Gaussian,
+        const Real& filterRadius = 1.5 );
+    virtual ~SampleAccumFilter();
+
+    virtual Int SamplingMargin() const override { return filter.Halo(); }
+    virtual lfrt::SampleTile* CreateSampleTile(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY ) override;
+    virtual bool MergeSampleTile( lfrt::SampleTile* tile ) override;
+    virtual bool DestroySampleTile( lfrt::SampleTile* tile ) override;
+    virtual bool AddSampleTile( lfrt::SampleTile* tile ) override;
+
+    const ReconstructionFilter& Filter() const { return filter; }
+
+private:
+    ReconstructionFilter filter;
+
+    // Serializes merging, since halos of neighbouring tiles overlap.
+    std::mutex mergeMutex;
+
+    std::mutex tilePoolMutex;
+    std::vector<SampleTileFilter*> tilePool;
+};
+
+
+
+class SampleTileFilter final : public lfrt::SampleTile
+{
+public:
+    friend class SampleAccumFilter;
+    using VEC2 = lfrt::VEC2;
+    using Real = lfrt::Real;
+    using Int = lfrt::Int;
+
+protected:
+    virtual ~SampleTileFilter() = default;
+
+public:
+    // Accepts samples of pixels [startX,endX)x[startY,endY); stores them with a halo of filter->Halo() pixels.
+    SampleTileFilter(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY,
+        const ReconstructionFilter* filter );
+
+    virtual bool AddSample( const VEC2& raster, const VEC2& secondary,
+        const Real& sampleWeight, const Real& rayWeight,
+        const Real& r, const Real& g, const Real& b,
+        const bool isWeighted = true ) override;
+
+    virtual Int AddSamples( const lfrt::SampleBatch& samples, const bool isWeighted = true ) override;
+
+private:
+    void Reset(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY );
+
+    float* PlaneRow( const Int& plane, const Int& y ) { return planes.data() + (plane*storageHeight + y)*storageWidth; }
+    const float* PlaneRow( const Int& plane, const Int& y ) const { return planes.data() + (plane*storageHeight + y)*storageWidth; }
+
+    // Adds one sample; returns false if it is outside of the tile.
+    bool Splat( const VEC2& raster,
+        const Real& sampleWeight, const Real& rayWeight,
+        const Real& r, const Real& g, const Real& b,
+        const bool isWeighted );
+
+private:
+    const ReconstructionFilter* filter = nullptr;
+    // Pixels whose samples are accepted.
+    Int startX = 0;
+    Int startY = 0;
+    Int endX = 0;
+    Int endY = 0;
+    // Stored area, which includes the halo.
+    Int storageX = 0;
+    Int storageY = 0;
+    Int storageWidth = 0;
+    Int storageHeight = 0;
+    std::vector<float> planes;
+    std::vector<int> counts;
+    // Filter weights of the current sample along X and Y.
+    std::vector<Real> weightsX;
+    std::vector<Real> weightsY;
+    // Bounding box of touched pixels, in storage coordinates.
+    Int touchedStartX = 0;
+    Int touchedStartY = 0;
+    Int touchedEndX = 0;
+    Int touchedEndY = 0;
+};
+
+
+
+#endif // UTILITIES_SAMPLEACCUMFILTER_H
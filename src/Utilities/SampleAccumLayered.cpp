@@ -0,0 +1,54 @@
+#include "SampleAccumLayered.h"
+
+using namespace lfrt;
+
+
+
+SampleAccumLayered::SampleAccumLayered( const Int layerWidth, const Int layerHeight, const Int numLayers )
+    :SampleAccumCV( layerWidth, layerHeight * numLayers )
+    ,numLayers(numLayers)
+{
+}
+
+
+bool SampleAccumLayered::SetSize( const Int& width, const Int& height )
+{
+    if ( numLayers <= 0 || height % numLayers != 0 )
+        return false;
+    return SetLayers( width, height / numLayers, numLayers );
+}
+
+
+bool SampleAccumLayered::SetLayers( const Int& layerWidth, const Int& layerHeight, const Int& numLayers )
+{
+    if ( numLayers <= 0 )
+        return false;
+    if ( !SampleAccumCV::SetSize( layerWidth, layerHeight * numLayers ) )
+        return false;
+    this->numLayers = numLayers;
+    return true;
+}
+
+
+cv::Rect SampleAccumLayered::LayerRect( const Int& layer ) const
+{
+    return cv::Rect( 0, int(layer * LayerHeight()), int(LayerWidth()), int(LayerHeight()) );
+}
+
+
+void SampleAccumLayered::SaveLayerToImage( const Int& layer, cv::Mat& image ) const
+{
+    cv::Mat atlas;
+    SaveToImage( atlas );
+    image = atlas( LayerRect( layer ) ).clone();
+}
+
+
+void SampleAccumLayered::SaveLayersToImages( std::vector<cv::Mat>& images ) const
+{
+    cv::Mat atlas;
+    SaveToImage( atlas );
+    images.resize( numLayers );
+    for ( Int layer = 0; layer < numLayers; ++layer )
+        images[layer] = atlas( LayerRect( layer ) ).clone();
+}
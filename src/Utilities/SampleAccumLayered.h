@@ -0,0 +1,45 @@
+#ifndef UTILITIES_SAMPLEACCUMLAYERED_H
+#define UTILITIES_SAMPLEACCUMLAYERED_H
+
+#include "LFRayTracer.h"
+#include "SampleAccumCV.h"
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+
+// SampleAccumCV over an atlas of equally sized layers, stacked vertically the same way as in RayGenMultiView.
+// All layers are rendered by one Render call; afterwards they are resolved into separate images.
+class SampleAccumLayered : public SampleAccumCV
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+
+public:
+    SampleAccumLayered( const Int layerWidth, const Int layerHeight, const Int numLayers );
+    virtual ~SampleAccumLayered() = default;
+
+    // Resize the atlas to the given size, keeping the number of layers; height has to be divisible by it.
+    // Use SetLayers to change the number of layers.
+    virtual bool SetSize( const Int& width, const Int& height ) override;
+    bool SetLayers( const Int& layerWidth, const Int& layerHeight, const Int& numLayers );
+
+    Int NumLayers() const { return numLayers; }
+    Int LayerWidth() const { return Width(); }
+    Int LayerHeight() const { return numLayers > 0 ? Height() / numLayers : 0; }
+    // Pixels of the layer in the atlas.
+    cv::Rect LayerRect( const Int& layer ) const;
+
+    // Image of one layer; see SaveToImage.
+    void SaveLayerToImage( const Int& layer, cv::Mat& image ) const;
+    // Images of all layers. Atlas is resolved once and split.
+    void SaveLayersToImages( std::vector<cv::Mat>& images ) const;
+
+private:
+    Int numLayers = 0;
+};
+
+
+
+#endif // UTILITIES_SAMPLEACCUMLAYERED_H
@@ -0,0 +1,365 @@
+#include "SampleAccumPlanar.h"
+
+
+
+using namespace lfrt;
+
+
+
+SampleAccumPlanar::SampleAccumPlanar( const Int width, const Int height )
+{
+    SetSize( width, height );
+}
+
+
+SampleAccumPlanar::~SampleAccumPlanar()
+{
+    for ( SampleTilePlanar* tile : tilePool )
+        delete tile;
+}
+
+
+
+bool SampleAccumPlanar::SetSize( const Int& width, const Int& height )
+{
+    if ( width <= 0 || height <= 0 )
+        return false;
+    this->width = width;
+    this->height = height;
+    planes.assign( std::size_t(NumPlanes) * width * height, 0.0f );
+    counts.assign( std::size_t(width) * height, 0 );
+    ClearDirtyRegions();
+    return true;
+}
+
+
+
+SampleTile* SampleAccumPlanar::CreateSampleTile(
+    const Int& startX, const Int& startY,
+    const Int&   endX, const Int&   endY )
+{
+    SampleTilePlanar* tile = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( tilePoolMutex );
+        if ( !tilePool.empty() )
+        {
+            tile = tilePool.back();
+            tilePool.pop_back();
+        }
+    }
+    if ( tile == nullptr )
+        return new SampleTilePlanar( startX, startY, endX, endY );
+    tile->Reset( startX, startY, endX, endY );
+    return tile;
+}
+
+
+bool SampleAccumPlanar::MergeSampleTile( SampleTile* tile )
+{
+    return WriteTile( tile, false );
+}
+
+
+bool SampleAccumPlanar::AddSampleTile( SampleTile* tile )
+{
+    return WriteTile( tile, true );
+}
+
+
+bool SampleAccumPlanar::WriteTile( SampleTile* tile, const bool isAdditive )
+{
+    SampleTilePlanar* filmTile = dynamic_cast<SampleTilePlanar*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    // Clip tile columns to the accumulator once; every row then is a contiguous span.
+    const Int startX = std::max<Int>( filmTile->startX, 0 );
+    const Int endX = std::min<Int>( filmTile->startX + filmTile->width, width );
+    if ( startX >= endX )
+        return true;
+    const Int length = endX - startX;
+    const Int localStartX = startX - filmTile->startX;
+    for ( Int localY = 0; localY < filmTile->height; ++localY )
+    {
+        const Int y = filmTile->startY + localY;
+        if ( y < 0 || y >= height )
+            continue;
+        for ( Int plane = 0; plane < NumPlanes; ++plane )
+        {
+            const float* src = filmTile->PlaneRow( plane, localY ) + localStartX;
+            float* dst = WritablePlaneRow( plane, y ) + startX;
+            if ( isAdditive )
+            {
+                for ( Int i = 0; i < length; ++i )
+                    dst[i] += src[i];
+            }
+            else
+            {
+                std::copy( src, src + length, dst );
+            }
+        }
+        const int* srcCounts = filmTile->counts.data() + localY*filmTile->width + localStartX;
+        int* dstCounts = counts.data() + std::size_t(y)*width + startX;
+        if ( isAdditive )
+        {
+            for ( Int i = 0; i < length; ++i )
+                dstCounts[i] += srcCounts[i];
+        }
+        else
+        {
+            std::copy( srcCounts, srcCounts + length, dstCounts );
+        }
+    }
+    return true;
+}
+
+
+bool SampleAccumPlanar::DestroySampleTile( SampleTile* tile )
+{
+    SampleTilePlanar* filmTile = dynamic_cast<SampleTilePlanar*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    std::lock_guard<std::mutex> lock( tilePoolMutex );
+    tilePool.push_back( filmTile );
+    return true;
+}
+
+
+bool SampleAccumPlanar::GetColor( const Int& x, const Int& y, Real& r, Real& g, Real& b ) const
+{
+    if ( x < 0 || y < 0 || x >= Width() || y >= Height() )
+        return false;
+    const Real w = PlaneRow( PlaneWeight, y )[x];
+    r = PlaneRow( PlaneFlatR, y )[x];
+    g = PlaneRow( PlaneFlatG, y )[x];
+    b = PlaneRow( PlaneFlatB, y )[x];
+    if ( w > 0 )
+    {
+        r += PlaneRow( PlaneR, y )[x] / w;
+        g += PlaneRow( PlaneG, y )[x] / w;
+        b += PlaneRow( PlaneB, y )[x] / w;
+    }
+    return true;
+}
+
+
+void SampleAccumPlanar::EstimateError( cv::Mat& error ) const
+{
+    error = cv::Mat( height, width, CV_32FC1 );
+    for ( Int y = 0; y < height; ++y )
+    {
+        const float* sumR = PlaneRow( PlaneR, y );
+        const float* sumG = PlaneRow( PlaneG, y );
+        const float* sumB = PlaneRow( PlaneB, y );
+        const float* sumW = PlaneRow( PlaneWeight, y );
+        const float* sumSq = PlaneRow( PlaneSumSq, y );
+        const int* count = counts.data() + std::size_t(y)*width;
+        float* row = error.ptr<float>(y);
+        for ( Int x = 0; x < width; ++x )
+            row[x] = StandardError( Luminance( sumR[x], sumG[x], sumB[x] ), sumW[x], sumSq[x], count[x] );
+    }
+}
+
+
+void SampleAccumPlanar::Clear( const Int& startX, const Int& startY, const Int& endX, const Int& endY )
+{
+    const Int x0 = std::max<Int>( startX, 0 );
+    const Int x1 = std::min<Int>( endX, width );
+    if ( x0 >= x1 )
+        return;
+    for ( Int y = std::max<Int>( startY, 0 ); y < std::min<Int>( endY, height ); ++y )
+    {
+        for ( Int plane = 0; plane < NumPlanes; ++plane )
+        {
+            float* row = WritablePlaneRow( plane, y );
+            std::fill( row + x0, row + x1, 0.0f );
+        }
+        std::fill( counts.begin() + std::size_t(y)*width + x0, counts.begin() + std::size_t(y)*width + x1, 0 );
+    }
+}
+
+
+void SampleAccumPlanar::SaveToImage( cv::Mat& image ) const
+{
+    image = cv::Mat( height, width, HalfPrecisionOutput ? CV_16FC3 : CV_32FC3 );
+
+    cv::parallel_for_( cv::Range( 0, height ),
+        [&]( const cv::Range& range )
+        {
+            // Half-precision rows are resolved into float first and converted at once.
+            std::vector<float> rowBuffer( HalfPrecisionOutput ? 3*width : 0 );
+            for ( int y = range.start; y < range.end; ++y )
+            {
+                const float* sumR = PlaneRow( PlaneR, y );
+                const float* sumG = PlaneRow( PlaneG, y );
+                const float* sumB = PlaneRow( PlaneB, y );
+                const float* sumW = PlaneRow( PlaneWeight, y );
+                const float* flatR = PlaneRow( PlaneFlatR, y );
+                const float* flatG = PlaneRow( PlaneFlatG, y );
+                const float* flatB = PlaneRow( PlaneFlatB, y );
+                float* out = HalfPrecisionOutput ? rowBuffer.data() : image.ptr<float>(y);
+                for ( int x = 0; x < width; ++x )
+                {
+                    // Select instead of branch, so that the loop stays vectorizable.
+                    const float inv = sumW[x] > 0 ? 1.0f / sumW[x] : 0.0f;
+                    out[3*x+0] = flatB[x] + sumB[x] * inv;
+                    out[3*x+1] = flatG[x] + sumG[x] * inv;
+                    out[3*x+2] = flatR[x] + sumR[x] * inv;
+                }
+                if ( HalfPrecisionOutput )
+                {
+                    cv::float16_t* outHalf = image.ptr<cv::float16_t>(y);
+                    for ( int i = 0; i < 3*width; ++i )
+                        outHalf[i] = cv::float16_t( out[i] );
+                }
+            }
+        }
+    );
+}
+
+
+
+SampleTilePlanar::SampleTilePlanar( const Int& startX, const Int& startY, const Int& endX, const Int& endY )
+{
+    Reset( startX, startY, endX, endY );
+}
+
+
+void SampleTilePlanar::Reset( const Int& startX, const Int& startY, const Int& endX, const Int& endY )
+{
+    // Everything outside the touched box is already zero, so after this the whole storage is zero.
+    if ( touchedStartX < touchedEndX && touchedStartY < touchedEndY )
+    {
+        for ( Int y = touchedStartY; y < touchedEndY; ++y )
+        {
+            for ( Int plane = 0; plane < SampleAccumPlanar::NumPlanes; ++plane )
+            {
+                float* row = PlaneRow( plane, y );
+                std::fill( row + touchedStartX, row + touchedEndX, 0.0f );
+            }
+            int* countRow = counts.data() + std::size_t(y)*width;
+            std::fill( countRow + touchedStartX, countRow + touchedEndX, 0 );
+        }
+    }
+
+    this->startX = startX;
+    this->startY = startY;
+    width = std::max<Int>( endX-startX, 0 );
+    height = std::max<Int>( endY-startY, 0 );
+    // Growing value-initializes new elements; shrinking keeps the capacity.
+    planes.resize( SampleAccumPlanar::NumPlanes * width * height, 0.0f );
+    counts.resize( width * height, 0 );
+
+    touchedStartX = width;
+    touchedStartY = height;
+    touchedEndX = 0;
+    touchedEndY = 0;
+}
+
+
+void SampleTilePlanar::AddToPixel( const Int& x, const Int& y,
+    const Real& sumR, const Real& sumG, const Real& sumB,
+    const Real& sumW, const Real& sumSq, const Int& numSamples, const bool isWeighted )
+{
+    touchedStartX = std::min( touchedStartX, x );
+    touchedStartY = std::min( touchedStartY, y );
+    touchedEndX = std::max( touchedEndX, x+1 );
+    touchedEndY = std::max( touchedEndY, y+1 );
+    if ( isWeighted )
+    {
+        PlaneRow( SampleAccumPlanar::PlaneR, y )[x] += sumR;
+        PlaneRow( SampleAccumPlanar::PlaneG, y )[x] += sumG;
+        PlaneRow( SampleAccumPlanar::PlaneB, y )[x] += sumB;
+        PlaneRow( SampleAccumPlanar::PlaneWeight, y )[x] += sumW;
+        PlaneRow( SampleAccumPlanar::PlaneSumSq, y )[x] += sumSq;
+    }
+    else
+    {
+        PlaneRow( SampleAccumPlanar::PlaneFlatR, y )[x] += sumR;
+        PlaneRow( SampleAccumPlanar::PlaneFlatG, y )[x] += sumG;
+        PlaneRow( SampleAccumPlanar::PlaneFlatB, y )[x] += sumB;
+    }
+    counts[y*width + x] += numSamples;
+}
+
+
+bool SampleTilePlanar::AddSample(
+    const VEC2& raster, const VEC2& /*secondary*/,
+    const Real& sampleWeight, const Real& rayWeight,
+    const Real& r, const Real& g, const Real& b,
+    const bool isWeighted )
+{
+    const Int x = Int(raster.x) - startX;
+    const Int y = Int(raster.y) - startY;
+    if ( x < 0 || y < 0 || x >= width || y >= height )
+        return false;
+    if ( isWeighted )
+    {
+        const Real w = sampleWeight * rayWeight;
+        const Real lum = SampleAccumPlanar::Luminance( r, g, b );
+        AddToPixel( x, y, w*r, w*g, w*b, w, w*lum*lum, (w > 0) ? 1 : 0, true );
+    }
+    else
+    {
+        AddToPixel( x, y, r, g, b, 0, 0, 1, false );
+    }
+    return true;
+}
+
+
+Int SampleTilePlanar::AddSamples( const lfrt::SampleBatch& samples, const bool isWeighted )
+{
+    const Int count = samples.count;
+    const VEC2* raster = samples.raster;
+    Int numAccepted = 0;
+    Int runStart = 0;
+    while ( runStart < count )
+    {
+        // Find run of consecutive samples which fall into the same pixel.
+        const Int pixelX = Int(raster[runStart].x);
+        const Int pixelY = Int(raster[runStart].y);
+        Int runEnd = runStart + 1;
+        while ( runEnd < count && Int(raster[runEnd].x) == pixelX && Int(raster[runEnd].y) == pixelY )
+            ++runEnd;
+
+        const Int x = pixelX - startX;
+        const Int y = pixelY - startY;
+        if ( x >= 0 && y >= 0 && x < width && y < height )
+        {
+            Real sumR = 0;
+            Real sumG = 0;
+            Real sumB = 0;
+            Real sumW = 0;
+            Real sumSq = 0;
+            Int numTaken = 0;
+            if ( isWeighted )
+            {
+                for ( Int i = runStart; i < runEnd; ++i )
+                {
+                    const Real w = samples.sampleWeight[i] * samples.rayWeight[i];
+                    const Real lum = SampleAccumPlanar::Luminance( samples.r[i], samples.g[i], samples.b[i] );
+                    sumR += w * samples.r[i];
+                    sumG += w * samples.g[i];
+                    sumB += w * samples.b[i];
+                    sumW += w;
+                    sumSq += w * lum * lum;
+                    // Rejected samples (zero weight) carry no information for the error estimate.
+                    numTaken += (w > 0) ? 1 : 0;
+                }
+            }
+            else
+            {
+                for ( Int i = runStart; i < runEnd; ++i )
+                {
+                    sumR += samples.r[i];
+                    sumG += samples.g[i];
+                    sumB += samples.b[i];
+                }
+                numTaken = runEnd - runStart;
+            }
+            AddToPixel( x, y, sumR, sumG, sumB, sumW, sumSq, numTaken, isWeighted );
+            numAccepted += runEnd - runStart;
+        }
+        runStart = runEnd;
+    }
+    return numAccepted;
+}
@@ -0,0 +1,143 @@
+#ifndef UTILITIES_SAMPLEACCUMPLANAR_H
+#define UTILITIES_SAMPLEACCUMPLANAR_H
+
+#include "LFRayTracer.h"
+#include "MultiPassAccumulator.h"
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+
+class SampleTilePlanar;
+
+
+// Drop-in alternative to SampleAccumCV with planar storage.
+// Every channel is a separate contiguous row-major float array,
+// so that tiles are merged and the image is resolved with plain loops over whole rows.
+// Tiles are pooled the same way as in SampleAccumCV.
+class SampleAccumPlanar : public MultiPassAccumulator
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+
+    enum Plane
+    {
+        PlaneR,
+        PlaneG,
+        PlaneB,
+        PlaneWeight,
+        PlaneFlatR, // Unweighted samples.
+        PlaneFlatG,
+        PlaneFlatB,
+        PlaneSumSq, // Weighted sum of squared luminance.
+        NumPlanes
+    };
+
+public:
+    SampleAccumPlanar( const Int width, const Int height );
+    virtual ~SampleAccumPlanar();
+
+    // Inherited via SampleAccumulator
+    // Clears all pixels, even if the size does not change.
+    virtual bool SetSize( const Int& width, const Int& height ) override;
+    virtual Int Width() const override { return width; }
+    virtual Int Height() const override { return height; }
+    virtual lfrt::SampleTile* CreateSampleTile(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY ) override;
+    virtual bool MergeSampleTile( lfrt::SampleTile* tile ) override;
+    virtual bool DestroySampleTile( lfrt::SampleTile* tile ) override;
+    virtual bool GetColor( const Int& x, const Int& y, Real& r, Real& g, Real& b ) const override;
+
+    // Inherited via MultiPassAccumulator
+    virtual bool AddSampleTile( lfrt::SampleTile* tile ) override;
+    virtual void EstimateError( cv::Mat& error ) const override;
+    virtual void Clear( const Int& startX, const Int& startY, const Int& endX, const Int& endY ) override;
+    // Pixels with zero weight resolve to their unweighted part only.
+    virtual void SaveToImage( cv::Mat& image ) const override;
+
+    // Row 'y' of the given plane; Width() elements.
+    const float* PlaneRow( const Int& plane, const Int& y ) const { return planes.data() + std::size_t(plane*height + y)*width; }
+    // Number of samples taken in each pixel, row-major; weighted samples count only if their weight is positive.
+    const std::vector<int>& SampleCounts() const { return counts; }
+
+protected:
+    float* WritablePlaneRow( const Int& plane, const Int& y ) { return planes.data() + std::size_t(plane*height + y)*width; }
+
+private:
+    // Writes rows of the tile into the accumulator, either replacing or adding to the current values.
+    bool WriteTile( lfrt::SampleTile* tile, const bool isAdditive );
+
+protected:
+    Int width = 0;
+    Int height = 0;
+    std::vector<float> planes; // NumPlanes planes of width x height.
+    std::vector<int> counts;
+
+private:
+    std::mutex tilePoolMutex;
+    std::vector<SampleTilePlanar*> tilePool;
+};
+
+
+
+class SampleTilePlanar final : public lfrt::SampleTile
+{
+public:
+    friend class SampleAccumPlanar;
+    using VEC2 = lfrt::VEC2;
+    using Real = lfrt::Real;
+    using Int = lfrt::Int;
+    using Plane = SampleAccumPlanar::Plane;
+
+protected:
+    virtual ~SampleTilePlanar() = default;
+
+public:
+    SampleTilePlanar(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY );
+
+    virtual bool AddSample( const VEC2& raster, const VEC2& secondary,
+        const Real& sampleWeight, const Real& rayWeight,
+        const Real& r, const Real& g, const Real& b,
+        const bool isWeighted = true ) override;
+
+    // Samples which fall into the same pixel one after another are reduced together before writing.
+    virtual Int AddSamples( const lfrt::SampleBatch& samples, const bool isWeighted = true ) override;
+
+private:
+    // Move tile to another area, clearing only the part touched since the previous reset.
+    void Reset(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY );
+
+    float* PlaneRow( const Int& plane, const Int& y ) { return planes.data() + std::size_t(plane*height + y)*width; }
+    const float* PlaneRow( const Int& plane, const Int& y ) const { return planes.data() + std::size_t(plane*height + y)*width; }
+
+    // Add reduced values to local pixel (x,y), which must be inside the tile.
+    void AddToPixel( const Int& x, const Int& y,
+        const Real& sumR, const Real& sumG, const Real& sumB,
+        const Real& sumW, const Real& sumSq, const Int& numSamples, const bool isWeighted );
+
+private:
+    std::vector<float> planes;
+    std::vector<int> counts;
+    Int startX = 0;
+    Int startY = 0;
+    Int width = 0;
+    Int height = 0;
+    // Bounding box of touched pixels, in local coordinates.
+    Int touchedStartX = 0;
+    Int touchedStartY = 0;
+    Int touchedEndX = 0;
+    Int touchedEndY = 0;
+};
+
+
+
+#endif // UTILITIES_SAMPLEACCUMPLANAR_H
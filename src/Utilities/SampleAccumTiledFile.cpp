@@ -0,0 +1,118 @@
+#include "SampleAccumTiledFile.h"
+
+
+
+using namespace lfrt;
+
+
+
+SampleAccumTiledFile::SampleAccumTiledFile( const std::string& filepath, const Int width, const Int height, const Int fileTileSize )
+    :filepath(filepath)
+    ,fileTileSize(fileTileSize)
+{
+    SetSize( width, height );
+}
+
+
+SampleAccumTiledFile::~SampleAccumTiledFile()
+{
+    for ( SampleTileCV* tile : tilePool )
+        delete tile;
+}
+
+
+bool SampleAccumTiledFile::SetSize( const Int& width, const Int& height )
+{
+    if ( width <= 0 || height <= 0 )
+        return false;
+    if ( !file.Create( filepath, width, height, fileTileSize ) )
+        return false;
+    this->width = width;
+    this->height = height;
+    return true;
+}
+
+
+bool SampleAccumTiledFile::GetRenderBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const
+{
+    startX = 0;
+    startY = 0;
+    endX = Width();
+    endY = Height();
+    return IsOpen();
+}
+
+
+bool SampleAccumTiledFile::GetSamplingBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const
+{
+    return GetRenderBounds( startX, startY, endX, endY );
+}
+
+
+SampleTile* SampleAccumTiledFile::CreateSampleTile(
+    const Int& startX, const Int& startY,
+    const Int&   endX, const Int&   endY )
+{
+    SampleTileCV* tile = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( tilePoolMutex );
+        if ( !tilePool.empty() )
+        {
+            tile = tilePool.back();
+            tilePool.pop_back();
+        }
+    }
+    if ( tile == nullptr )
+        return new SampleTileCV( startX, startY, endX, endY );
+    tile->Reset( startX, startY, endX, endY );
+    return tile;
+}
+
+
+bool SampleAccumTiledFile::MergeSampleTile( SampleTile* tile )
+{
+    SampleTileCV* filmTile = dynamic_cast<SampleTileCV*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    if ( filmTile->width <= 0 || filmTile->height <= 0 )
+        return true;
+
+    // Resolve the tile before writing, so that only final colors reach the file.
+    cv::Mat resolved( filmTile->height, filmTile->width, CV_32FC3 );
+    for ( Int y = 0; y < filmTile->height; ++y )
+    {
+        const RGB* sum = filmTile->weighted.ptr<RGB>(y);
+        const Gray* w = filmTile->weights.ptr<Gray>(y);
+        const RGB* flat = filmTile->unweighted.ptr<RGB>(y);
+        RGB* dst = resolved.ptr<RGB>(y);
+        for ( Int x = 0; x < filmTile->width; ++x )
+            dst[x] = w[x] > 0 ? RGB( flat[x] + sum[x] / w[x] ) : flat[x];
+    }
+    return file.WriteRegion( filmTile->startX, filmTile->startY, resolved );
+}
+
+
+bool SampleAccumTiledFile::DestroySampleTile( SampleTile* tile )
+{
+    SampleTileCV* filmTile = dynamic_cast<SampleTileCV*>( tile );
+    if ( filmTile == nullptr )
+        return false;
+    std::lock_guard<std::mutex> lock( tilePoolMutex );
+    tilePool.push_back( filmTile );
+    return true;
+}
+
+
+bool SampleAccumTiledFile::GetColor( const Int& x, const Int& y, Real& r, Real& g, Real& b ) const
+{
+    if ( x < 0 || y < 0 || x >= Width() || y >= Height() )
+        return false;
+    cv::Mat pixel;
+    if ( !file.ReadRegion( x, y, 1, 1, pixel ) )
+        return false;
+    const RGB& color = pixel.at<RGB>(0,0);
+    r = color[2];
+    g = color[1];
+    b = color[0];
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef UTILITIES_SAMPLEACCUMTILEDFILE_H
+#define UTILITIES_SAMPLEACCUMTILEDFILE_H
+
+#include "LFRayTracer.h"
+#include "SampleAccumCV.h"
+#include "TiledImageFile.h"
+#include <opencv2/opencv.hpp>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Accumulator for outputs which do not fit into memory.
+// Every merged tile is resolved the same way as SampleAccumCV::GetColor and written straight
+// into a TiledImageFile; only the tiles being rendered are kept in memory (as pooled SampleTileCV).
+// Merging replaces pixels, so it supports single-pass rendering only; progressive and adaptive
+// passes of TileRenderEngine need MultiPassAccumulator and are skipped.
+class SampleAccumTiledFile : public lfrt::SampleAccumulator
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+    using RGB = cv::Vec3f;
+    using Gray = float;
+
+public:
+    // Creates the file immediately; check IsOpen.
+    SampleAccumTiledFile( const std::string& filepath, const Int width, const Int height, const Int fileTileSize = 64 );
+    virtual ~SampleAccumTiledFile();
+
+    bool IsOpen() const { return file.IsOpen(); }
+
+    // Inherited via SampleAccumulator
+    // Recreates the file with the new size.
+    virtual bool SetSize( const Int& width, const Int& height ) override;
+    virtual Int Width() const override { return width; }
+    virtual Int Height() const override { return height; }
+    virtual bool GetRenderBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const override;
+    virtual bool GetSamplingBounds( Int& startX, Int& startY, Int& endX, Int& endY ) const override;
+    virtual lfrt::SampleTile* CreateSampleTile(
+        const Int& startX, const Int& startY,
+        const Int&   endX, const Int&   endY ) override;
+    virtual bool MergeSampleTile( lfrt::SampleTile* tile ) override;
+    virtual bool DestroySampleTile( lfrt::SampleTile* tile ) override;
+    // Reads the pixel back from the file; is slow.
+    virtual bool GetColor( const Int& x, const Int& y, Real& r, Real& g, Real& b ) const override;
+
+    // Resolved image, for reading regions back.
+    TiledImageFile& File() { return file; }
+
+private:
+    std::string filepath;
+    Int width = 0;
+    Int height = 0;
+    Int fileTileSize = 64;
+    mutable TiledImageFile file;
+
+    std::mutex tilePoolMutex;
+    std::vector<SampleTileCV*> tilePool;
+};
+
+
+
+#endif // UTILITIES_SAMPLEACCUMTILEDFILE_H
@@ -4,17 +4,19 @@ using namespace lfrt;
 
 
 SampleGenDisk::SampleGenDisk( const Int primaryRes, const Int secondaryRes )
-	:primaryRes(0)
-	,secondaryRes(0)
+	:primaryRes(1)
+	,secondaryRes(1)
 {
 	SetPrimaryRes( primaryRes );
-	SetSecondaryRes( secondaryRes );
+	if ( !SetSecondaryRes( secondaryRes ) )
+		SetSecondaryRes( 1 );
 }
 
 
 SampleGenerator* SampleGenDisk::Clone() const
 {
-	return new SampleGenDisk( primaryRes, secondaryRes );
+	// Clone shares the same immutable pattern, so aperture coordinates are not rebuilt.
+	return new SampleGenDisk( *this );
 }
 
 
@@ -29,23 +31,18 @@ bool SampleGenDisk::ResetPixel( const Int& x, const Int& y )
 
 Int SampleGenDisk::NumSamplesInPixel()
 {
-	return primaryRes*primaryRes*apertureCoords.size();
+	return pattern->Size();
 }
 
 
 bool SampleGenDisk::CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time )
 {
-	Int index = currentSampleInd;
-	const Int numApertureCoords = apertureCoords.size();
-	const Int indAp = index % numApertureCoords;
-	const Int indY = (index /= numApertureCoords) % primaryRes;
-	const Int indX = (index /= primaryRes) % primaryRes;
-	weight = 1.0;
-	const Real dx1 = (0.5+Real(indX)) / Real(primaryRes);
-	const Real dy1 = (0.5+Real(indY)) / Real(primaryRes);
-	const VEC2 ap = apertureCoords[indAp];
-	raster = { Real(x)+dx1, Real(y)+dy1 };
-	secondary = ap;
+	if ( currentSampleInd >= pattern->Size() )
+		return false;
+	const VEC2& offset = pattern->rasterOffsets[currentSampleInd];
+	weight = pattern->Weight( currentSampleInd );
+	raster = { Real(x)+offset.x, Real(y)+offset.y };
+	secondary = pattern->secondary[currentSampleInd];
 	time = 0.0;
 	return true;
 }
@@ -54,7 +51,45 @@ bool SampleGenDisk::CurrentSample( Real& weight, VEC2& raster, VEC2& secondary,
 bool SampleGenDisk::MoveToNextSample()
 {
 	++currentSampleInd;
-	return currentSampleInd < primaryRes*primaryRes*apertureCoords.size();
+	return currentSampleInd < pattern->Size();
+}
+
+
+Int SampleGenDisk::GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary )
+{
+	ResetPixel( x, y );
+	const Int numSamples = pattern->Size();
+	const VEC2* offsets = pattern->rasterOffsets.data();
+	const VEC2* secondaryCoords = pattern->secondary.data();
+	const Real pixelX = Real(x);
+	const Real pixelY = Real(y);
+	for ( Int i = 0; i < numSamples; ++i )
+	{
+		weight[i] = pattern->Weight( i );
+		raster[i] = { pixelX + offsets[i].x, pixelY + offsets[i].y };
+		secondary[i] = secondaryCoords[i];
+	}
+	return numSamples;
+}
+
+
+bool SampleGenDisk::SetPass( const Int& pass )
+{
+	if ( pass < 0 )
+		return false;
+	this->pass = pass;
+	pattern = pass == 0 ? basePattern : MakePassPattern( *basePattern, pass, true );
+	if ( usedDims != SampleDimAll )
+		pattern = CollapsePattern( *pattern, usedDims );
+	currentSampleInd = 0;
+	return true;
+}
+
+
+bool SampleGenDisk::SetUsedDimensions( const unsigned& dims )
+{
+	usedDims = dims & SampleDimAll;
+	return SetPass( pass );
 }
 
 
@@ -63,6 +98,7 @@ bool SampleGenDisk::SetPrimaryRes( const Int primaryRes )
 	if ( primaryRes <= 0 )
 		return false;
 	this->primaryRes = primaryRes;
+	BuildPattern();
 	return true;
 }
 
@@ -84,5 +120,32 @@ bool SampleGenDisk::SetSecondaryRes( const Int secondaryRes )
 			apertureCoords.push_back({ x+0.5, y+0.5 });
 		}
 	}
+	BuildPattern();
 	return true;
 }
+
+
+void SampleGenDisk::BuildPattern()
+{
+	// Sample order: primary X, primary Y, aperture coordinate (the last one is the fastest).
+	auto newPattern = std::make_shared<SamplePattern>();
+	const Int numApertureCoords = apertureCoords.size();
+	const Int numSamples = primaryRes * primaryRes * numApertureCoords;
+	newPattern->rasterOffsets.reserve( numSamples );
+	newPattern->secondary.reserve( numSamples );
+	for ( Int indX = 0; indX < primaryRes; ++indX )
+	{
+		for ( Int indY = 0; indY < primaryRes; ++indY )
+		{
+			const Real dx1 = (0.5+Real(indX)) / Real(primaryRes);
+			const Real dy1 = (0.5+Real(indY)) / Real(primaryRes);
+			for ( Int indAp = 0; indAp < numApertureCoords; ++indAp )
+			{
+				newPattern->rasterOffsets.push_back({ dx1, dy1 });
+				newPattern->secondary.push_back( apertureCoords[indAp] );
+			}
+		}
+	}
+	basePattern = newPattern;
+	SetPass( pass );
+}
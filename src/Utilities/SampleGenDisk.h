@@ -2,13 +2,15 @@
 #define UTILITIES_SAMPLEGENDISK_H
 
 #include "LFRayTracer.h"
+#include "SamplePattern.h"
 
+#include <memory>
 #include <vector>
 
 
 // Primary sample coordinates are in uniform grid order.
 // Secondary sample coordinates are in uniform grid that is inside the incircle.
-class SampleGenDisk : public lfrt::SampleGenerator
+class SampleGenDisk final : public lfrt::SampleGenerator
 {
 public:
     using Int = lfrt::Int;
@@ -27,18 +29,34 @@ public:
 
     virtual bool MoveToNextSample() override;
 
+    virtual Int GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary ) override;
+
+    // Passes other than 0 use the same pattern, shifted by a low-discrepancy offset.
+    virtual bool SetPass( const Int& pass ) override;
+
+    // Samples of the pattern which differ only in unused dimensions are merged.
+    virtual bool SetUsedDimensions( const unsigned& dims ) override;
+
     bool SetPrimaryRes( const Int primaryRes );
     bool SetSecondaryRes( const Int secondaryRes );
 
+private:
+    void BuildPattern();
+
 private:
     Int primaryRes = 1;
     Int secondaryRes = 1;
     Int currentSampleInd = 0;
-    Int x;
-    Int y;
+    Int x = 0;
+    Int y = 0;
+    Int pass = 0;
+    unsigned usedDims = lfrt::SampleDimAll;
 
     std::vector<VEC2> apertureCoords;
+    // Built from primaryRes and apertureCoords, for pass 0 and for the current pass; shared between clones.
+    std::shared_ptr<const SamplePattern> basePattern;
+    std::shared_ptr<const SamplePattern> pattern;
 };
 
 
-#endif // UTILITIES_SAMPLEGENDISK_H
\ No newline at end of file
+#endif // UTILITIES_SAMPLEGENDISK_H
@@ -0,0 +1,144 @@
+#include "SampleGenJittered.h"
+
+#include "LowDiscrepancy.h"
+#include "Philox.h"
+
+using namespace lfrt;
+
+
+SampleGenJittered::SampleGenJittered( const Int primaryRes, const Int secondaryRes,
+    const bool isSecondaryDisk, const std::uint32_t seed )
+    :isSecondaryDisk(isSecondaryDisk)
+    ,seed(seed)
+{
+    if ( !SetPrimaryRes( primaryRes ) )
+        SetPrimaryRes( 1 );
+    if ( !SetSecondaryRes( secondaryRes ) )
+        SetSecondaryRes( 1 );
+}
+
+
+SampleGenerator* SampleGenJittered::Clone() const
+{
+    // Generator has no random state; the clone is a plain copy.
+    return new SampleGenJittered( *this );
+}
+
+
+bool SampleGenJittered::ResetPixel( const Int& x, const Int& y )
+{
+    this->x = x;
+    this->y = y;
+    currentSampleInd = 0;
+    return true;
+}
+
+
+Int SampleGenJittered::NumSamplesInPixel()
+{
+    return numSamples;
+}
+
+
+bool SampleGenJittered::CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time )
+{
+    if ( currentSampleInd >= numSamples )
+        return false;
+    weight = sampleWeight;
+    Sample( currentSampleInd, raster, secondary );
+    time = 0.0;
+    return true;
+}
+
+
+bool SampleGenJittered::MoveToNextSample()
+{
+    ++currentSampleInd;
+    return currentSampleInd < numSamples;
+}
+
+
+Int SampleGenJittered::GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary )
+{
+    ResetPixel( x, y );
+    for ( Int i = 0; i < numSamples; ++i )
+    {
+        weight[i] = sampleWeight;
+        Sample( i, raster[i], secondary[i] );
+    }
+    return numSamples;
+}
+
+
+bool SampleGenJittered::SetPass( const Int& pass )
+{
+    if ( pass < 0 )
+        return false;
+    this->pass = pass;
+    currentSampleInd = 0;
+    return true;
+}
+
+
+bool SampleGenJittered::SetPrimaryRes( const Int primaryRes )
+{
+    if ( primaryRes <= 0 )
+        return false;
+    this->primaryRes = primaryRes;
+    UpdateStrata();
+    return true;
+}
+
+
+bool SampleGenJittered::SetSecondaryRes( const Int secondaryRes )
+{
+    if ( secondaryRes <= 0 )
+        return false;
+    this->secondaryRes = secondaryRes;
+    UpdateStrata();
+    return true;
+}
+
+
+bool SampleGenJittered::SetUsedDimensions( const unsigned& dims )
+{
+    usedDims = dims & SampleDimAll;
+    UpdateStrata();
+    return true;
+}
+
+
+void SampleGenJittered::UpdateStrata()
+{
+    activePrimaryRes = (usedDims & SampleDimRaster) ? primaryRes : 1;
+    activeSecondaryRes = (usedDims & SampleDimSecondary) ? secondaryRes : 1;
+    numSamples = activePrimaryRes * activePrimaryRes * activeSecondaryRes * activeSecondaryRes;
+    // Total weight of the pixel does not depend on collapsing.
+    sampleWeight = Real( primaryRes * primaryRes * secondaryRes * secondaryRes ) / Real(numSamples);
+    currentSampleInd = 0;
+}
+
+
+void SampleGenJittered::Sample( const Int& sampleInd, VEC2& raster, VEC2& secondary ) const
+{
+    // Sample order: primary X, primary Y, secondary X, secondary Y (the last one is the fastest).
+    const Int indY2 = sampleInd % activeSecondaryRes;
+    const Int indX2 = (sampleInd / activeSecondaryRes) % activeSecondaryRes;
+    const Int primaryInd = sampleInd / (activeSecondaryRes * activeSecondaryRes);
+    const Int indY1 = primaryInd % activePrimaryRes;
+    const Int indX1 = primaryInd / activePrimaryRes;
+
+    // One Philox block gives all four jitter values of the sample.
+    const PhiloxCounter jitter = Philox4x32(
+        { std::uint32_t(sampleInd), std::uint32_t(pass), seed, 0 },
+        { std::uint32_t(x), std::uint32_t(y) } );
+
+    raster = {
+        Real(x) + (Real(indX1) + FixedToUnit( jitter[0] )) / Real(activePrimaryRes),
+        Real(y) + (Real(indY1) + FixedToUnit( jitter[1] )) / Real(activePrimaryRes) };
+    secondary = {
+        (Real(indX2) + FixedToUnit( jitter[2] )) / Real(activeSecondaryRes),
+        (Real(indY2) + FixedToUnit( jitter[3] )) / Real(activeSecondaryRes) };
+    if ( isSecondaryDisk )
+        secondary = ConcentricSquareToDisk( secondary );
+}
@@ -0,0 +1,74 @@
+#ifndef UTILITIES_SAMPLEGENJITTERED_H
+#define UTILITIES_SAMPLEGENJITTERED_H
+
+#include "LFRayTracer.h"
+
+#include <cstdint>
+
+
+// Jittered stratified sampler.
+// Pixel is split into primaryRes x primaryRes strata and secondary domain into secondaryRes x secondaryRes strata,
+// in the same order as SampleGenUniform; every sample is placed randomly inside its stratum.
+// Random numbers come from Philox keyed on pixel, sample index, pass and seed,
+// so the result does not depend on how pixels are distributed between threads.
+// If 'isSecondaryDisk', secondary coordinates are mapped to the incircle of [0,1]x[0,1] (see SampleGenDisk).
+class SampleGenJittered final : public lfrt::SampleGenerator
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+    using VEC2 = lfrt::VEC2;
+
+    SampleGenJittered( const Int primaryRes = 1, const Int secondaryRes = 1,
+        const bool isSecondaryDisk = false, const std::uint32_t seed = 0 );
+
+    virtual SampleGenerator* Clone() const override;
+
+    virtual bool ResetPixel( const Int& x, const Int& y ) override;
+
+    virtual Int NumSamplesInPixel() override;
+
+    virtual bool CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time ) override;
+
+    virtual bool MoveToNextSample() override;
+
+    virtual Int GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary ) override;
+
+    // Every pass draws new jitter for the same strata.
+    virtual bool SetPass( const Int& pass ) override;
+
+    // Strata of unused dimensions are merged into one, whose sample carries their total weight.
+    virtual bool SetUsedDimensions( const unsigned& dims ) override;
+
+    bool SetPrimaryRes( const Int primaryRes );
+    bool SetSecondaryRes( const Int secondaryRes );
+
+    Int PrimaryRes() const { return primaryRes; }
+    Int SecondaryRes() const { return secondaryRes; }
+
+private:
+    // Update active strata and sample weight after changing resolutions or used dimensions.
+    void UpdateStrata();
+
+    // Sample 'sampleInd' of the current pixel and pass.
+    void Sample( const Int& sampleInd, VEC2& raster, VEC2& secondary ) const;
+
+private:
+    Int primaryRes = 1;
+    Int secondaryRes = 1;
+    bool isSecondaryDisk = false;
+    std::uint32_t seed = 0;
+    unsigned usedDims = lfrt::SampleDimAll;
+    // Resolutions which are actually sampled; 1 for unused dimensions.
+    Int activePrimaryRes = 1;
+    Int activeSecondaryRes = 1;
+    Int numSamples = 1;
+    Real sampleWeight = 1;
+    Int currentSampleInd = 0;
+    Int x = 0;
+    Int y = 0;
+    Int pass = 0;
+};
+
+
+#endif // UTILITIES_SAMPLEGENJITTERED_H
@@ -0,0 +1,124 @@
+#include "SampleGenLowDiscrepancy.h"
+
+#include "LowDiscrepancy.h"
+
+using namespace lfrt;
+
+
+SampleGenLowDiscrepancy::SampleGenLowDiscrepancy( const Int numSamples, const Sequence sequence,
+    const bool isSecondaryDisk, const std::uint32_t seed )
+    :sequence(sequence)
+    ,isSecondaryDisk(isSecondaryDisk)
+    ,seed(seed)
+{
+    if ( !SetNumSamples( numSamples ) )
+        SetNumSamples( 1 );
+}
+
+
+SampleGenerator* SampleGenLowDiscrepancy::Clone() const
+{
+    // Sequences need only the precomputed direction table, so the clone is a plain copy.
+    return new SampleGenLowDiscrepancy( *this );
+}
+
+
+bool SampleGenLowDiscrepancy::ResetPixel( const Int& x, const Int& y )
+{
+    this->x = x;
+    this->y = y;
+    pixelSeed = HashCombine( HashCombine( seed, std::uint32_t(x) ), std::uint32_t(y) );
+    const bool isInMap = !sampleCounts.empty() && x >= 0 && y >= 0 && x < sampleCounts.cols && y < sampleCounts.rows;
+    pixelNumSamples = isInMap ? sampleCounts.at<int>( y, x ) : numSamples;
+    currentSampleInd = 0;
+    return true;
+}
+
+
+Int SampleGenLowDiscrepancy::NumSamplesInPixel()
+{
+    return pixelNumSamples;
+}
+
+
+bool SampleGenLowDiscrepancy::CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time )
+{
+    if ( currentSampleInd >= pixelNumSamples )
+        return false;
+    weight = 1.0;
+    Sample( currentSampleInd, raster, secondary );
+    time = 0.0;
+    return true;
+}
+
+
+bool SampleGenLowDiscrepancy::MoveToNextSample()
+{
+    ++currentSampleInd;
+    return currentSampleInd < pixelNumSamples;
+}
+
+
+Int SampleGenLowDiscrepancy::GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary )
+{
+    ResetPixel( x, y );
+    for ( Int i = 0; i < pixelNumSamples; ++i )
+    {
+        weight[i] = 1.0;
+        Sample( i, raster[i], secondary[i] );
+    }
+    return pixelNumSamples;
+}
+
+
+bool SampleGenLowDiscrepancy::SetPass( const Int& pass )
+{
+    if ( pass < 0 )
+        return false;
+    this->pass = pass;
+    currentSampleInd = 0;
+    return true;
+}
+
+
+bool SampleGenLowDiscrepancy::SetNumSamples( const Int numSamples )
+{
+    if ( numSamples <= 0 )
+        return false;
+    this->numSamples = numSamples;
+    pixelNumSamples = numSamples;
+    return true;
+}
+
+
+bool SampleGenLowDiscrepancy::SetSampleCountMap( const cv::Mat& counts )
+{
+    if ( !counts.empty() && counts.type() != CV_32SC1 )
+        return false;
+    sampleCounts = counts;
+    return true;
+}
+
+
+void SampleGenLowDiscrepancy::Sample( const Int& sampleInd, VEC2& raster, VEC2& secondary ) const
+{
+    const std::uint64_t index = std::uint64_t(pass) * pixelNumSamples + sampleInd;
+    Real values[SobolNumDimensions];
+    if ( sequence == Sequence::Sobol )
+    {
+        // Index is shuffled per pixel as well, so that dimensions sharing the point set stay decorrelated between pixels.
+        const std::uint32_t shuffled = OwenScramble( std::uint32_t(index), pixelSeed );
+        for ( Int dim = 0; dim < SobolNumDimensions; ++dim )
+            values[dim] = FixedToUnit( OwenScramble( SobolSample( shuffled, dim ), HashCombine( pixelSeed, dim ) ) );
+    }
+    else
+    {
+        for ( Int dim = 0; dim < SobolNumDimensions; ++dim )
+            values[dim] = OwenScrambledRadicalInverse( index, HaltonBase( dim ), HashCombine( pixelSeed, dim ) );
+    }
+
+    raster = { Real(x) + values[0], Real(y) + values[1] };
+    secondary = { values[2], values[3] };
+    if ( isSecondaryDisk )
+        secondary = ConcentricSquareToDisk( secondary );
+}
@@ -0,0 +1,73 @@
+#ifndef UTILITIES_SAMPLEGENLOWDISCREPANCY_H
+#define UTILITIES_SAMPLEGENLOWDISCREPANCY_H
+
+#include "LFRayTracer.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+
+
+// Samples 4D (raster offset, secondary) domain with an Owen-scrambled Sobol or Halton sequence.
+// Scrambling is seeded by the pixel, so that neighbouring pixels are decorrelated,
+// and pixel samples stay stratified in every 2D projection.
+// Pass 'p' continues the same sequence with samples [p*N,(p+1)*N), where N is the number of samples per pixel.
+// If 'isSecondaryDisk', secondary coordinates are mapped to the incircle of [0,1]x[0,1] by the concentric mapping,
+// as expected for aperture samples (see SampleGenDisk).
+class SampleGenLowDiscrepancy final : public lfrt::SampleGenerator
+{
+public:
+    using Int = lfrt::Int;
+    using Real = lfrt::Real;
+    using VEC2 = lfrt::VEC2;
+
+    enum class Sequence
+    {
+        Sobol,
+        Halton,
+    };
+
+    SampleGenLowDiscrepancy( const Int numSamples = 16, const Sequence sequence = Sequence::Sobol,
+        const bool isSecondaryDisk = true, const std::uint32_t seed = 0 );
+
+    virtual SampleGenerator* Clone() const override;
+
+    virtual bool ResetPixel( const Int& x, const Int& y ) override;
+
+    virtual Int NumSamplesInPixel() override;
+
+    virtual bool CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time ) override;
+
+    virtual bool MoveToNextSample() override;
+
+    virtual Int GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary ) override;
+
+    virtual bool SetPass( const Int& pass ) override;
+
+    bool SetNumSamples( const Int numSamples );
+    Int NumSamples() const { return numSamples; }
+
+    // Per-pixel number of samples (CV_32SC1, may be zero), e.g., for foveated rendering; is shared between clones.
+    // Pixels outside of the map use NumSamples(). Empty map turns it off.
+    bool SetSampleCountMap( const cv::Mat& counts );
+
+private:
+    // Sample 'sampleInd' of the current pixel and pass.
+    void Sample( const Int& sampleInd, VEC2& raster, VEC2& secondary ) const;
+
+private:
+    Int numSamples = 16;
+    cv::Mat sampleCounts;
+    Sequence sequence = Sequence::Sobol;
+    bool isSecondaryDisk = true;
+    std::uint32_t seed = 0;
+    Int currentSampleInd = 0;
+    Int pixelNumSamples = 16; // Number of samples in the current pixel.
+    Int x = 0;
+    Int y = 0;
+    Int pass = 0;
+    std::uint32_t pixelSeed = 0;
+};
+
+
+#endif // UTILITIES_SAMPLEGENLOWDISCREPANCY_H
@@ -1,19 +1,23 @@
 #include "SampleGenUniform.h"
 
+#include <algorithm>
+
 
 using namespace lfrt;
 
 
 SampleGenUniform::SampleGenUniform( const Int primaryRes, const Int secondaryRes )
-    :primaryRes(primaryRes)
-    ,secondaryRes(secondaryRes)
+    :primaryRes(std::max<Int>( primaryRes, 1 ))
+    ,secondaryRes(std::max<Int>( secondaryRes, 1 ))
 {
+    BuildPattern();
 }
 
 
 SampleGenerator* SampleGenUniform::Clone() const
 {
-    return new SampleGenUniform( primaryRes, secondaryRes );
+    // Clone shares the same immutable pattern.
+    return new SampleGenUniform( *this );
 }
 
 
@@ -28,24 +32,18 @@ bool SampleGenUniform::ResetPixel( const Int& x, const Int& y )
 
 Int SampleGenUniform::NumSamplesInPixel()
 {
-    return primaryRes * primaryRes * secondaryRes * secondaryRes;
+    return pattern->Size();
 }
 
 
 bool SampleGenUniform::CurrentSample( Real& weight, VEC2& raster, VEC2& secondary, Real& time )
 {
-    Int index = currentSampleInd;
-    const Int indY2 = index % secondaryRes;
-    const Int indX2 = (index /= secondaryRes) % secondaryRes;
-    const Int indY1 = (index /= secondaryRes) % primaryRes;
-    const Int indX1 = (index /= primaryRes) % primaryRes;
-    weight = 1.0;
-    const Real dx1 = (0.5+Real(indX1)) / Real(primaryRes);
-    const Real dy1 = (0.5+Real(indY1)) / Real(primaryRes);
-    const Real dx2 = (0.5+Real(indX2)) / Real(secondaryRes);
-    const Real dy2 = (0.5+Real(indY2)) / Real(secondaryRes);
-    raster = { Real(x)+dx1, Real(y)+dy1 };
-    secondary = { dx2, dy2 };
+    if ( currentSampleInd >= pattern->Size() )
+        return false;
+    const VEC2& offset = pattern->rasterOffsets[currentSampleInd];
+    weight = pattern->Weight( currentSampleInd );
+    raster = { Real(x)+offset.x, Real(y)+offset.y };
+    secondary = pattern->secondary[currentSampleInd];
     time = 0.0;
     return true;
 }
@@ -54,5 +52,93 @@ bool SampleGenUniform::CurrentSample( Real& weight, VEC2& raster, VEC2& secondar
 bool SampleGenUniform::MoveToNextSample()
 {
     ++currentSampleInd;
-    return currentSampleInd < primaryRes*primaryRes*secondaryRes*secondaryRes;
-}
\ No newline at end of file
+    return currentSampleInd < pattern->Size();
+}
+
+
+Int SampleGenUniform::GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary )
+{
+    ResetPixel( x, y );
+    const Int numSamples = pattern->Size();
+    const VEC2* offsets = pattern->rasterOffsets.data();
+    const VEC2* secondaryCoords = pattern->secondary.data();
+    const Real pixelX = Real(x);
+    const Real pixelY = Real(y);
+    for ( Int i = 0; i < numSamples; ++i )
+    {
+        weight[i] = pattern->Weight( i );
+        raster[i] = { pixelX + offsets[i].x, pixelY + offsets[i].y };
+        secondary[i] = secondaryCoords[i];
+    }
+    return numSamples;
+}
+
+
+bool SampleGenUniform::SetPass( const Int& pass )
+{
+    if ( pass < 0 )
+        return false;
+    this->pass = pass;
+    pattern = pass == 0 ? basePattern : MakePassPattern( *basePattern, pass, false );
+    if ( usedDims != SampleDimAll )
+        pattern = CollapsePattern( *pattern, usedDims );
+    currentSampleInd = 0;
+    return true;
+}
+
+
+bool SampleGenUniform::SetUsedDimensions( const unsigned& dims )
+{
+    usedDims = dims & SampleDimAll;
+    return SetPass( pass );
+}
+
+
+bool SampleGenUniform::SetPrimaryRes( const Int primaryRes )
+{
+    if ( primaryRes <= 0 )
+        return false;
+    this->primaryRes = primaryRes;
+    BuildPattern();
+    return true;
+}
+
+
+bool SampleGenUniform::SetSecondaryRes( const Int secondaryRes )
+{
+    if ( secondaryRes <= 0 )
+        return false;
+    this->secondaryRes = secondaryRes;
+    BuildPattern();
+    return true;
+}
+
+
+void SampleGenUniform::BuildPattern()
+{
+    // Sample order: primary X, primary Y, secondary X, secondary Y (the last one is the fastest).
+    auto newPattern = std::make_shared<SamplePattern>();
+    const Int numSamples = primaryRes * primaryRes * secondaryRes * secondaryRes;
+    newPattern->rasterOffsets.reserve( numSamples );
+    newPattern->secondary.reserve( numSamples );
+    for ( Int indX1 = 0; indX1 < primaryRes; ++indX1 )
+    {
+        for ( Int indY1 = 0; indY1 < primaryRes; ++indY1 )
+        {
+            const Real dx1 = (0.5+Real(indX1)) / Real(primaryRes);
+            const Real dy1 = (0.5+Real(indY1)) / Real(primaryRes);
+            for ( Int indX2 = 0; indX2 < secondaryRes; ++indX2 )
+            {
+                for ( Int indY2 = 0; indY2 < secondaryRes; ++indY2 )
+                {
+                    const Real dx2 = (0.5+Real(indX2)) / Real(secondaryRes);
+                    const Real dy2 = (0.5+Real(indY2)) / Real(secondaryRes);
+                    newPattern->rasterOffsets.push_back({ dx1, dy1 });
+                    newPattern->secondary.push_back({ dx2, dy2 });
+                }
+            }
+        }
+    }
+    basePattern = newPattern;
+    SetPass( pass );
+}
@@ -2,10 +2,13 @@
 #define SAMPLEGENUNIFORM_H
 
 #include "LFRayTracer.h"
+#include "SamplePattern.h"
+
+#include <memory>
 
 
 // Simple uniform non-random sampler.
-class SampleGenUniform : public lfrt::SampleGenerator
+class SampleGenUniform final : public lfrt::SampleGenerator
 {
 public:
     using Int = lfrt::Int;
@@ -24,13 +27,37 @@ public:
 
     virtual bool MoveToNextSample() override;
 
+    virtual Int GeneratePixelSamples( const Int& x, const Int& y, Real* weight, VEC2* raster, VEC2* secondary ) override;
+
+    // Passes other than 0 use the same pattern, shifted by a low-discrepancy offset.
+    virtual bool SetPass( const Int& pass ) override;
+
+    // Samples of the pattern which differ only in unused dimensions are merged.
+    virtual bool SetUsedDimensions( const unsigned& dims ) override;
+
+    bool SetPrimaryRes( const Int primaryRes );
+    bool SetSecondaryRes( const Int secondaryRes );
+
+    Int PrimaryRes() const { return primaryRes; }
+    Int SecondaryRes() const { return secondaryRes; }
+
+private:
+    void BuildPattern();
+
+private:
     Int primaryRes = 1;
     Int secondaryRes = 1;
     Int currentSampleInd = 0;
-    Int x;
-    Int y;
+    Int x = 0;
+    Int y = 0;
+    Int pass = 0;
+    unsigned usedDims = lfrt::SampleDimAll;
+
+    // Pattern of pass 0 and pattern of the current pass; shared between clones.
+    std::shared_ptr<const SamplePattern> basePattern;
+    std::shared_ptr<const SamplePattern> pattern;
 };
 
 
 
-#endif // SAMPLEGENUNIFORM_H
\ No newline at end of file
+#endif // SAMPLEGENUNIFORM_H
@@ -0,0 +1,89 @@
+#include "SamplePattern.h"
+
+#include <cmath>
+#include <map>
+#include <utility>
+
+
+using namespace lfrt;
+
+
+namespace
+{
+
+Real Frac( const Real& value )
+{
+	return value - std::floor( value );
+}
+
+} // namespace
+
+
+std::shared_ptr<const SamplePattern> MakePassPattern(
+	const SamplePattern& base, const Int& pass, const bool isSecondaryDisk )
+{
+	auto result = std::make_shared<SamplePattern>( base );
+	if ( pass == 0 )
+		return result;
+
+	// R2 sequence: generalized golden ratio in two dimensions.
+	const Real phi = 1.32471795724474602596;
+	const Real shiftX = Frac( Real(pass) / phi );
+	const Real shiftY = Frac( Real(pass) / (phi*phi) );
+	// Golden angle keeps rotated disk samples away from the previous ones.
+	const Real angle = Real(pass) * 2.39996322972865332;
+	const Real cosA = std::cos( angle );
+	const Real sinA = std::sin( angle );
+
+	const Int numSamples = result->Size();
+	for ( Int i = 0; i < numSamples; ++i )
+	{
+		VEC2& offset = result->rasterOffsets[i];
+		offset = { Frac( offset.x + shiftX ), Frac( offset.y + shiftY ) };
+
+		VEC2& sec = result->secondary[i];
+		if ( isSecondaryDisk )
+		{
+			const Real dx = sec.x - 0.5;
+			const Real dy = sec.y - 0.5;
+			sec = { 0.5 + cosA*dx - sinA*dy, 0.5 + sinA*dx + cosA*dy };
+		}
+		else
+		{
+			// Other axis order decorrelates secondary shift from primary one.
+			sec = { Frac( sec.x + shiftY ), Frac( sec.y + shiftX ) };
+		}
+	}
+	return result;
+}
+
+
+std::shared_ptr<const SamplePattern> CollapsePattern( const SamplePattern& pattern, const unsigned& usedDims )
+{
+	auto result = std::make_shared<SamplePattern>();
+	const Int numSamples = pattern.Size();
+	const bool useRaster = (usedDims & SampleDimRaster) != 0;
+	const bool useSecondary = (usedDims & SampleDimSecondary) != 0;
+	// Patterns are built from the same arithmetic for every sample, so equal coordinates compare exactly.
+	using Key = std::pair< std::pair<Real,Real>, std::pair<Real,Real> >;
+	std::map<Key,Int> firstSample;
+	for ( Int i = 0; i < numSamples; ++i )
+	{
+		const VEC2& offset = pattern.rasterOffsets[i];
+		const VEC2& sec = pattern.secondary[i];
+		const Key key(
+			useRaster ? std::make_pair( offset.x, offset.y ) : std::make_pair( Real(0), Real(0) ),
+			useSecondary ? std::make_pair( sec.x, sec.y ) : std::make_pair( Real(0), Real(0) ) );
+		const auto found = firstSample.find( key );
+		if ( found != firstSample.end() )
+		{
+			result->weights[found->second] += pattern.Weight( i );
+			continue;
+		}
+		firstSample.emplace( key, result->Size() );
+		result->rasterOffsets.push_back( offset );
+		result->secondary.push_back( sec );
+		result->weights.push_back( pattern.Weight( i ) );
+	}
+	return result;
+}
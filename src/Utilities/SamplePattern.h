@@ -0,0 +1,40 @@
+#ifndef UTILITIES_SAMPLEPATTERN_H
+#define UTILITIES_SAMPLEPATTERN_H
+
+#include "LFRayTracer.h"
+
+#include <memory>
+#include <vector>
+
+
+// Immutable per-pixel sample pattern.
+// Is built once by the sample generator and shared read-only between its clones.
+struct SamplePattern
+{
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+	using VEC2 = lfrt::VEC2;
+
+	Int Size() const { return Int(rasterOffsets.size()); }
+	Real Weight( const Int& i ) const { return weights.empty() ? Real(1) : weights[i]; }
+
+	std::vector<VEC2> rasterOffsets; // Offsets from the pixel corner, in [0,1]x[0,1].
+	std::vector<VEC2> secondary; // Secondary coordinates, in [0,1]x[0,1].
+	std::vector<Real> weights; // Sample weights; empty if all weights are 1.
+};
+
+
+// Copy of 'base' with samples moved for the given pass, so that passes do not repeat each other.
+// Raster offsets are shifted toroidally along the R2 low-discrepancy sequence.
+// Secondary coordinates are shifted the same way or, if 'isSecondaryDisk', rotated around the disk center.
+// Pass 0 returns the unchanged pattern.
+std::shared_ptr<const SamplePattern> MakePassPattern(
+	const SamplePattern& base, const lfrt::Int& pass, const bool isSecondaryDisk );
+
+// Copy of 'pattern' in which samples that are equal in all 'usedDims' (SampleDimension flags)
+// are merged into the first of them, carrying the sum of their weights. Order of the remaining samples is kept.
+// Unused coordinates of a merged sample are the ones of its first sample.
+std::shared_ptr<const SamplePattern> CollapsePattern( const SamplePattern& pattern, const unsigned& usedDims );
+
+
+#endif // UTILITIES_SAMPLEPATTERN_H
@@ -0,0 +1,154 @@
+#include "SparseMatrix.h"
+
+#include <utility>
+
+using namespace lfrt;
+
+
+bool SparseMatrix::Assign( const Int& numRows, const Int& numCols,
+	std::vector<std::int64_t>&& rowStarts, std::vector<std::int32_t>&& colIndices, std::vector<float>&& values )
+{
+	Clear();
+	if ( numRows < 0 || numCols < 0 )
+		return false;
+	if ( rowStarts.size() != std::size_t(numRows) + 1 || rowStarts[0] != 0 )
+		return false;
+	if ( colIndices.size() != values.size() || rowStarts.back() != std::int64_t(values.size()) )
+		return false;
+	for ( Int r = 0; r < numRows; ++r )
+	{
+		if ( rowStarts[r+1] < rowStarts[r] )
+			return false;
+	}
+	for ( const std::int32_t& col : colIndices )
+	{
+		if ( col < 0 || col >= numCols )
+			return false;
+	}
+
+	rows = numRows;
+	cols = numCols;
+	forward.starts = std::move( rowStarts );
+	forward.indices = std::move( colIndices );
+	forward.values = std::move( values );
+	Transpose( forward, rows, cols, transposed );
+	return true;
+}
+
+
+void SparseMatrix::Clear()
+{
+	rows = 0;
+	cols = 0;
+	forward = CSR();
+	transposed = CSR();
+}
+
+
+bool SparseMatrix::Multiply( const float* x, float* y, const Int& channels ) const
+{
+	return Gather( forward, rows, x, y, channels );
+}
+
+
+bool SparseMatrix::MultiplyTransposed( const float* x, float* y, const Int& channels ) const
+{
+	return Gather( transposed, cols, x, y, channels );
+}
+
+
+bool SparseMatrix::Multiply( const cv::Mat& x, cv::Mat& y, const cv::Size& size ) const
+{
+	return MultiplyImage( forward, rows, cols, x, y, size );
+}
+
+
+bool SparseMatrix::MultiplyTransposed( const cv::Mat& x, cv::Mat& y, const cv::Size& size ) const
+{
+	return MultiplyImage( transposed, cols, rows, x, y, size );
+}
+
+
+// Counting sort by column; a single pass over the entries, so it is not worth threading.
+// Rows are visited in order, so that column entries stay sorted by row.
+void SparseMatrix::Transpose( const CSR& csr, const Int& rows, const Int& cols, CSR& transposed )
+{
+	const std::size_t numEntries = csr.values.size();
+	transposed.starts.assign( std::size_t(cols) + 1, 0 );
+	transposed.indices.resize( numEntries );
+	transposed.values.resize( numEntries );
+	for ( const std::int32_t& col : csr.indices )
+		++transposed.starts[col+1];
+	for ( Int c = 0; c < cols; ++c )
+		transposed.starts[c+1] += transposed.starts[c];
+
+	std::vector<std::int64_t> next( transposed.starts.begin(), transposed.starts.end() - 1 );
+	for ( Int r = 0; r < rows; ++r )
+	{
+		for ( std::int64_t i = csr.starts[r]; i < csr.starts[r+1]; ++i )
+		{
+			const std::int64_t dst = next[csr.indices[i]]++;
+			transposed.indices[dst] = std::int32_t( r );
+			transposed.values[dst] = csr.values[i];
+		}
+	}
+}
+
+
+bool SparseMatrix::Gather( const CSR& csr, const Int& rows, const float* x, float* y, const Int& channels )
+{
+	if ( channels < 1 || channels > MaxChannels )
+		return false;
+	if ( rows > 0 && ( x == nullptr || y == nullptr ) )
+		return false;
+	const std::int64_t* starts = csr.starts.data();
+	const std::int32_t* indices = csr.indices.data();
+	const float* values = csr.values.data();
+	cv::parallel_for_( cv::Range( 0, int(rows) ), [&]( const cv::Range& range )
+		{
+			if ( channels == 1 )
+			{
+				for ( Int r = range.start; r < range.end; ++r )
+				{
+					float sum = 0;
+					for ( std::int64_t i = starts[r]; i < starts[r+1]; ++i )
+						sum += values[i] * x[indices[i]];
+					y[r] = sum;
+				}
+				return;
+			}
+			for ( Int r = range.start; r < range.end; ++r )
+			{
+				float sum[MaxChannels] = { 0, 0, 0, 0 };
+				for ( std::int64_t i = starts[r]; i < starts[r+1]; ++i )
+				{
+					const float* src = x + std::size_t(indices[i]) * channels;
+					for ( Int c = 0; c < channels; ++c )
+						sum[c] += values[i] * src[c];
+				}
+				float* dst = y + std::size_t(r) * channels;
+				for ( Int c = 0; c < channels; ++c )
+					dst[c] = sum[c];
+			}
+		} );
+	return true;
+}
+
+
+bool SparseMatrix::MultiplyImage( const CSR& csr, const Int& rows, const Int& cols,
+	const cv::Mat& x, cv::Mat& y, const cv::Size& size )
+{
+	if ( x.depth() != CV_32F || !x.isContinuous() || x.total() != std::size_t(cols) )
+		return false;
+	if ( std::int64_t(size.width) * size.height != rows )
+		return false;
+	if ( &x == &y )
+		return false;
+	// Output must not share data with the input.
+	if ( y.data == x.data )
+		y.release();
+	y.create( size, x.type() );
+	if ( rows == 0 )
+		return true;
+	return Gather( csr, rows, x.ptr<float>( 0 ), y.ptr<float>( 0 ), x.channels() );
+}
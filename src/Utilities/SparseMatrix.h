@@ -0,0 +1,77 @@
+#ifndef UTILITIES_SPARSEMATRIX_H
+#define UTILITIES_SPARSEMATRIX_H
+
+#include "LFRayTracer.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Sparse matrix in compressed sparse row format, with float values and 32-bit column indices.
+// The transpose is stored as well, so that both products gather along rows and run in parallel without write conflicts.
+// Products apply the matrix to every channel of interleaved vectors, e.g., pixels of a continuous CV_32FC3 image,
+// where the row-major pixel index is the vector index.
+class SparseMatrix
+{
+public:
+	using Int = lfrt::Int;
+
+	// Maximum number of interleaved channels of the products.
+	static const Int MaxChannels = 4;
+
+public:
+
+	// Takes the arrays of a 'rows' x 'cols' matrix: entries of row r are [rowStarts[r],rowStarts[r+1]).
+	// Column indices need not be sorted within a row. False if the arrays are inconsistent.
+	bool Assign( const Int& rows, const Int& cols,
+		std::vector<std::int64_t>&& rowStarts, std::vector<std::int32_t>&& colIndices, std::vector<float>&& values );
+
+	void Clear();
+
+	Int Rows() const { return rows; }
+	Int Cols() const { return cols; }
+	std::size_t NumNonZeros() const { return forward.values.size(); }
+
+	const std::vector<std::int64_t>& RowStarts() const { return forward.starts; }
+	const std::vector<std::int32_t>& ColIndices() const { return forward.indices; }
+	const std::vector<float>& Values() const { return forward.values; }
+
+	// y = A x, where x has Cols()*channels elements and y has Rows()*channels elements.
+	bool Multiply( const float* x, float* y, const Int& channels = 1 ) const;
+
+	// y = A^T x, where x has Rows()*channels elements and y has Cols()*channels elements.
+	bool MultiplyTransposed( const float* x, float* y, const Int& channels = 1 ) const;
+
+	// Image versions: 'x' is a continuous CV_32F image with any channel count and Cols() (or Rows()) pixels,
+	// 'y' is allocated with the given size, which must have Rows() (or Cols()) pixels.
+	bool Multiply( const cv::Mat& x, cv::Mat& y, const cv::Size& size ) const;
+
+	bool MultiplyTransposed( const cv::Mat& x, cv::Mat& y, const cv::Size& size ) const;
+
+private:
+	struct CSR
+	{
+		std::vector<std::int64_t> starts;
+		std::vector<std::int32_t> indices;
+		std::vector<float> values;
+	};
+
+	static void Transpose( const CSR& csr, const Int& rows, const Int& cols, CSR& transposed );
+
+	static bool Gather( const CSR& csr, const Int& rows, const float* x, float* y, const Int& channels );
+
+	static bool MultiplyImage( const CSR& csr, const Int& rows, const Int& cols,
+		const cv::Mat& x, cv::Mat& y, const cv::Size& size );
+
+private:
+	Int rows = 0;
+	Int cols = 0;
+	CSR forward;
+	CSR transposed;
+};
+
+
+#endif // UTILITIES_SPARSEMATRIX_H
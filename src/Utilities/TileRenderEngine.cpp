@@ -0,0 +1,271 @@
+#include "TileRenderEngine.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+
+
+namespace
+{
+
+// Position of (x,y) on the Morton (Z-order) curve.
+std::uint64_t MortonIndex( std::uint32_t x, std::uint32_t y )
+{
+	std::uint64_t index = 0;
+	for ( int bit = 0; bit < 32; ++bit )
+	{
+		index |= std::uint64_t( (x >> bit) & 1 ) << (2*bit);
+		index |= std::uint64_t( (y >> bit) & 1 ) << (2*bit+1);
+	}
+	return index;
+}
+
+
+// Position of (x,y) on the Hilbert curve which fills [0,n)x[0,n), where n is power of two.
+std::uint64_t HilbertIndex( std::uint64_t n, std::uint64_t x, std::uint64_t y )
+{
+	std::uint64_t index = 0;
+	for ( std::uint64_t s = n/2; s > 0; s /= 2 )
+	{
+		const std::uint64_t rx = (x & s) > 0 ? 1 : 0;
+		const std::uint64_t ry = (y & s) > 0 ? 1 : 0;
+		index += s * s * ((3 * rx) ^ ry);
+		// Rotate the quadrant.
+		if ( ry == 0 )
+		{
+			if ( rx == 1 )
+			{
+				x = n-1 - x;
+				y = n-1 - y;
+			}
+			std::swap( x, y );
+		}
+	}
+	return index;
+}
+
+
+const std::uint64_t LowMask = 0xFFFFFFFFull;
+
+} // namespace
+
+
+
+TileQueue::TileQueue( const std::vector<TileRect>& tiles, const Int& numWorkers )
+	:tiles(tiles)
+	,numWorkers(std::max<Int>( numWorkers, 1 ))
+	,chunks(new std::atomic<std::uint64_t>[std::max<Int>( numWorkers, 1 )])
+{
+	const std::uint64_t numTiles = tiles.size();
+	for ( Int i = 0; i < this->numWorkers; ++i )
+	{
+		const std::uint64_t front = numTiles * i / this->numWorkers;
+		const std::uint64_t back  = numTiles * (i+1) / this->numWorkers;
+		chunks[i].store( (front << 32) | back );
+	}
+}
+
+
+bool TileQueue::Next( const Int& workerInd, TileRect& tile )
+{
+	Int tileInd = 0;
+	bool found = PopFront( workerInd % numWorkers, tileInd );
+	for ( Int shift = 1; !found && shift < numWorkers; ++shift )
+		found = PopBack( (workerInd + shift) % numWorkers, tileInd );
+	if ( found )
+		tile = tiles[tileInd];
+	return found;
+}
+
+
+bool TileQueue::PopFront( const Int& chunkInd, Int& tileInd )
+{
+	std::atomic<std::uint64_t>& chunk = chunks[chunkInd];
+	std::uint64_t packed = chunk.load();
+	while ( true )
+	{
+		const std::uint64_t front = packed >> 32;
+		const std::uint64_t back = packed & LowMask;
+		if ( front >= back )
+			return false;
+		if ( chunk.compare_exchange_weak( packed, ((front+1) << 32) | back ) )
+		{
+			tileInd = Int(front);
+			return true;
+		}
+	}
+}
+
+
+bool TileQueue::PopBack( const Int& chunkInd, Int& tileInd )
+{
+	std::atomic<std::uint64_t>& chunk = chunks[chunkInd];
+	std::uint64_t packed = chunk.load();
+	while ( true )
+	{
+		const std::uint64_t front = packed >> 32;
+		const std::uint64_t back = packed & LowMask;
+		if ( front >= back )
+			return false;
+		if ( chunk.compare_exchange_weak( packed, (front << 32) | (back-1) ) )
+		{
+			tileInd = Int(back-1);
+			return true;
+		}
+	}
+}
+
+
+
+RenderProgress::RenderProgress( const double& timeBudget, const std::int64_t& rayBudget, const std::shared_ptr< std::atomic<bool> >& cancelFlag )
+	:start(std::chrono::steady_clock::now())
+	,timeBudget(timeBudget)
+	,rayBudget(rayBudget)
+	,numRays(0)
+	,cancelFlag(cancelFlag)
+{
+}
+
+
+bool RenderProgress::IsCancelled() const
+{
+	return cancelFlag != nullptr && cancelFlag->load();
+}
+
+
+bool RenderProgress::ShouldStop() const
+{
+	if ( IsCancelled() )
+		return true;
+	if ( rayBudget > 0 && numRays.load() >= rayBudget )
+		return true;
+	if ( timeBudget > 0 )
+	{
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if ( elapsed.count() >= timeBudget )
+			return true;
+	}
+	return false;
+}
+
+
+
+void TileRenderEngine::BuildTiles( const Int& startX, const Int& startY, const Int& endX, const Int& endY, std::vector<TileRect>& tiles ) const
+{
+	tiles.clear();
+	const Int tileSize = std::max<Int>( TileSize, 1 );
+	const Int sizeX = endX - startX;
+	const Int sizeY = endY - startY;
+	if ( sizeX <= 0 || sizeY <= 0 )
+		return;
+	const Int numTilesX = (sizeX + tileSize - 1) / tileSize;
+	const Int numTilesY = (sizeY + tileSize - 1) / tileSize;
+
+	std::uint64_t curveSize = 1;
+	while ( curveSize < std::uint64_t(std::max( numTilesX, numTilesY )) )
+		curveSize *= 2;
+
+	std::vector< std::pair<std::uint64_t,TileRect> > keyed;
+	keyed.reserve( numTilesX * numTilesY );
+	for ( Int tileIndY = 0; tileIndY < numTilesY; ++tileIndY )
+	{
+		for ( Int tileIndX = 0; tileIndX < numTilesX; ++tileIndX )
+		{
+			TileRect rect;
+			rect.startX = startX + tileIndX * tileSize;
+			rect.startY = startY + tileIndY * tileSize;
+			rect.endX = std::min<Int>( rect.startX + tileSize, endX );
+			rect.endY = std::min<Int>( rect.startY + tileSize, endY );
+			std::uint64_t key = std::uint64_t(tileIndY) * numTilesX + tileIndX;
+			if ( TileOrder == Order::Morton )
+				key = MortonIndex( tileIndX, tileIndY );
+			else if ( TileOrder == Order::Hilbert )
+				key = HilbertIndex( curveSize, tileIndX, tileIndY );
+			keyed.push_back({ key, rect });
+		}
+	}
+
+	std::sort( keyed.begin(), keyed.end(),
+		[]( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+	tiles.reserve( keyed.size() );
+	for ( const auto& item : keyed )
+		tiles.push_back( item.second );
+}
+
+
+void TileRenderEngine::Run( const std::vector<TileRect>& tiles, const Worker& worker ) const
+{
+	if ( tiles.empty() )
+		return;
+	const Int numWorkers = std::min<Int>( NumWorkers(), tiles.size() );
+	TileQueue queue( tiles, numWorkers );
+	cv::parallel_for_( cv::Range( 0, numWorkers ),
+		[&]( const cv::Range& range )
+		{
+			for ( int workerInd = range.start; workerInd < range.end; ++workerInd )
+				worker( workerInd, queue );
+		},
+		numWorkers
+	);
+}
+
+
+void TileRenderEngine::SelectActiveTiles( const std::vector<TileRect>& tiles, const cv::Mat& activePixels, std::vector<TileRect>& activeTiles ) const
+{
+	activeTiles.clear();
+	for ( const TileRect& rect : tiles )
+	{
+		bool isActive = false;
+		for ( Int y = rect.startY; y < rect.endY && !isActive; ++y )
+		{
+			const unsigned char* row = activePixels.ptr<unsigned char>(y);
+			for ( Int x = rect.startX; x < rect.endX && !isActive; ++x )
+				isActive = row[x] != 0;
+		}
+		if ( isActive )
+			activeTiles.push_back( rect );
+	}
+}
+
+
+void TileRenderEngine::ClearDirtyPixels( MultiPassAccumulator& accum ) const
+{
+	const cv::Mat& mask = accum.RenderMask();
+	for ( Int y = 0; y < mask.rows; ++y )
+	{
+		const unsigned char* row = mask.ptr<unsigned char>(y);
+		Int x = 0;
+		while ( x < mask.cols )
+		{
+			if ( row[x] == 0 )
+			{
+				++x;
+				continue;
+			}
+			const Int runStart = x;
+			while ( x < mask.cols && row[x] != 0 )
+				++x;
+			accum.Clear( runStart, y, x, y+1 );
+		}
+	}
+}
+
+
+TileRenderEngine::Int TileRenderEngine::MaxPasses() const
+{
+	Int maxPasses = 1;
+	if ( Progressive.Enabled )
+		maxPasses = Progressive.MaxPasses;
+	if ( Adaptive.Enabled )
+		maxPasses = Progressive.Enabled ? std::min( maxPasses, Adaptive.MaxPasses ) : Adaptive.MaxPasses;
+	return maxPasses;
+}
+
+
+TileRenderEngine::Int TileRenderEngine::NumWorkers() const
+{
+	if ( NumThreads > 0 )
+		return NumThreads;
+	return std::max<Int>( cv::getNumThreads(), 1 );
+}
@@ -0,0 +1,304 @@
+#ifndef UTILITIES_TILERENDERENGINE_H
+#define UTILITIES_TILERENDERENGINE_H
+
+#include "LFRayTracer.h"
+#include "MultiPassAccumulator.h"
+#include "RenderKernel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+// Rectangular pixel area [startX,endX)x[startY,endY).
+struct TileRect
+{
+	lfrt::Int startX;
+	lfrt::Int startY;
+	lfrt::Int endX;
+	lfrt::Int endY;
+};
+
+
+// Work-stealing queue over a fixed list of tiles.
+// Tile list is split into one contiguous chunk per worker.
+// Worker takes tiles from the front of its own chunk, keeping spatial locality,
+// and once it is empty, steals from the back of other workers' chunks.
+class TileQueue
+{
+public:
+	using Int = lfrt::Int;
+
+	TileQueue( const std::vector<TileRect>& tiles, const Int& numWorkers );
+
+	Int NumWorkers() const { return numWorkers; }
+
+	// Fetch the next tile for the given worker. False if no tiles are left anywhere.
+	bool Next( const Int& workerInd, TileRect& tile );
+
+private:
+	bool PopFront( const Int& chunkInd, Int& tileInd );
+	bool PopBack( const Int& chunkInd, Int& tileInd );
+
+private:
+	const std::vector<TileRect>& tiles;
+	Int numWorkers = 0;
+	// Each chunk packs (front << 32) | back into one word, so that owner and thieves never take the same tile.
+	std::unique_ptr< std::atomic<std::uint64_t>[] > chunks;
+};
+
+
+// Budget and cancellation state of one Render call. Is shared between workers.
+class RenderProgress
+{
+public:
+	using Int = lfrt::Int;
+
+	// Zero budget means no limit. Null 'cancelFlag' means no cancellation.
+	RenderProgress( const double& timeBudget, const std::int64_t& rayBudget, const std::shared_ptr< std::atomic<bool> >& cancelFlag );
+
+	void AddRays( const Int& count ) { numRays += count; }
+	std::int64_t NumRays() const { return numRays; }
+
+	bool IsCancelled() const;
+	// True if render was cancelled or any of the budgets is exhausted.
+	bool ShouldStop() const;
+
+private:
+	std::chrono::steady_clock::time_point start;
+	double timeBudget = 0;
+	std::int64_t rayBudget = 0;
+	std::atomic<std::int64_t> numRays;
+	std::shared_ptr< std::atomic<bool> > cancelFlag;
+};
+
+
+// Tile scheduling engine shared by display simulators.
+// Splits render bounds into tiles, orders them along a space-filling curve,
+// and processes them in parallel with work stealing.
+class TileRenderEngine
+{
+public:
+	using Int = lfrt::Int;
+	using Real = lfrt::Real;
+
+	enum class Order
+	{
+		RowMajor,
+		Morton,
+		Hilbert,
+	};
+
+	// Worker receives its index and the shared queue; it should pull tiles until queue is empty.
+	using Worker = std::function<void( const Int& workerInd, TileQueue& queue )>;
+
+	// After the first pass, pixels whose estimated error is above the threshold get additional passes.
+	// Requires MultiPassAccumulator and a sample generator which supports SetPass; otherwise only one pass is done.
+	struct AdaptiveSettings
+	{
+		bool Enabled = false;
+		Int MaxPasses = 8; // Including the first pass.
+		Real ErrorThreshold = 0.005; // Standard error of mean pixel luminance.
+	};
+
+	// Successive sample passes are accumulated into the same MultiPassAccumulator
+	// until the pass count or one of the budgets is exhausted.
+	// Budgets are checked before each tile and also stop the first pass, leaving the rest of its tiles unrendered.
+	// Requires MultiPassAccumulator and a sample generator which supports SetPass for passes beyond the first one.
+	struct ProgressiveSettings
+	{
+		bool Enabled = false;
+		Int MaxPasses = 64; // Including the first pass.
+		double TimeBudget = 0; // Wall-clock seconds; zero means no limit.
+		std::int64_t RayBudget = 0; // Zero means no limit.
+	};
+
+	// Is called from worker threads, possibly concurrently, after the tile is written into the accumulator.
+	using TileCallbackFunc = std::function<void( const TileRect& tile, const Int& pass )>;
+
+public:
+	// Splits region into tiles, clipped to the region, in the configured order.
+	void BuildTiles( const Int& startX, const Int& startY, const Int& endX, const Int& endY, std::vector<TileRect>& tiles ) const;
+
+	// Runs 'worker' once for each worker thread.
+	void Run( const std::vector<TileRect>& tiles, const Worker& worker ) const;
+
+	// Number of worker threads which will be used.
+	Int NumWorkers() const;
+
+	// Renders all tiles of the accumulator's sampling bounds.
+	// Render bounds of MultiPassAccumulator are cleared first.
+	// If MultiPassAccumulator has dirty regions, only they are cleared and re-rendered.
+	// For 'shader' definition, see RenderTileKernel.
+	// False on invalid input or if render was cancelled; partial result stays in the accumulator.
+	template< class ShaderT >
+	bool Render(
+		const lfrt::RayGenerator& raygen,
+		const lfrt::SampleGenerator& sampleGen,
+		lfrt::SampleAccumulator& sampleAccum,
+		const ShaderT& shader ) const;
+
+private:
+	// Renders one pass over 'tiles'. Tiles are merged into 'sampleAccum', or added to 'additiveAccum' if it is given.
+	template< class ShaderT >
+	void RenderPass(
+		const lfrt::RayGenerator& raygen,
+		const lfrt::SampleGenerator& sampleGen,
+		lfrt::SampleAccumulator& sampleAccum,
+		const ShaderT& shader,
+		const std::vector<TileRect>& tiles,
+		const Int& pass,
+		const cv::Mat* activePixels,
+		MultiPassAccumulator* additiveAccum,
+		RenderProgress& progress ) const;
+
+	// Maximum number of passes, as limited by enabled adaptive and progressive settings.
+	Int MaxPasses() const;
+
+	// Tiles which contain at least one non-zero pixel of 'activePixels'.
+	void SelectActiveTiles( const std::vector<TileRect>& tiles, const cv::Mat& activePixels, std::vector<TileRect>& activeTiles ) const;
+
+	// Clears dirty pixels of the accumulator, run by run.
+	void ClearDirtyPixels( MultiPassAccumulator& accum ) const;
+
+public:
+	Int TileSize = 16;
+	Order TileOrder = Order::Hilbert;
+	Int NumThreads = 0; // Zero means OpenCV's number of threads.
+	AdaptiveSettings Adaptive;
+	ProgressiveSettings Progressive;
+	TileCallbackFunc TileCallback;
+	// Set to true from any thread to stop rendering after the current tiles.
+	std::shared_ptr< std::atomic<bool> > CancelFlag;
+};
+
+
+
+template< class ShaderT >
+bool TileRenderEngine::Render(
+	const lfrt::RayGenerator& raygen,
+	const lfrt::SampleGenerator& sampleGen,
+	lfrt::SampleAccumulator& sampleAccum,
+	const ShaderT& shader ) const
+{
+	if ( sampleAccum.Width() <= 0 || sampleAccum.Height() <= 0 )
+		return false;
+
+	Int globStartX;
+	Int globStartY;
+	Int globEndX;
+	Int globEndY;
+	if ( !sampleAccum.GetRenderBounds( globStartX, globStartY, globEndX, globEndY ) )
+		return false;
+	MultiPassAccumulator* multiPassAccum = dynamic_cast<MultiPassAccumulator*>( &sampleAccum );
+	const bool isIncremental = multiPassAccum != nullptr && multiPassAccum->HasDirtyRegions();
+	if ( isIncremental && globStartX >= globEndX )
+		return true; // Nothing is dirty.
+	if ( globStartX < 0 || globStartX >= globEndX ||
+		 globStartY < 0 || globStartY >= globEndY )
+		return false;
+
+	// Pixels outside render bounds may still contribute to it, e.g., through a reconstruction filter.
+	Int sampleStartX;
+	Int sampleStartY;
+	Int sampleEndX;
+	Int sampleEndY;
+	if ( !sampleAccum.GetSamplingBounds( sampleStartX, sampleStartY, sampleEndX, sampleEndY ) )
+		return false;
+	if ( sampleStartX > globStartX || sampleStartY > globStartY ||
+		 sampleEndX < globEndX || sampleEndY < globEndY )
+		return false;
+
+	const double timeBudget = Progressive.Enabled ? Progressive.TimeBudget : 0;
+	const std::int64_t rayBudget = Progressive.Enabled ? Progressive.RayBudget : 0;
+	RenderProgress progress( timeBudget, rayBudget, CancelFlag );
+
+	std::vector<TileRect> tiles;
+	BuildTiles( sampleStartX, sampleStartY, sampleEndX, sampleEndY, tiles );
+	if ( isIncremental )
+	{
+		// Only dirty pixels are replaced; the rest of the image keeps the previous result.
+		ClearDirtyPixels( *multiPassAccum );
+		std::vector<TileRect> dirtyTiles;
+		SelectActiveTiles( tiles, multiPassAccum->SamplingMask(), dirtyTiles );
+		tiles.swap( dirtyTiles );
+		RenderPass( raygen, sampleGen, sampleAccum, shader, tiles, 0, &multiPassAccum->SamplingMask(), multiPassAccum, progress );
+	}
+	else
+	{
+		if ( multiPassAccum != nullptr )
+			multiPassAccum->Clear( globStartX, globStartY, globEndX, globEndY );
+		RenderPass( raygen, sampleGen, sampleAccum, shader, tiles, 0, nullptr, nullptr, progress );
+	}
+
+	if ( multiPassAccum == nullptr || !(Adaptive.Enabled || Progressive.Enabled) )
+		return !progress.IsCancelled();
+
+	std::unique_ptr<lfrt::SampleGenerator> probe( sampleGen.Clone() );
+	cv::Mat activePixels;
+	std::vector<TileRect> activeTiles;
+	const Int maxPasses = MaxPasses();
+	for ( Int pass = 1; pass < maxPasses && !progress.ShouldStop(); ++pass )
+	{
+		if ( !probe->SetPass( pass ) )
+			break;
+		if ( Adaptive.Enabled )
+		{
+			if ( multiPassAccum->SelectUnconverged( Adaptive.ErrorThreshold, activePixels ) == 0 )
+				break;
+			SelectActiveTiles( tiles, activePixels, activeTiles );
+			RenderPass( raygen, sampleGen, sampleAccum, shader, activeTiles, pass, &activePixels, multiPassAccum, progress );
+		}
+		else
+		{
+			const cv::Mat* dirtyPixels = isIncremental ? &multiPassAccum->SamplingMask() : nullptr;
+			RenderPass( raygen, sampleGen, sampleAccum, shader, tiles, pass, dirtyPixels, multiPassAccum, progress );
+		}
+	}
+
+	return !progress.IsCancelled();
+}
+
+
+template< class ShaderT >
+void TileRenderEngine::RenderPass(
+	const lfrt::RayGenerator& raygen,
+	const lfrt::SampleGenerator& sampleGen,
+	lfrt::SampleAccumulator& sampleAccum,
+	const ShaderT& shader,
+	const std::vector<TileRect>& tiles,
+	const Int& pass,
+	const cv::Mat* activePixels,
+	MultiPassAccumulator* additiveAccum,
+	RenderProgress& progress ) const
+{
+	Run( tiles, [&]( const Int& workerInd, TileQueue& queue )
+		{
+			std::unique_ptr<lfrt::SampleGenerator> sampler( sampleGen.Clone() );
+			sampler->SetUsedDimensions( raygen.UsedDimensions() );
+			sampler->SetPass( pass );
+			RenderKernelBuffers buffers;
+			TileRect rect;
+			while ( !progress.ShouldStop() && queue.Next( workerInd, rect ) )
+			{
+				lfrt::SampleTile* tile = sampleAccum.CreateSampleTile( rect.startX, rect.startY, rect.endX, rect.endY );
+				const auto kernel = SelectRenderKernel<ShaderT>( *sampler, raygen, *tile );
+				const Int numRays = kernel( *sampler, raygen, *tile, shader, rect.startX, rect.startY, rect.endX, rect.endY, activePixels, buffers );
+				progress.AddRays( numRays );
+				if ( additiveAccum != nullptr )
+					additiveAccum->AddSampleTile( tile );
+				else
+					sampleAccum.MergeSampleTile( tile );
+				sampleAccum.DestroySampleTile( tile );
+				if ( TileCallback )
+					TileCallback( rect, pass );
+			}
+		}
+	);
+}
+
+
+#endif // UTILITIES_TILERENDERENGINE_H
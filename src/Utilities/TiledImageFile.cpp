@@ -0,0 +1,157 @@
+#include "TiledImageFile.h"
+
+#include <algorithm>
+
+
+namespace
+{
+
+const char Magic[8] = { 'L', 'F', 'R', 'T', 'T', 'I', 'L', '1' };
+const std::int64_t HeaderSize = sizeof(Magic) + 3 * sizeof(std::int64_t);
+const std::int64_t PixelSize = 3 * sizeof(float);
+
+} // namespace
+
+
+
+TiledImageFile::~TiledImageFile()
+{
+	Close();
+}
+
+
+bool TiledImageFile::Create( const std::string& filepath, const Index& width, const Index& height, const Index& tileSize )
+{
+	Close();
+	if ( width <= 0 || height <= 0 || tileSize <= 0 )
+		return false;
+
+	file.open( filepath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+	if ( !file.is_open() )
+		return false;
+
+	this->width = width;
+	this->height = height;
+	this->tileSize = tileSize;
+	numTilesX = (width + tileSize - 1) / tileSize;
+	const Index numTilesY = (height + tileSize - 1) / tileSize;
+
+	const std::int64_t header[3] = { width, height, tileSize };
+	file.write( Magic, sizeof(Magic) );
+	file.write( reinterpret_cast<const char*>( header ), sizeof(header) );
+
+	// Extend the file to its full size; the file system fills the gap with zeros.
+	const Index fileSize = HeaderSize + numTilesX * numTilesY * tileSize * tileSize * PixelSize;
+	file.seekp( fileSize - 1 );
+	file.put( 0 );
+	file.flush();
+	if ( !file.good() )
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+
+bool TiledImageFile::Open( const std::string& filepath )
+{
+	Close();
+	file.open( filepath, std::ios::in | std::ios::out | std::ios::binary );
+	if ( !file.is_open() )
+		return false;
+
+	char magic[sizeof(Magic)];
+	std::int64_t header[3] = { 0, 0, 0 };
+	file.read( magic, sizeof(magic) );
+	file.read( reinterpret_cast<char*>( header ), sizeof(header) );
+	if ( !file.good() || !std::equal( magic, magic + sizeof(magic), Magic ) ||
+		 header[0] <= 0 || header[1] <= 0 || header[2] <= 0 )
+	{
+		Close();
+		return false;
+	}
+	width = header[0];
+	height = header[1];
+	tileSize = header[2];
+	numTilesX = (width + tileSize - 1) / tileSize;
+	return true;
+}
+
+
+void TiledImageFile::Close()
+{
+	if ( file.is_open() )
+		file.close();
+	width = 0;
+	height = 0;
+	tileSize = 0;
+	numTilesX = 0;
+}
+
+
+TiledImageFile::Index TiledImageFile::PixelOffset( const Index& x, const Index& y ) const
+{
+	const Index tileInd = (y / tileSize) * numTilesX + (x / tileSize);
+	const Index inTile = (y % tileSize) * tileSize + (x % tileSize);
+	return HeaderSize + (tileInd * tileSize * tileSize + inTile) * PixelSize;
+}
+
+
+bool TiledImageFile::WriteRegion( const Index& x, const Index& y, const cv::Mat& image )
+{
+	if ( !IsOpen() || image.type() != CV_32FC3 )
+		return false;
+	const Index startX = std::max<Index>( x, 0 );
+	const Index startY = std::max<Index>( y, 0 );
+	const Index endX = std::min<Index>( x + image.cols, width );
+	const Index endY = std::min<Index>( y + image.rows, height );
+
+	std::lock_guard<std::mutex> lock( fileMutex );
+	for ( Index row = startY; row < endY; ++row )
+	{
+		const float* src = image.ptr<float>( int(row - y) );
+		// Row of the region is split at tile borders into contiguous runs.
+		for ( Index runStart = startX; runStart < endX; )
+		{
+			const Index runEnd = std::min<Index>( (runStart / tileSize + 1) * tileSize, endX );
+			file.seekp( PixelOffset( runStart, row ) );
+			file.write( reinterpret_cast<const char*>( src + 3*(runStart - x) ), (runEnd - runStart) * PixelSize );
+			runStart = runEnd;
+		}
+	}
+	return file.good();
+}
+
+
+bool TiledImageFile::ReadRegion( const Index& x, const Index& y, const Index& width, const Index& height, cv::Mat& image )
+{
+	if ( !IsOpen() || width <= 0 || height <= 0 )
+		return false;
+	if ( x < 0 || y < 0 || x + width > this->width || y + height > this->height )
+		return false;
+
+	image = cv::Mat( int(height), int(width), CV_32FC3 );
+	std::lock_guard<std::mutex> lock( fileMutex );
+	file.flush();
+	for ( Index row = 0; row < height; ++row )
+	{
+		float* dst = image.ptr<float>( int(row) );
+		for ( Index runStart = x; runStart < x + width; )
+		{
+			const Index runEnd = std::min<Index>( (runStart / tileSize + 1) * tileSize, x + width );
+			file.seekg( PixelOffset( runStart, y + row ) );
+			file.read( reinterpret_cast<char*>( dst + 3*(runStart - x) ), (runEnd - runStart) * PixelSize );
+			runStart = runEnd;
+		}
+	}
+	return file.good();
+}
+
+
+bool TiledImageFile::Flush()
+{
+	std::lock_guard<std::mutex> lock( fileMutex );
+	file.flush();
+	return file.good();
+}
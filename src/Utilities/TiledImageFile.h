@@ -0,0 +1,61 @@
+#ifndef UTILITIES_TILEDIMAGEFILE_H
+#define UTILITIES_TILEDIMAGEFILE_H
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+
+// Three-channel float image (CV_32FC3 layout) stored on disk in square tiles,
+// so that regions can be written and read without holding the whole image in memory.
+// File consists of a header (magic, width, height, tile size as 64-bit integers)
+// followed by all tiles in row-major tile order; each tile is stored row-major and
+// border tiles are padded to the full tile size. Offsets are 64-bit.
+// Region access is serialized, so the object may be shared between threads.
+class TiledImageFile
+{
+public:
+	using Index = std::int64_t;
+
+	TiledImageFile() = default;
+	~TiledImageFile();
+
+	TiledImageFile( const TiledImageFile& ) = delete;
+	TiledImageFile& operator=( const TiledImageFile& ) = delete;
+
+	// Creates (or overwrites) file of the given size, filled with zeros.
+	bool Create( const std::string& filepath, const Index& width, const Index& height, const Index& tileSize = 64 );
+	// Opens existing file for reading and writing.
+	bool Open( const std::string& filepath );
+	void Close();
+	bool IsOpen() const { return file.is_open(); }
+
+	Index Width() const { return width; }
+	Index Height() const { return height; }
+	Index TileSize() const { return tileSize; }
+
+	// Writes CV_32FC3 'image' with its top-left corner at (x,y); parts outside of the file image are skipped.
+	bool WriteRegion( const Index& x, const Index& y, const cv::Mat& image );
+	// Reads 'width' x 'height' region at (x,y) into CV_32FC3 'image'; region must be inside of the file image.
+	bool ReadRegion( const Index& x, const Index& y, const Index& width, const Index& height, cv::Mat& image );
+
+	bool Flush();
+
+private:
+	// Byte offset of pixel (x,y) in the file.
+	Index PixelOffset( const Index& x, const Index& y ) const;
+
+private:
+	std::fstream file;
+	std::mutex fileMutex;
+	Index width = 0;
+	Index height = 0;
+	Index tileSize = 0;
+	Index numTilesX = 0;
+};
+
+
+#endif // UTILITIES_TILEDIMAGEFILE_H